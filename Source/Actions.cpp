@@ -49,7 +49,11 @@ inline void Actions::clearMap(ActionUseMap& map)
 
 void Actions::clear()
 {
-	clearMap(useItemMap);
+	for (std::vector<Action*>::iterator it = useItemVector.begin(); it != useItemVector.end(); ++it) {
+		delete *it;
+	}
+	useItemVector.clear();
+
 	clearMap(uniqueItemMap);
 	clearMap(actionItemMap);
 
@@ -85,7 +89,14 @@ bool Actions::registerEvent(Event* event, xmlNodePtr p)
 
 	int value;
 	if (readXMLInteger(p, "itemid", value)) {
-		useItemMap[value] = action;
+		if (value <= 0 || value > 0xFFFF) {
+			return false;
+		}
+
+		if ((uint32_t)value >= useItemVector.size()) {
+			useItemVector.resize(std::max<uint32_t>(value + 1, Item::items.size()), nullptr);
+		}
+		useItemVector[value] = action;
 	} else if (readXMLInteger(p, "uniqueid", value)) {
 		uniqueItemMap[value] = action;
 	} else if (readXMLInteger(p, "actionid", value)) {
@@ -206,9 +217,8 @@ Action* Actions::getAction(const Item* item, Action::Type type) const
 	}
 
 	if (type == Action::Any || type == Action::ItemID) {
-		ActionUseMap::const_iterator it = useItemMap.find(item->getID());
-		if (it != useItemMap.end()) {
-			return it->second;
+		if (item->getID() < useItemVector.size() && useItemVector[item->getID()]) {
+			return useItemVector[item->getID()];
 		}
 	}
 
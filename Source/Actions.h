@@ -2,6 +2,7 @@
 #define OTSERV_ACTIONS_H_
 
 #include <map>
+#include <vector>
 
 #include "baseevents.h"
 #include "definitions.h"
@@ -130,7 +131,8 @@ protected:
 	bool registerEvent(Event* event, xmlNodePtr p) override;
 
 	typedef std::map<unsigned short, Action*> ActionUseMap;
-	ActionUseMap useItemMap;
+	// indexed by item id, looked up on every use
+	std::vector<Action*> useItemVector;
 	ActionUseMap uniqueItemMap;
 	ActionUseMap actionItemMap;
 
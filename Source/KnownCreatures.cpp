@@ -0,0 +1,52 @@
+#include "otpch.h"
+
+#include "KnownCreatures.h"
+
+
+constexpr uint16_t KnownCreatures::CAPACITY;
+constexpr uint16_t KnownCreatures::NONE;
+
+
+KnownCreatures::KnownCreatures() : m_head(NONE), m_tail(NONE), m_size(0)
+{
+	m_index.reserve(CAPACITY);
+}
+
+void KnownCreatures::unlink(const uint16_t slot)
+{
+	const uint16_t prev = m_prev[slot];
+	const uint16_t next = m_next[slot];
+
+	if (prev != NONE) {
+		m_next[prev] = next;
+	} else {
+		m_head = next;
+	}
+
+	if (next != NONE) {
+		m_prev[next] = prev;
+	} else {
+		m_tail = prev;
+	}
+}
+
+void KnownCreatures::linkBack(const uint16_t slot)
+{
+	m_prev[slot] = m_tail;
+	m_next[slot] = NONE;
+
+	if (m_tail != NONE) {
+		m_next[m_tail] = slot;
+	} else {
+		m_head = slot;
+	}
+
+	m_tail = slot;
+}
+
+uint16_t KnownCreatures::evict(const uint16_t slot)
+{
+	m_index.erase(m_ids[slot]);
+	unlink(slot);
+	return slot;
+}
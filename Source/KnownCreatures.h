@@ -0,0 +1,107 @@
+#ifndef OTSERV_KNOWN_CREATURES_H_
+#define OTSERV_KNOWN_CREATURES_H_
+
+#include <cstdint>
+#include <unordered_map>
+
+#include "definitions.h"
+
+
+// Mirrors the 7.4 client's known creature cache: a fixed number of
+// creature ids ordered from least to most recently sent. Lookup is a hash
+// probe and the recency order is kept as an index linked list over a
+// fixed array, so nothing is allocated after construction.
+class KnownCreatures
+{
+public:
+	static constexpr uint16_t CAPACITY = 150;
+
+	KnownCreatures();
+
+	bool isKnown(uint32_t id) const;
+	uint16_t size() const { return m_size; }
+
+	// Marks id as the most recently sent creature. Returns true if the client
+	// already knew it, otherwise stores it and sets removed to the id that
+	// had to be dropped to make room (0 if the cache was not full).
+	// Eviction starts at the least recently sent creature and skips up to
+	// CAPACITY entries for which canForget(id) is false; those are queued
+	// behind the new id, the same order the original std::list scan left.
+	template <class Pred>
+	bool touch(uint32_t id, uint32_t& removed, Pred canForget);
+
+private:
+	static constexpr uint16_t NONE = 0xFFFF;
+
+	void unlink(uint16_t slot);
+	void linkBack(uint16_t slot);
+	uint16_t evict(uint16_t slot);
+
+	uint32_t m_ids[CAPACITY];
+	uint16_t m_prev[CAPACITY];
+	uint16_t m_next[CAPACITY];
+	uint16_t m_head;
+	uint16_t m_tail;
+	uint16_t m_size;
+	std::unordered_map<uint32_t, uint16_t> m_index;
+};
+
+
+inline bool KnownCreatures::isKnown(const uint32_t id) const
+{
+	return m_index.find(id) != m_index.end();
+}
+
+template <class Pred>
+bool KnownCreatures::touch(const uint32_t id, uint32_t& removed, Pred canForget)
+{
+	const auto itr = m_index.find(id);
+	if (itr != m_index.end()) {
+		if (itr->second != m_tail) {
+			unlink(itr->second);
+			linkBack(itr->second);
+		}
+		return true;
+	}
+
+	if (m_size < CAPACITY) {
+		const uint16_t slot = m_size++;
+		m_ids[slot] = id;
+		m_index[id] = slot;
+		linkBack(slot);
+		removed = 0;
+		return false;
+	}
+
+	// find the least recently sent creature that may be forgotten
+	uint16_t victim = m_head;
+	uint16_t skipped = 0;
+	while (skipped < CAPACITY && !canForget(m_ids[victim])) {
+		victim = m_next[victim];
+		++skipped;
+	}
+
+	// if everyone is still in sight the oldest one is dropped anyway
+	if (skipped == CAPACITY) {
+		victim = m_head;
+		skipped = 0;
+	}
+
+	removed = m_ids[victim];
+	const uint16_t slot = evict(victim);
+	m_ids[slot] = id;
+	m_index[id] = slot;
+	linkBack(slot);
+
+	// creatures still in sight go behind the new one
+	while (skipped-- > 0) {
+		const uint16_t front = m_head;
+		unlink(front);
+		linkBack(front);
+	}
+
+	return false;
+}
+
+
+#endif
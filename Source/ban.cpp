@@ -24,12 +24,87 @@
 #include "configmanager.h"
 #include "database.h"
 #include "ioplayer.h"
+#include "otsystem.h"
 #include "tools.h"
 
 #include <sstream>
 
 extern ConfigManager g_config;
 
+IpBanTrie::IpBanTrie()
+{
+	clear();
+}
+
+void IpBanTrie::clear()
+{
+	m_nodes.clear();
+
+	Node root = {{0, 0}, false};
+	m_nodes.push_back(root);
+}
+
+void IpBanTrie::add(uint32_t ip, uint32_t prefixLength)
+{
+	uint32_t node = 0;
+	for (uint32_t depth = 0; depth < prefixLength; ++depth) {
+		uint32_t bit = (ip >> (31 - depth)) & 1;
+		if (!m_nodes[node].child[bit]) {
+			Node child = {{0, 0}, false};
+			m_nodes[node].child[bit] = m_nodes.size();
+			m_nodes.push_back(child);
+		}
+		node = m_nodes[node].child[bit];
+	}
+
+	m_nodes[node].banned = true;
+}
+
+bool IpBanTrie::contains(uint32_t ip) const
+{
+	// the root is never a child, so 0 marks a missing branch
+	uint32_t node = 0;
+	for (uint32_t depth = 0;; ++depth) {
+		if (m_nodes[node].banned) {
+			return true;
+		}
+
+		if (depth == 32) {
+			return false;
+		}
+
+		node = m_nodes[node].child[(ip >> (31 - depth)) & 1];
+		if (!node) {
+			return false;
+		}
+	}
+}
+
+// a CIDR mask is a run of ones followed by zeros
+static bool getPrefixLength(uint32_t mask, uint32_t& length)
+{
+	uint32_t inverted = ~mask;
+	if (inverted & (inverted + 1)) {
+		return false;
+	}
+
+	length = 0;
+	while (length < 32 && (mask & (0x80000000 >> length))) {
+		++length;
+	}
+	return true;
+}
+
+// with several bans on the same value the longest one counts, 0 never runs out
+static uint32_t longerBan(uint32_t expires, uint32_t other)
+{
+	if (expires == 0 || other == 0) {
+		return 0;
+	}
+
+	return std::max(expires, other);
+}
+
 BanManager::BanManager()
 {
 }
@@ -45,103 +120,228 @@ void BanManager::loadSettings()
 	loginTimeout = (uint32_t)g_config.getNumber(ConfigManager::LOGIN_TIMEOUT) / 1000;
 }
 
-bool BanManager::clearTemporaryBans()
+void BanManager::loadBans()
 {
 	Database* db = Database::instance();
 	DBQuery query;
-	query << "UPDATE `bans` SET `active` = 0 WHERE `expires` = 0";
-	return db->executeQuery(query.str());
+	DBResult* result;
+
+	query << "SELECT `type`, `value`, `param`, `expires` FROM `bans` WHERE `active` = 1 AND `type` IN ("
+	      << BANTYPE_IP_BANISHMENT << ", " << BANTYPE_NAMELOCK << ", " << BANTYPE_BANISHMENT << ", "
+	      << BANTYPE_DELETION << ")";
+
+	boost::recursive_mutex::scoped_lock lockClass(banLock);
+	ipBans.clear();
+	banishments.clear();
+	nameLocks.clear();
+	deletions.clear();
+	banExpiry.clear();
+
+	if ((result = db->storeQuery(query.str()))) {
+		do {
+			addToIndex((BanType_t)result->getDataInt("type"), (uint32_t)result->getDataLong("value"),
+			           (uint32_t)result->getDataLong("param"), (uint32_t)result->getDataLong("expires"));
+		} while (result->next());
+
+		db->freeResult(result);
+	}
+
+	rebuildIpIndex();
 }
 
-bool BanManager::isIpBanished(uint32_t clientip, uint32_t mask /*= 0xFFFFFFFF*/) const
+void BanManager::addToIndex(BanType_t type, uint32_t value, uint32_t param, uint32_t expires)
 {
-	if (clientip != 0) {
-		Database* db = Database::instance();
-		DBQuery query;
-		DBResult* result;
+	BanValueMap* map = nullptr;
+	switch (type) {
+	case BANTYPE_IP_BANISHMENT: {
+		IpRange range(value, param);
+		IpBanMap::iterator it = ipBans.find(range);
+		if (it != ipBans.end()) {
+			it->second = longerBan(it->second, expires);
+		} else {
+			ipBans[range] = expires;
+		}
 
-		uint32_t currentTime = std::time(nullptr);
-		query << "SELECT "
-		         "COUNT(*) AS `count` "
-		         "FROM "
-		         "`bans` "
-		         "WHERE "
-		         "`type` = "
-		      << BANTYPE_IP_BANISHMENT << " AND "
-		                                  "(("
-		      << clientip << " & " << mask << " & `param`) = (`value` & `param` & " << mask
-		      << ")) AND "
-		         "`active` = 1 AND "
-		         "(`expires` >= "
-		      << currentTime << " OR `expires` = 0)";
-
-		if ((result = db->storeQuery(query.str())) != nullptr) {
-			int t = result->getDataInt("count");
-			db->freeResult(result);
-			return t > 0;
+		if (expires != 0) {
+			banExpiry.insert(std::make_pair(expires, std::make_pair(type, range)));
 		}
-		db->freeResult(result);
+		return;
 	}
 
-	return false;
+	case BANTYPE_BANISHMENT: {
+		BanValueMap::iterator it = banishments.find(value);
+		if (it != banishments.end()) {
+			it->second = longerBan(it->second, expires);
+		} else {
+			banishments[value] = expires;
+		}
+
+		if (expires != 0) {
+			banExpiry.insert(std::make_pair(expires, std::make_pair(type, IpRange(value, 0))));
+		}
+		return;
+	}
+
+	// these stay until they are removed
+	case BANTYPE_NAMELOCK:
+		map = &nameLocks;
+		break;
+
+	case BANTYPE_DELETION:
+		map = &deletions;
+		break;
+
+	default:
+		return;
+	}
+
+	(*map)[value] = expires;
 }
 
-bool BanManager::isNameLocked(std::string name) const
+void BanManager::removeFromIndex(BanType_t type, uint32_t value)
 {
-	Database* db = Database::instance();
-	DBResult* result;
-	DBQuery query;
+	switch (type) {
+	case BANTYPE_IP_BANISHMENT:
+		ipBans.erase(ipBans.lower_bound(IpRange(value, 0)),
+		             ipBans.upper_bound(IpRange(value, 0xFFFFFFFF)));
+		rebuildIpIndex();
+		break;
 
-	uint32_t _guid;
-	if (!IOPlayer::instance()->getGuidByName(_guid, name)) {
-		return false;
+	case BANTYPE_BANISHMENT:
+		banishments.erase(value);
+		break;
+
+	case BANTYPE_NAMELOCK:
+		nameLocks.erase(value);
+		break;
+
+	case BANTYPE_DELETION:
+		deletions.erase(value);
+		break;
+
+	default:
+		break;
 	}
+}
 
-	query << "SELECT `id` FROM `bans` WHERE `value` = " << _guid
-	      << " AND `type` = " << BANTYPE_NAMELOCK << " AND `active` = 1";
-	if (!(result = db->storeQuery(query.str()))) {
-		return false;
+void BanManager::removeExpiredBans() const
+{
+	// a ban that was extended or removed meanwhile leaves a stale entry,
+	// it only counts if the expiry still matches
+	uint32_t currentTime = std::time(nullptr);
+	bool ipChanged = false;
+
+	BanExpiryMap::iterator it = banExpiry.begin();
+	while (it != banExpiry.end() && it->first < currentTime) {
+		if (it->second.first == BANTYPE_IP_BANISHMENT) {
+			IpBanMap::iterator ban = ipBans.find(it->second.second);
+			if (ban != ipBans.end() && ban->second == it->first) {
+				ipBans.erase(ban);
+				ipChanged = true;
+			}
+		} else {
+			BanValueMap::iterator ban = banishments.find(it->second.second.first);
+			if (ban != banishments.end() && ban->second == it->first) {
+				banishments.erase(ban);
+			}
+		}
+
+		banExpiry.erase(it++);
 	}
 
-	db->freeResult(result);
-	return true;
+	if (ipChanged) {
+		rebuildIpIndex();
+	}
 }
 
-bool BanManager::isBanished(uint32_t account) const
+void BanManager::rebuildIpIndex() const
+{
+	ipBanTrie.clear();
+	ipBanOddMasks.clear();
+
+	for (IpBanMap::const_iterator it = ipBans.begin(); it != ipBans.end(); ++it) {
+		uint32_t mask = ntohl(it->first.second);
+		uint32_t prefixLength;
+		if (getPrefixLength(mask, prefixLength)) {
+			ipBanTrie.add(ntohl(it->first.first) & mask, prefixLength);
+		} else {
+			ipBanOddMasks.push_back(it->first);
+		}
+	}
+}
+
+bool BanManager::clearTemporaryBans()
 {
 	Database* db = Database::instance();
-	DBResult* result;
 	DBQuery query;
+	query << "UPDATE `bans` SET `active` = 0 WHERE `expires` = 0";
+	if (!db->executeQuery(query.str())) {
+		return false;
+	}
 
-	query << "SELECT `expires` FROM `bans` WHERE `value` = " << account
-	      << " AND `type` = " << BANTYPE_BANISHMENT << " AND `active` = 1";
-	if (!(result = db->storeQuery(query.str()))) {
+	loadBans();
+	return true;
+}
+
+bool BanManager::isIpBanished(uint32_t clientip, uint32_t mask /*= 0xFFFFFFFF*/) const
+{
+	if (clientip == 0) {
 		return false;
 	}
 
-	uint64_t expires = result->getDataInt("expires");
-	db->freeResult(result);
-	if (expires == 0 || (uint64_t)time(nullptr) <= expires) {
-		return true;
+	boost::recursive_mutex::scoped_lock lockClass(banLock);
+	removeExpiredBans();
+
+	// same test as (ip & mask & param) = (value & mask & param)
+	if (mask == 0xFFFFFFFF) {
+		if (ipBanTrie.contains(ntohl(clientip))) {
+			return true;
+		}
+
+		for (std::vector<IpRange>::const_iterator it = ipBanOddMasks.begin();
+		     it != ipBanOddMasks.end(); ++it) {
+			if (((clientip ^ it->first) & it->second) == 0) {
+				return true;
+			}
+		}
+		return false;
 	}
 
+	for (IpBanMap::const_iterator it = ipBans.begin(); it != ipBans.end(); ++it) {
+		if (((clientip ^ it->first.first) & it->first.second & mask) == 0) {
+			return true;
+		}
+	}
 	return false;
 }
 
-bool BanManager::isDeleted(uint32_t account) const
+bool BanManager::isNameLocked(std::string name) const
 {
-	Database* db = Database::instance();
-	DBResult* result;
-	DBQuery query;
-
-	query << "SELECT `id` FROM `bans` WHERE `value` = " << account
-	      << " AND `type` = " << BANTYPE_DELETION << " AND `active` = 1";
-	if (!(result = db->storeQuery(query.str()))) {
+	uint32_t _guid;
+	if (!IOPlayer::instance()->getGuidByName(_guid, name)) {
 		return false;
 	}
 
-	db->freeResult(result);
-	return true;
+	return isNameLocked(_guid);
+}
+
+bool BanManager::isNameLocked(uint32_t guid) const
+{
+	boost::recursive_mutex::scoped_lock lockClass(banLock);
+	return nameLocks.find(guid) != nameLocks.end();
+}
+
+bool BanManager::isBanished(uint32_t account) const
+{
+	boost::recursive_mutex::scoped_lock lockClass(banLock);
+	removeExpiredBans();
+	return banishments.find(account) != banishments.end();
+}
+
+bool BanManager::isDeleted(uint32_t account) const
+{
+	boost::recursive_mutex::scoped_lock lockClass(banLock);
+	return deletions.find(account) != deletions.end();
 }
 
 bool BanManager::isIpDisabled(uint32_t clientip) const
@@ -257,6 +457,10 @@ void BanManager::addIpBanishment(uint32_t ip, uint32_t time, uint32_t adminId, s
 	if (!stmt.execute()) {
 		return;
 	}
+
+	boost::recursive_mutex::scoped_lock lockClass(banLock);
+	addToIndex(BANTYPE_IP_BANISHMENT, ip, 0xFFFFFFFF, time);
+	rebuildIpIndex();
 }
 
 void BanManager::addNamelock(std::string name, uint32_t adminId, std::string reason, std::string comment)
@@ -282,6 +486,9 @@ void BanManager::addNamelock(std::string name, uint32_t adminId, std::string rea
 	if (!stmt.execute()) {
 		return;
 	}
+
+	boost::recursive_mutex::scoped_lock lockClass(banLock);
+	addToIndex(BANTYPE_NAMELOCK, _guid, 0, 0xFFFFFFFF);
 }
 
 void BanManager::addBanishment(std::string name, uint32_t time, uint32_t adminId, std::string reason, std::string comment)
@@ -307,6 +514,9 @@ void BanManager::addBanishment(std::string name, uint32_t time, uint32_t adminId
 	if (!stmt.execute()) {
 		return;
 	}
+
+	boost::recursive_mutex::scoped_lock lockClass(banLock);
+	addToIndex(BANTYPE_BANISHMENT, account, 0, time);
 }
 
 void BanManager::addDeletion(std::string name, uint32_t adminId, std::string reason, std::string comment)
@@ -331,6 +541,9 @@ void BanManager::addDeletion(std::string name, uint32_t adminId, std::string rea
 	if (!stmt.execute()) {
 		return;
 	}
+
+	boost::recursive_mutex::scoped_lock lockClass(banLock);
+	addToIndex(BANTYPE_DELETION, account, 0, 0xFFFFFFFF);
 }
 
 void BanManager::addNotation(std::string name, uint32_t adminId, std::string reason, std::string comment)
@@ -363,7 +576,13 @@ bool BanManager::removeIpBanishment(uint32_t ip)
 	DBQuery query;
 	query << "UPDATE `bans` SET `active` = 0 WHERE `type` = " << BANTYPE_IP_BANISHMENT
 	      << " AND `value` = " << ip << " AND `active` = 1";
-	return db->executeQuery(query.str());
+	if (!db->executeQuery(query.str())) {
+		return false;
+	}
+
+	boost::recursive_mutex::scoped_lock lockClass(banLock);
+	removeFromIndex(BANTYPE_IP_BANISHMENT, ip);
+	return true;
 }
 
 bool BanManager::removeNamelock(std::string name)
@@ -377,7 +596,13 @@ bool BanManager::removeNamelock(std::string name)
 	DBQuery query;
 	query << "UPDATE `bans` SET `active` = 0 WHERE `value` = " << _guid
 	      << " AND `type` = " << BANTYPE_NAMELOCK << " AND `active` = 1";
-	return db->executeQuery(query.str());
+	if (!db->executeQuery(query.str())) {
+		return false;
+	}
+
+	boost::recursive_mutex::scoped_lock lockClass(banLock);
+	removeFromIndex(BANTYPE_NAMELOCK, _guid);
+	return true;
 }
 
 bool BanManager::removeBanishment(std::string name)
@@ -391,7 +616,13 @@ bool BanManager::removeBanishment(std::string name)
 	DBQuery query;
 	query << "UPDATE `bans` SET `active` = 0 WHERE `value` = " << account
 	      << " AND `type` = " << BANTYPE_BANISHMENT << " AND `active` = 1";
-	return db->executeQuery(query.str());
+	if (!db->executeQuery(query.str())) {
+		return false;
+	}
+
+	boost::recursive_mutex::scoped_lock lockClass(banLock);
+	removeFromIndex(BANTYPE_BANISHMENT, account);
+	return true;
 }
 
 bool BanManager::removeDeletion(std::string name)
@@ -405,7 +636,13 @@ bool BanManager::removeDeletion(std::string name)
 	DBQuery query;
 	query << "UPDATE `bans` SET `active` = 0 WHERE `value` = " << account
 	      << " AND `type` = " << BANTYPE_DELETION << " AND `active` = 1";
-	return db->executeQuery(query.str());
+	if (!db->executeQuery(query.str())) {
+		return false;
+	}
+
+	boost::recursive_mutex::scoped_lock lockClass(banLock);
+	removeFromIndex(BANTYPE_DELETION, account);
+	return true;
 }
 
 bool BanManager::removeNotations(std::string name)
@@ -25,6 +25,8 @@
 
 #include <boost/thread.hpp>
 #include <list>
+#include <map>
+#include <unordered_map>
 #include <vector>
 
 struct LoginBlock {
@@ -53,6 +55,27 @@ struct Ban {
 	std::string reason, comment, value, param;
 };
 
+/** Binary prefix tree over IP ranges given as address and prefix length,
+  * both in host byte order. A lookup walks at most 32 nodes.
+  */
+class IpBanTrie
+{
+public:
+	IpBanTrie();
+
+	void clear();
+	void add(uint32_t ip, uint32_t prefixLength);
+	bool contains(uint32_t ip) const;
+
+protected:
+	struct Node {
+		uint32_t child[2];
+		bool banned;
+	};
+
+	std::vector<Node> m_nodes;
+};
+
 class BanManager
 {
 public:
@@ -60,10 +83,12 @@ public:
 	~BanManager();
 
 	void loadSettings();
+	void loadBans();
 	bool clearTemporaryBans();
 
 	bool isIpBanished(uint32_t ip, uint32_t mask = 0xFFFFFFFF) const;
 	bool isNameLocked(std::string name) const;
+	bool isNameLocked(uint32_t guid) const;
 	bool isBanished(uint32_t account) const;
 	bool isDeleted(uint32_t account) const;
 	bool isIpDisabled(uint32_t clientip) const;
@@ -89,6 +114,28 @@ public:
 	std::vector<Ban> getBans(BanType_t type) const;
 
 protected:
+	// ip and mask in network byte order, as stored in `bans`
+	typedef std::pair<uint32_t, uint32_t> IpRange;
+	typedef std::map<IpRange, uint32_t> IpBanMap;
+	// value (account or player id) -> expires
+	typedef std::unordered_map<uint32_t, uint32_t> BanValueMap;
+	typedef std::multimap<uint32_t, std::pair<BanType_t, IpRange>> BanExpiryMap;
+
+	void addToIndex(BanType_t type, uint32_t value, uint32_t param, uint32_t expires);
+	void removeFromIndex(BanType_t type, uint32_t value);
+	void removeExpiredBans() const;
+	void rebuildIpIndex() const;
+
+	// active bans, checked without touching the database
+	mutable IpBanMap ipBans;
+	mutable IpBanTrie ipBanTrie;
+	mutable std::vector<IpRange> ipBanOddMasks;
+	mutable BanValueMap banishments;
+	BanValueMap nameLocks;
+	BanValueMap deletions;
+	// bans that run out, by expiry time
+	mutable BanExpiryMap banExpiry;
+
 	IpLoginMap ipLoginMap;
 	IpConnectMap ipConnectMap;
 
@@ -11,15 +11,20 @@ typedef boost::tokenizer<boost::char_separator<char>> tokenizer;
 #include "ban.h"
 #include "commands.h"
 #include "configmanager.h"
+#include "databasepool.h"
+#include "databasetasks.h"
 #include "game.h"
 #include "globalevent.h"
 #include "house.h"
 #include "ioplayer.h"
+#include "luachunkcache.h"
 #include "monsters.h"
 #include "movement.h"
 #include "npc.h"
 #include "player.h"
+#include "querystats.h"
 #include "raids.h"
+#include "scriptprofiler.h"
 #include "spells.h"
 #include "spells.h"
 #include "talkaction.h"
@@ -89,6 +94,8 @@ s_defcommands Commands::defined_commands[] = { { "/s", &Commands::placeNpc },
 	                                       { "!online", &Commands::whoIsOnline },
 	                                       { "!frags", &Commands::playerKills },
 	                                       { "/refreshmap", &Commands::refreshMap },
+	                                       { "/querystats", &Commands::queryStats },
+	                                       { "/scriptprofile", &Commands::scriptProfile },
 #ifdef __ENABLE_SERVER_DIAGNOSTIC__
 	                                       { "/serverdiag", &Commands::serverDiag }
 #endif
@@ -857,6 +864,54 @@ bool Commands::serverInfo(Creature* creature, const std::string& cmd, const std:
 	return true;
 }
 
+bool Commands::queryStats(Creature* creature, const std::string& cmd, const std::string& param)
+{
+	Player* player = creature->getPlayer();
+	if (!player) return false;
+
+	if (param == "reset") {
+		QueryStats::getInstance().reset();
+		player->sendTextMessage(MSG_STATUS_CONSOLE_BLUE, "Query statistics cleared.");
+		return true;
+	}
+
+	std::stringstream text;
+	QueryStats::getInstance().write(text, 10, false);
+	player->sendTextMessage(MSG_STATUS_CONSOLE_BLUE, text.str().c_str());
+
+	return true;
+}
+
+bool Commands::scriptProfile(Creature* creature, const std::string& cmd, const std::string& param)
+{
+	Player* player = creature->getPlayer();
+	if (!player) return false;
+
+	ScriptProfiler& profiler = ScriptProfiler::getInstance();
+	if (param == "start") {
+		profiler.setEnabled(true);
+		player->sendTextMessage(MSG_STATUS_CONSOLE_BLUE, "Script profiler started.");
+	} else if (param == "stop") {
+		profiler.setEnabled(false);
+		player->sendTextMessage(MSG_STATUS_CONSOLE_BLUE, "Script profiler stopped.");
+	} else if (param == "reset") {
+		profiler.reset();
+		player->sendTextMessage(MSG_STATUS_CONSOLE_BLUE, "Script profile cleared.");
+	} else if (param == "dump") {
+		if (profiler.dump()) {
+			player->sendTextMessage(MSG_STATUS_CONSOLE_BLUE, "Script profile written.");
+		} else {
+			player->sendCancel("Could not write the script profile.");
+		}
+	} else {
+		std::stringstream text;
+		profiler.write(text, 10);
+		player->sendTextMessage(MSG_STATUS_CONSOLE_BLUE, text.str().c_str());
+	}
+
+	return true;
+}
+
 #ifdef __ENABLE_SERVER_DIAGNOSTIC__
 bool Commands::serverDiag(Creature* creature, const std::string& cmd, const std::string& param)
 {
@@ -878,6 +933,20 @@ bool Commands::serverDiag(Creature* creature, const std::string& cmd, const std:
 	text << "ProtocolLogin: " << ProtocolLogin::protocolLoginCount << "\n";
 	text << "ProtocolStatus: " << ProtocolStatus::protocolStatusCount << "\n\n";
 
+	const LoginStats& logins = ProtocolGame::loginStats;
+	const char* phaseNames[LoginStats::LAST] = {"queue", "database", "dispatcher"};
+	text << "\nLogins: " << logins.count << "\n";
+	text << "--------------------\n";
+	text << "Waiting db tasks: " << DatabaseTasks::getInstance().getQueueSize() << "\n";
+	uint32_t openConnections, idleConnections;
+	DatabasePool::getInstance().getStats(openConnections, idleConnections);
+	text << "Pooled db connections: " << openConnections << " (" << idleConnections << " idle)\n";
+	for (int32_t i = 0; i < LoginStats::LAST; ++i) {
+		text << phaseNames[i] << ": avg "
+		     << (logins.count ? logins.total[i] / logins.count : 0) << " ms, max "
+		     << logins.max[i] << " ms\n";
+	}
+
 	text << "\nConnections:\n";
 	text << "--------------------\n";
 	text << "Active connections: " << Connection::connectionCount << "\n";
@@ -891,6 +960,12 @@ bool Commands::serverDiag(Creature* creature, const std::string& cmd, const std:
 	text << "libxml: " << XML_DEFAULT_VERSION << "\n";
 	text << "lua: " << LUA_VERSION << "\n";
 
+	uint32_t compiledChunks, cachedChunks;
+	uint64_t chunkMicros;
+	LuaChunkCache::getInstance().getStats(compiledChunks, cachedChunks, chunkMicros);
+	text << "lua chunks: " << compiledChunks << " compiled, " << cachedChunks << " from cache, "
+	     << chunkMicros / 1000 << " ms loading\n";
+
 	// TODO: more information that could be useful
 
 	player->sendTextMessage(MSG_STATUS_CONSOLE_BLUE, text.str().c_str());
@@ -78,6 +78,8 @@ protected:
 	bool getHouse(Creature* creature, const std::string& cmd, const std::string& param);
 	// bool bansManager(Creature* creature, const std::string& cmd, const std::string& param);
 	bool serverInfo(Creature* creature, const std::string& cmd, const std::string& param);
+	bool queryStats(Creature* creature, const std::string& cmd, const std::string& param);
+	bool scriptProfile(Creature* creature, const std::string& cmd, const std::string& param);
 	bool forceRaid(Creature* creature, const std::string& cmd, const std::string& param);
 	bool whoIsOnline(Creature* creature, const std::string& cmd, const std::string& param);
 	bool goUp(Creature* creature, const std::string& cmd, const std::string& param);
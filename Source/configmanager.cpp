@@ -96,6 +96,20 @@ bool ConfigManager::loadFile(const std::string& _filename)
 		m_confString[SQL_DB] = getGlobalString(L, "SQL_DB");
 		m_confString[SQL_TYPE] = getGlobalString(L, "SQL_Type");
 		m_confInteger[SQL_PORT] = getGlobalNumber(L, "SQL_Port");
+		m_confString[SQLITE_JOURNAL_MODE] = getGlobalString(L, "SQLite_JournalMode", "wal");
+		m_confString[SQLITE_SYNCHRONOUS] = getGlobalString(L, "SQLite_Synchronous", "normal");
+		m_confInteger[SQLITE_CACHE_SIZE] = getGlobalNumber(L, "SQLite_CacheSize", 2000);
+		m_confInteger[DATABASE_WORKERS] = getGlobalNumber(L, "DatabaseWorkers", 1);
+		m_confInteger[SQL_POOL_SIZE] = getGlobalNumber(L, "SQL_PoolSize", 4);
+		m_confInteger[SQL_POOL_WAIT] = getGlobalNumber(L, "SQL_PoolWait", 1000);
+		m_confInteger[SQL_POOL_KEEPALIVE] = getGlobalNumber(L, "SQL_PoolKeepAlive", 300);
+		m_confInteger[NPC_SCRIPT_THREADS] = getGlobalNumber(L, "NpcScriptThreads", 0);
+		m_confInteger[PLAYER_ITEM_BLOBS] = getGlobalBoolean(L, "PlayerItemBlobs", false);
+		m_confInteger[QUERYSTATS_DUMP_INTERVAL] = getGlobalNumber(L, "QueryStatsDumpInterval", 0);
+		m_confInteger[PLAYER_JOURNAL] = getGlobalBoolean(L, "PlayerJournal", false);
+		m_confString[PLAYER_JOURNAL_FILE] = getGlobalString(L, "PlayerJournalFile", "player.journal");
+		m_confInteger[PLAYER_JOURNAL_INTERVAL] = getGlobalNumber(L, "PlayerJournalInterval", 1000);
+		m_confInteger[PLAYER_JOURNAL_COMPACT_INTERVAL] = getGlobalNumber(L, "PlayerJournalCompactInterval", 10);
 	}
 
 	m_confString[LOGIN_MSG] = getGlobalString(L, "LoginMsg", "Welcome.");
@@ -122,6 +136,7 @@ bool ConfigManager::loadFile(const std::string& _filename)
 	m_confInteger[MIN_ACTIONEXTIME] = getGlobalNumber(L, "MinActionExInterval", 1000);
 	m_confInteger[DEFAULT_DESPAWNRANGE] = getGlobalNumber(L, "DespawnRange", 2);
 	m_confInteger[DEFAULT_DESPAWNRADIUS] = getGlobalNumber(L, "DespawnRadius", 50);
+	m_confInteger[NPC_THINK_RANGE] = getGlobalNumber(L, "NpcThinkRange", 0);
 	m_confInteger[ALLOW_CLONES] = getGlobalBoolean(L, "AllowClones", false);
 	m_confInteger[RATE_EXPERIENCE] = getGlobalNumber(L, "RateExp", 1);
 	m_confInteger[RATE_SKILL] = getGlobalNumber(L, "RateSkill", 1);
@@ -164,6 +179,15 @@ bool ConfigManager::loadFile(const std::string& _filename)
 
 	m_confInteger[PASSWORD_TYPE] = PASSWORD_TYPE_PLAIN;
 	m_confInteger[STATUSQUERY_TIMEOUT] = getGlobalNumber(L, "StatusTimeout", 30 * 1000);
+	m_confInteger[STATUS_CACHE_TIME] = getGlobalNumber(L, "StatusCacheTime", 10 * 1000);
+	m_confInteger[STATUS_CACHE_PLAYERS] = getGlobalNumber(L, "StatusCachePlayers", 5);
+
+	m_confInteger[SLOW_QUERY_TIME] = getGlobalNumber(L, "SlowQueryTime", 250);
+	m_confString[QUERYSTATS_FILE] = getGlobalString(L, "QueryStatsFile", "querystats.txt");
+	m_confInteger[SCRIPT_PROFILER] = getGlobalBoolean(L, "ScriptProfiler", false);
+	m_confInteger[SCRIPT_PROFILER_SAMPLE_INTERVAL] = getGlobalNumber(L, "ScriptProfilerSampleInterval", 0);
+	m_confString[SCRIPT_PROFILER_FILE] = getGlobalString(L, "ScriptProfilerFile", "scriptprofile");
+	m_confInteger[LUA_CHUNK_CACHE] = getGlobalBoolean(L, "LuaChunkCache", true);
 
 	m_isLoaded = true;
 	return true;
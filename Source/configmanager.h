@@ -63,6 +63,11 @@ public:
 		SQL_PASS,
 		SQL_DB,
 		SQL_TYPE,
+		SQLITE_JOURNAL_MODE,
+		SQLITE_SYNCHRONOUS,
+		QUERYSTATS_FILE,
+		SCRIPT_PROFILER_FILE,
+		PLAYER_JOURNAL_FILE,
 		MAP_STORAGE_TYPE,
 		PREMIUM_ONLY_BEDS,
 		LAST_STRING_CONFIG /* this must be the last one */
@@ -85,6 +90,8 @@ public:
 		MIN_ACTIONEXTIME,
 		DEFAULT_DESPAWNRANGE,
 		DEFAULT_DESPAWNRADIUS,
+		NPC_THINK_RANGE,
+		NPC_SCRIPT_THREADS,
 		ALLOW_CLONES,
 		RATE_EXPERIENCE,
 		RATE_SKILL,
@@ -97,6 +104,8 @@ public:
 		PASSWORD_TYPE,
 		SQL_PORT,
 		STATUSQUERY_TIMEOUT,
+		STATUS_CACHE_TIME,
+		STATUS_CACHE_PLAYERS,
 		FRAG_TIME,
 		IDLE_TIME_KICK,
 		IDLE_TIME_WARNING,
@@ -122,6 +131,20 @@ public:
 		KICK_ON_LOGIN,
 		TEAM_MODE,
 		DAMAGE_PERCENT,
+		DATABASE_WORKERS,
+		SQL_POOL_SIZE,
+		SQL_POOL_WAIT,
+		SQL_POOL_KEEPALIVE,
+		PLAYER_ITEM_BLOBS,
+		SQLITE_CACHE_SIZE,
+		SLOW_QUERY_TIME,
+		SCRIPT_PROFILER,
+		SCRIPT_PROFILER_SAMPLE_INTERVAL,
+		LUA_CHUNK_CACHE,
+		QUERYSTATS_DUMP_INTERVAL,
+		PLAYER_JOURNAL,
+		PLAYER_JOURNAL_INTERVAL,
+		PLAYER_JOURNAL_COMPACT_INTERVAL,
 		LAST_INTEGER_CONFIG /* this must be the last one */
 	};
 
@@ -28,6 +28,9 @@
 #include "status.h"
 #include "tasks.h"
 
+#include <algorithm>
+#include <cstring>
+
 #include <boost/bind.hpp>
 
 #ifdef __ENABLE_SERVER_DIAGNOSTIC__
@@ -193,13 +196,26 @@ void Connection::deleteConnectionTask()
 
 void Connection::acceptConnection()
 {
-	// Read size of te first packet
+	readMore();
+}
+
+void Connection::readMore()
+{
+	// move the incomplete packet to the front so the tail has room for more
+	if (m_inStart > 0) {
+		std::memmove(&m_inBuffer[0], &m_inBuffer[m_inStart], m_inEnd - m_inStart);
+		m_inEnd -= m_inStart;
+		m_inStart = 0;
+	}
+
+	// Read whatever is available, it may hold several packets
 	m_pendingRead++;
-	boost::asio::async_read(m_socket, boost::asio::buffer(m_msg.getBuffer(), NetworkMessage::header_length),
-	                        boost::bind(&Connection::parseHeader, this, boost::asio::placeholders::error));
+	m_socket.async_read_some(boost::asio::buffer(&m_inBuffer[m_inEnd], m_inBuffer.size() - m_inEnd),
+	                         boost::bind(&Connection::onRead, this, boost::asio::placeholders::error,
+	                                     boost::asio::placeholders::bytes_transferred));
 }
 
-void Connection::parseHeader(const boost::system::error_code& error)
+void Connection::onRead(const boost::system::error_code& error, std::size_t bytesTransferred)
 {
 	m_connectionLock.lock();
 	m_pendingRead--;
@@ -210,36 +226,47 @@ void Connection::parseHeader(const boost::system::error_code& error)
 		return;
 	}
 
-	int32_t size = m_msg.decodeHeader();
-	if (!error && size > 0 && size < NETWORKMESSAGE_MAXSIZE - 16) {
-		// Read packet content
-		m_pendingRead++;
-		m_msg.setMessageLength(size + NetworkMessage::header_length);
-		boost::asio::async_read(m_socket, boost::asio::buffer(m_msg.getBodyBuffer(), size),
-		                        boost::bind(&Connection::parsePacket, this,
-		                                    boost::asio::placeholders::error));
+	if (!error) {
+		m_inEnd += bytesTransferred;
+		if (parseInput()) {
+			// Wait to the next packets
+			readMore();
+		}
 	} else {
 		handleReadError(error);
 	}
 	m_connectionLock.unlock();
 }
 
-void Connection::parsePacket(const boost::system::error_code& error)
+bool Connection::parseInput()
 {
-	m_connectionLock.lock();
-	m_pendingRead--;
-	if (m_closeState == CLOSE_STATE_CLOSING) {
-		if (!closingConnection()) {
-			m_connectionLock.unlock();
+	while (m_inEnd - m_inStart >= NetworkMessage::header_length) {
+		uint8_t* packet = &m_inBuffer[m_inStart];
+		const int32_t size = (int32_t)(packet[0] | packet[1] << 8);
+		if (size <= 0 || size >= NETWORKMESSAGE_MAXSIZE - 16) {
+			handleReadError(boost::system::error_code());
+			return false;
 		}
-		return;
-	}
 
-	if (!error) {
+		const std::size_t length = size + NetworkMessage::header_length;
+		if (m_inEnd - m_inStart < length) {
+			// make room for the rest of a packet larger than the buffer
+			if (m_inBuffer.size() < length) {
+				m_inBuffer.resize(std::min<std::size_t>(std::max(length, m_inBuffer.size() * 2),
+				                                        NETWORKMESSAGE_MAXSIZE));
+			}
+			return true;
+		}
+
+		m_inStart += length;
+
+		// The message reads the packet straight from the input buffer
+		NetworkMessage msg(packet, (int32_t)length);
+
 		// Protocol selection
 		if (!m_protocol) {
 			// Protocol depends on the first byte of the packet
-			uint8_t protocolId = m_msg.GetByte();
+			uint8_t protocolId = msg.GetByte();
 			switch (protocolId) {
 			case 0x01: // Login server protocol
 				m_protocol = new ProtocolLogin(this);
@@ -253,25 +280,26 @@ void Connection::parsePacket(const boost::system::error_code& error)
 			default:
 				// No valid protocol
 				closeConnection();
-				m_connectionLock.unlock();
-				return;
+				return false;
 				break;
 			}
-			m_protocol->onRecvFirstMessage(m_msg);
+			m_protocol->onRecvFirstMessage(msg);
 		} else {
 			// Send the packet to the current protocol
-			m_protocol->onRecvMessage(m_msg);
+			m_protocol->onRecvMessage(msg);
 		}
+	}
 
-		// Wait to the next packet
-		m_pendingRead++;
-		boost::asio::async_read(m_socket, boost::asio::buffer(m_msg.getBuffer(), NetworkMessage::header_length),
-		                        boost::bind(&Connection::parseHeader, this,
-		                                    boost::asio::placeholders::error));
-	} else {
-		handleReadError(error);
+	if (m_inStart == m_inEnd) {
+		m_inStart = 0;
+		m_inEnd = 0;
+
+		// give back the memory used by a large packet
+		if (m_inBuffer.size() > INPUT_BUFFER_SIZE) {
+			std::vector<uint8_t>(INPUT_BUFFER_SIZE).swap(m_inBuffer);
+		}
 	}
-	m_connectionLock.unlock();
+	return true;
 }
 
 void Connection::handleReadError(const boost::system::error_code& error)
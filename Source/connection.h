@@ -24,6 +24,8 @@
 #include "definitions.h"
 #include "networkmessage.h"
 
+#include <vector>
+
 #include <boost/asio.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/thread.hpp>
@@ -79,6 +81,10 @@ public:
 	       CLOSE_STATE_CLOSING = 2,
 	};
 
+	// initial size of the input buffer, it only grows while a larger packet
+	// is being received
+	enum { INPUT_BUFFER_SIZE = 512 };
+
 private:
 	Connection(boost::asio::io_service& io_service) : m_socket(io_service)
 	{
@@ -90,6 +96,9 @@ private:
 		m_socketClosed = false;
 		m_writeError = false;
 		m_readError = false;
+		m_inBuffer.resize(INPUT_BUFFER_SIZE);
+		m_inStart = 0;
+		m_inEnd = 0;
 
 #ifdef __ENABLE_SERVER_DIAGNOSTIC__
 		connectionCount++;
@@ -128,8 +137,9 @@ public:
 	}
 
 private:
-	void parseHeader(const boost::system::error_code& error);
-	void parsePacket(const boost::system::error_code& error);
+	void readMore();
+	void onRead(const boost::system::error_code& error, std::size_t bytesTransferred);
+	bool parseInput();
 
 	void onWriteOperation(OutputMessage_ptr msg, const boost::system::error_code& error);
 
@@ -143,7 +153,10 @@ private:
 
 	void internalSend(OutputMessage_ptr msg);
 
-	NetworkMessage m_msg;
+	// received bytes not yet handed to the protocol are [m_inStart, m_inEnd)
+	std::vector<uint8_t> m_inBuffer;
+	std::size_t m_inStart;
+	std::size_t m_inEnd;
 	boost::asio::ip::tcp::socket m_socket;
 	bool m_socketClosed;
 
@@ -20,6 +20,7 @@
 #include "otpch.h"
 
 #include "database.h"
+#include "databasepool.h"
 #include <string>
 
 #ifdef __USE_MYSQL__
@@ -46,29 +47,39 @@ Database* _Database::_instance = nullptr;
 
 Database* _Database::instance()
 {
+	if (Database* connection = DatabasePool::getThreadConnection()) {
+		return connection;
+	}
+
 	if (!_instance) {
+		_instance = createConnection();
+	}
+	return _instance;
+}
+
+Database* _Database::createConnection()
+{
 #if defined MULTI_SQL_DRIVERS
 #ifdef __USE_MYSQL__
-		if (g_config.getString(ConfigManager::SQL_TYPE) == "mysql")
-			_instance = new DatabaseMySQL;
+	if (g_config.getString(ConfigManager::SQL_TYPE) == "mysql")
+		return new DatabaseMySQL;
 #endif
 #ifdef __USE_ODBC__
-		if (g_config.getString(ConfigManager::SQL_TYPE) == "odbc")
-			_instance = new DatabaseODBC;
+	if (g_config.getString(ConfigManager::SQL_TYPE) == "odbc")
+		return new DatabaseODBC;
 #endif
 #ifdef __USE_SQLITE__
-		if (g_config.getString(ConfigManager::SQL_TYPE) == "sqlite")
-			_instance = new DatabaseSQLite;
+	if (g_config.getString(ConfigManager::SQL_TYPE) == "sqlite")
+		return new DatabaseSQLite;
 #endif
 #ifdef __USE_PGSQL__
-		if (g_config.getString(ConfigManager::SQL_TYPE) == "pgsql")
-			_instance = new DatabasePgSQL;
+	if (g_config.getString(ConfigManager::SQL_TYPE) == "pgsql")
+		return new DatabasePgSQL;
 #endif
+	return nullptr;
 #else
-		_instance = new Database;
+	return new Database;
 #endif
-	}
-	return _instance;
 }
 
 DBResult* _Database::verifyResult(DBResult* result)
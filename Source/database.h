@@ -10,26 +10,33 @@
 #define DATABASE_VIRTUAL virtual
 #define DATABASE_CLASS _Database
 #define DBRES_CLASS _DBResult
+#define DBSTMT_CLASS _DBStatement
 class _Database;
 class _DBResult;
+class _DBStatement;
 #else
 #define DATABASE_VIRTUAL
 #if defined(__USE_MYSQL__)
 #define DATABASE_CLASS DatabaseMySQL
 #define DBRES_CLASS MySQLResult
+#define DBSTMT_CLASS MySQLStatement
 class DatabaseMySQL;
 class MySQLResult;
+class MySQLStatement;
 
 #elif defined(__USE_SQLITE__)
 #define DATABASE_CLASS DatabaseSQLite
 #define DBRES_CLASS SQLiteResult
+#define DBSTMT_CLASS SQLiteStatement
 class DatabaseSQLite;
 class SQLiteResult;
+class SQLiteStatement;
 #endif
 #endif
 
 typedef DATABASE_CLASS Database;
 typedef DBRES_CLASS DBResult;
+typedef DBSTMT_CLASS DBStatement;
 
 class DBQuery;
 enum DBParam_t { DBPARAM_MULTIINSERT = 1 };
@@ -46,10 +53,23 @@ public:
 	* connection class internaly to make sure exacly one instance of connection is created for
 	* entire system.
 	*
-	* @return database connection handler singletor
+	* @return database connection handler singletor, or the connection the calling thread holds
+	* from DatabasePool
 	*/
 	static Database* instance();
 
+	/**
+	* Opens a new connection.
+	*
+	* Only for DatabasePool and the like, the caller owns it and has to delete it when done.
+	* Everything else must use instance().
+	*
+	* @return new connection handler, check isConnected() before use
+	*/
+	static Database* createConnection();
+
+	DATABASE_VIRTUAL ~_Database(){};
+
 	/**
 	* Database information.
 	*
@@ -75,6 +95,18 @@ public:
 		return m_connected;
 	}
 
+	/**
+	* Checks the connection.
+	*
+	* Drivers that talk to a server make a round trip and reconnect if it was lost.
+	*
+	* @return whether or not the database is connected afterwards
+	*/
+	DATABASE_VIRTUAL bool ping()
+	{
+		return m_connected;
+	}
+
 protected:
 	/**
 	* Transaction related methods.
@@ -128,6 +160,21 @@ public:
 		return nullptr;
 	}
 
+	/**
+	* Prepared statement.
+	*
+	* Returns statement for query with '?' in place of each parameter. Statements are prepared
+	* on first use and kept by the connection, so don't free them and ask the connection that
+	* will run them.
+	*
+	* @param std::string query with placeholders
+	* @return statement object (null on error)
+	*/
+	DATABASE_VIRTUAL DBStatement* getStatement(const std::string& query)
+	{
+		return nullptr;
+	}
+
 	/**
 	 * Returns ID of last inserted row
 	 *
@@ -198,13 +245,15 @@ public:
 	}
 
 protected:
-	_Database() : m_connected(false){};
-	DATABASE_VIRTUAL ~_Database(){};
+	_Database() : m_connected(false), m_transactionDepth(0){};
 
 	DBResult* verifyResult(DBResult* result);
 
 	bool m_connected;
 
+	// DBTransactions open on this connection, nested ones run as savepoints
+	uint32_t m_transactionDepth;
+
 private:
 	static Database* _instance;
 };
@@ -259,10 +308,77 @@ public:
 		return false;
 	}
 
+	/**
+	* Reads the remaining rows into memory, from then on the result does not need its
+	* connection: another thread can read and free it, even after the connection is gone.
+	*/
+	DATABASE_VIRTUAL void detach() {}
+
 protected:
 	DATABASE_VIRTUAL ~_DBResult(){};
 };
 
+class _DBStatement
+{
+public:
+	/** Bind an Integer to the next parameter
+	*\return true on success
+	*\param value The value to bind
+	*/
+	DATABASE_VIRTUAL bool bindInt(int64_t value)
+	{
+		return false;
+	}
+	/** Bind a String to the next parameter
+	*\return true on success
+	*\param value The value to bind, copied
+	*/
+	DATABASE_VIRTUAL bool bindString(const std::string& value)
+	{
+		return false;
+	}
+	/** Bind a blob to the next parameter
+	*\return true on success
+	*\param value The data to bind, copied
+	*\param length Size of the data
+	*/
+	DATABASE_VIRTUAL bool bindBlob(const char* value, uint32_t length)
+	{
+		return false;
+	}
+
+	/** Drops the parameters bound so far, getStatement() does this before
+	* handing out a statement so a caller that bailed out between binding and
+	* executing can not leave its values to the next one.
+	*/
+	DATABASE_VIRTUAL void reset() {}
+
+	/**
+	* Executes statement which doesn't generate results with the bound parameters and clears them.
+	*
+	* @return true on success, false on error or if a bind failed
+	*/
+	DATABASE_VIRTUAL bool executeQuery()
+	{
+		return false;
+	}
+
+	/**
+	* Executes statement which generates results with the bound parameters.
+	*
+	* The result has to be freed before the statement is used again.
+	*
+	* @return results object (null on error or if there are no rows)
+	*/
+	DATABASE_VIRTUAL DBResult* storeQuery()
+	{
+		return nullptr;
+	}
+
+protected:
+	DATABASE_VIRTUAL ~_DBStatement(){};
+};
+
 /**
  * Thread locking hack.
  *
@@ -349,35 +465,66 @@ public:
 	{
 		m_database = database;
 		m_state = STATE_NO_START;
+		m_depth = 0;
 	}
 
 	~DBTransaction()
 	{
 		if (m_state == STATE_START) {
-			m_database->rollback();
+			if (m_depth == 0) {
+				m_database->rollback();
+			} else {
+				m_database->executeQuery("ROLLBACK TO SAVEPOINT " + getSavepoint());
+				m_database->executeQuery("RELEASE SAVEPOINT " + getSavepoint());
+			}
+			--m_database->m_transactionDepth;
 		}
 	}
 
+	/**
+	* Starts the transaction.
+	*
+	* Inside another transaction on the same connection this only sets a savepoint, its
+	* commit then waits for the outer one and its rollback undoes just its own part.
+	*/
 	bool begin()
 	{
 		m_state = STATE_START;
-		return m_database->beginTransaction();
+		m_depth = m_database->m_transactionDepth++;
+		if (m_depth == 0) {
+			return m_database->beginTransaction();
+		}
+
+		return m_database->executeQuery("SAVEPOINT " + getSavepoint());
 	}
 
 	bool commit()
 	{
 		if (m_state == STATE_START) {
 			m_state = STEATE_COMMIT;
-			return m_database->commit();
+			--m_database->m_transactionDepth;
+			if (m_depth == 0) {
+				return m_database->commit();
+			}
+
+			return m_database->executeQuery("RELEASE SAVEPOINT " + getSavepoint());
 		} else {
 			return false;
 		}
 	}
 
 private:
+	std::string getSavepoint() const
+	{
+		std::ostringstream name;
+		name << "transaction" << m_depth;
+		return name.str();
+	}
+
 	enum TransactionStates_t { STATE_NO_START, STATE_START, STEATE_COMMIT };
 	TransactionStates_t m_state;
 	Database* m_database;
+	uint32_t m_depth;
 };
 
 #endif
@@ -20,6 +20,7 @@
 
 #include "otpch.h"
 
+#include <cstring>
 #include <iostream>
 
 #if defined __WINDOWS__ || defined WIN32
@@ -28,10 +29,13 @@
 
 #include "database.h"
 #include "databasemysql.h"
+#include "querystats.h"
 #ifdef __MYSQL_ALT_INCLUDE__
 #include "errmsg.h"
+#include "mysqld_error.h"
 #else
 #include <mysql/errmsg.h>
+#include <mysql/mysqld_error.h>
 #endif
 
 #include "configmanager.h"
@@ -80,6 +84,10 @@ DatabaseMySQL::DatabaseMySQL()
 
 DatabaseMySQL::~DatabaseMySQL()
 {
+	for (StatementMap::iterator it = m_statements.begin(); it != m_statements.end(); ++it) {
+		delete it->second;
+	}
+
 	mysql_close(&m_handle);
 }
 
@@ -93,6 +101,13 @@ bool DatabaseMySQL::getParam(DBParam_t param)
 	}
 }
 
+bool DatabaseMySQL::ping()
+{
+	// reconnects on its own if the server went away
+	m_connected = (mysql_ping(&m_handle) == 0);
+	return m_connected;
+}
+
 bool DatabaseMySQL::beginTransaction()
 {
 	return executeQuery("BEGIN");
@@ -133,6 +148,8 @@ bool DatabaseMySQL::executeQuery(const std::string& query)
 {
 	if (!m_connected) return false;
 
+	DBQueryTimer timer(query.c_str());
+
 #ifdef __DEBUG_SQL__
 	std::cout << "MYSQL QUERY: " << query << std::endl;
 #endif
@@ -165,6 +182,8 @@ DBResult* DatabaseMySQL::storeQuery(const std::string& query)
 {
 	if (!m_connected) return NULL;
 
+	DBQueryTimer timer(query.c_str());
+
 #ifdef __DEBUG_SQL__
 	std::cout << "MYSQL QUERY: " << query << std::endl;
 #endif
@@ -202,6 +221,26 @@ DBResult* DatabaseMySQL::storeQuery(const std::string& query)
 	return verifyResult(res);
 }
 
+DBStatement* DatabaseMySQL::getStatement(const std::string& query)
+{
+	if (!m_connected) return NULL;
+
+	StatementMap::iterator it = m_statements.find(query);
+	if (it != m_statements.end()) {
+		it->second->reset();
+		return it->second;
+	}
+
+	MySQLStatement* statement = new MySQLStatement(this, query);
+	if (!statement->prepare()) {
+		delete statement;
+		return NULL;
+	}
+
+	m_statements[query] = statement;
+	return statement;
+}
+
 uint64_t DatabaseMySQL::getLastInsertedRowID()
 {
 	return (uint64_t)mysql_insert_id(&m_handle);
@@ -288,7 +327,7 @@ const char* MySQLResult::getDataStream(const std::string& s, unsigned long& size
 			size = 0;
 			return NULL;
 		} else {
-			size = mysql_fetch_lengths(m_handle)[it->second];
+			size = m_lengths[it->second];
 			return m_row[it->second];
 		}
 	}
@@ -300,13 +339,37 @@ const char* MySQLResult::getDataStream(const std::string& s, unsigned long& size
 
 bool MySQLResult::next()
 {
+	if (m_statement) {
+		int ret = mysql_stmt_fetch(m_statement);
+		if (ret != 0 && ret != MYSQL_DATA_TRUNCATED) {
+			return false;
+		}
+
+		for (size_t i = 0; i < m_rowData.size(); ++i) {
+			if (m_columnNulls[i]) {
+				m_rowData[i] = NULL;
+			} else {
+				m_buffers[i][std::min<size_t>(m_columnLengths[i], m_buffers[i].size() - 1)] = '\0';
+				m_rowData[i] = &m_buffers[i][0];
+			}
+		}
+
+		m_row = m_rowData.empty() ? NULL : &m_rowData[0];
+		m_lengths = m_columnLengths.empty() ? NULL : &m_columnLengths[0];
+		return true;
+	}
+
 	m_row = mysql_fetch_row(m_handle);
+	m_lengths = mysql_fetch_lengths(m_handle);
 	return m_row != NULL;
 }
 
 MySQLResult::MySQLResult(MYSQL_RES* res)
 {
 	m_handle = res;
+	m_row = NULL;
+	m_lengths = NULL;
+	m_statement = NULL;
 	m_listNames.clear();
 
 	MYSQL_FIELD* field;
@@ -317,7 +380,239 @@ MySQLResult::MySQLResult(MYSQL_RES* res)
 	}
 }
 
+MySQLResult::MySQLResult(MYSQL_STMT* stmt, MYSQL_RES* metadata)
+{
+	m_handle = NULL;
+	m_row = NULL;
+	m_lengths = NULL;
+	m_statement = stmt;
+
+	uint32_t fields = mysql_num_fields(metadata);
+	m_columns.resize(fields);
+	m_buffers.resize(fields);
+	m_columnLengths.resize(fields);
+	m_columnNulls.resize(fields);
+	m_rowData.resize(fields);
+	if (fields == 0) {
+		return;
+	}
+
+	memset(&m_columns[0], 0, sizeof(MYSQL_BIND) * fields);
+
+	MYSQL_FIELD* field;
+	int32_t i = 0;
+	while ((field = mysql_fetch_field(metadata))) {
+		m_listNames[field->name] = i;
+
+		// everything is fetched as text like mysql_fetch_row does, max_length
+		// is only known for the stored values of non numeric columns
+		unsigned long size = IS_NUM(field->type) ? 64 : field->max_length;
+		m_buffers[i].resize(size + 1);
+
+		m_columns[i].buffer_type = IS_NUM(field->type) ? MYSQL_TYPE_STRING : MYSQL_TYPE_BLOB;
+		m_columns[i].buffer = &m_buffers[i][0];
+		m_columns[i].buffer_length = size;
+		m_columns[i].length = &m_columnLengths[i];
+		m_columns[i].is_null = &m_columnNulls[i];
+		i++;
+	}
+
+	mysql_stmt_bind_result(m_statement, &m_columns[0]);
+}
+
 MySQLResult::~MySQLResult()
 {
-	mysql_free_result(m_handle);
+	if (m_statement) {
+		mysql_stmt_free_result(m_statement);
+	} else {
+		mysql_free_result(m_handle);
+	}
+}
+
+/** MySQLStatement definitions */
+
+MySQLStatement::MySQLStatement(DatabaseMySQL* database, const std::string& query)
+{
+	m_database = database;
+	m_handle = NULL;
+	m_query = query;
+}
+
+MySQLStatement::~MySQLStatement()
+{
+	if (m_handle) {
+		mysql_stmt_close(m_handle);
+	}
+}
+
+bool MySQLStatement::prepare()
+{
+	if (m_handle) {
+		mysql_stmt_close(m_handle);
+	}
+
+	m_handle = mysql_stmt_init(&m_database->m_handle);
+	if (!m_handle) {
+		std::cout << "mysql_stmt_init(): MYSQL ERROR: " << mysql_error(&m_database->m_handle)
+		          << std::endl;
+		return false;
+	}
+
+	if (mysql_stmt_prepare(m_handle, m_query.c_str(), m_query.length()) != 0) {
+		std::cout << "mysql_stmt_prepare(): " << m_query
+		          << ": MYSQL ERROR: " << mysql_stmt_error(m_handle) << std::endl;
+		mysql_stmt_close(m_handle);
+		m_handle = NULL;
+		return false;
+	}
+
+	// lets the results size their buffers for the longest value
+	my_bool updateMaxLength = true;
+	mysql_stmt_attr_set(m_handle, STMT_ATTR_UPDATE_MAX_LENGTH, &updateMaxLength);
+	return true;
+}
+
+bool MySQLStatement::bindInt(int64_t value)
+{
+	Param param;
+	param.type = MYSQL_TYPE_LONGLONG;
+	param.number = value;
+	m_params.push_back(param);
+	return true;
+}
+
+bool MySQLStatement::bindString(const std::string& value)
+{
+	Param param;
+	param.type = MYSQL_TYPE_STRING;
+	param.number = 0;
+	param.data = value;
+	m_params.push_back(param);
+	return true;
+}
+
+bool MySQLStatement::bindBlob(const char* value, uint32_t length)
+{
+	Param param;
+	param.type = MYSQL_TYPE_BLOB;
+	param.number = 0;
+	param.data.assign(value, length);
+	m_params.push_back(param);
+	return true;
+}
+
+void MySQLStatement::reset()
+{
+	m_params.clear();
+}
+
+bool MySQLStatement::execute()
+{
+	std::vector<MYSQL_BIND> params(m_params.size());
+	if (!params.empty()) {
+		memset(&params[0], 0, sizeof(MYSQL_BIND) * params.size());
+	}
+
+	for (size_t i = 0; i < m_params.size(); ++i) {
+		params[i].buffer_type = m_params[i].type;
+		if (m_params[i].type == MYSQL_TYPE_LONGLONG) {
+			params[i].buffer = &m_params[i].number;
+		} else {
+			params[i].buffer = (void*)m_params[i].data.data();
+			params[i].buffer_length = m_params[i].data.length();
+		}
+	}
+
+	bool state = false;
+	// a reconnect drops the statements of the old connection, prepare it again once
+	for (int32_t attempt = 0; attempt < 2 && !state; ++attempt) {
+		if (!m_handle && !prepare()) {
+			break;
+		}
+
+#ifdef __DEBUG_SQL__
+		std::cout << "MYSQL STATEMENT: " << m_query << std::endl;
+#endif
+
+		if ((params.empty() || !mysql_stmt_bind_param(m_handle, &params[0])) &&
+		    mysql_stmt_execute(m_handle) == 0) {
+			state = true;
+			break;
+		}
+
+		std::cout << "mysql_stmt_execute(): " << m_query
+		          << ": MYSQL ERROR: " << mysql_stmt_error(m_handle) << std::endl;
+		int error = mysql_stmt_errno(m_handle);
+		if (error != CR_SERVER_LOST && error != CR_SERVER_GONE_ERROR &&
+		    error != ER_UNKNOWN_STMT_HANDLER) {
+			break;
+		}
+
+		if (mysql_ping(&m_database->m_handle) != 0) {
+			m_database->m_connected = false;
+			break;
+		}
+
+		mysql_stmt_close(m_handle);
+		m_handle = NULL;
+	}
+
+	m_params.clear();
+	return state;
+}
+
+bool MySQLStatement::executeQuery()
+{
+	if (!m_database->m_connected) {
+		m_params.clear();
+		return false;
+	}
+
+	DBQueryTimer timer(m_query.c_str());
+
+	bool state = execute();
+
+	// same as executeQuery('SELECT...'), drop whatever was returned
+	if (m_handle) {
+		mysql_stmt_free_result(m_handle);
+	}
+
+	return state;
+}
+
+DBResult* MySQLStatement::storeQuery()
+{
+	if (!m_database->m_connected) {
+		m_params.clear();
+		return NULL;
+	}
+
+	DBQueryTimer timer(m_query.c_str());
+
+	if (!execute()) {
+		return NULL;
+	}
+
+	MYSQL_RES* metadata = mysql_stmt_result_metadata(m_handle);
+	if (!metadata) {
+		std::cout << "mysql_stmt_result_metadata(): " << m_query
+		          << ": MYSQL ERROR: " << mysql_stmt_error(m_handle) << std::endl;
+		return NULL;
+	}
+
+	if (mysql_stmt_store_result(m_handle) != 0) {
+		std::cout << "mysql_stmt_store_result(): " << m_query
+		          << ": MYSQL ERROR: " << mysql_stmt_error(m_handle) << std::endl;
+		mysql_free_result(metadata);
+		return NULL;
+	}
+
+	MySQLResult* result = new MySQLResult(m_handle, metadata);
+	mysql_free_result(metadata);
+	if (!result->next()) {
+		delete result;
+		return NULL;
+	}
+
+	return result;
 }
@@ -34,14 +34,20 @@
 #endif
 #include <map>
 #include <sstream>
+#include <vector>
+
+class MySQLStatement;
 
 class DatabaseMySQL : public _Database
 {
+	friend class MySQLStatement;
+
 public:
 	DatabaseMySQL();
 	DATABASE_VIRTUAL ~DatabaseMySQL();
 
 	DATABASE_VIRTUAL bool getParam(DBParam_t param);
+	DATABASE_VIRTUAL bool ping();
 
 	DATABASE_VIRTUAL bool beginTransaction();
 	DATABASE_VIRTUAL bool rollback();
@@ -50,6 +56,8 @@ public:
 	DATABASE_VIRTUAL bool executeQuery(const std::string& query);
 	DATABASE_VIRTUAL DBResult* storeQuery(const std::string& query);
 
+	DATABASE_VIRTUAL DBStatement* getStatement(const std::string& query);
+
 	DATABASE_VIRTUAL uint64_t getLastInsertedRowID();
 
 	DATABASE_VIRTUAL std::string escapeString(const std::string& s);
@@ -64,11 +72,15 @@ public:
 
 protected:
 	MYSQL m_handle;
+
+	typedef std::map<std::string, MySQLStatement*> StatementMap;
+	StatementMap m_statements;
 };
 
 class MySQLResult : public _DBResult
 {
 	friend class DatabaseMySQL;
+	friend class MySQLStatement;
 
 public:
 	DATABASE_VIRTUAL int32_t getDataInt(const std::string& s);
@@ -78,8 +90,13 @@ public:
 
 	DATABASE_VIRTUAL bool next();
 
+	// mysql_store_result copied the rows already, results of prepared
+	// statements are never handed to another thread
+	DATABASE_VIRTUAL void detach() {}
+
 protected:
 	MySQLResult(MYSQL_RES* res);
+	MySQLResult(MYSQL_STMT* stmt, MYSQL_RES* metadata);
 	DATABASE_VIRTUAL ~MySQLResult();
 
 	typedef std::map<const std::string, uint32_t> listNames_t;
@@ -87,6 +104,47 @@ protected:
 
 	MYSQL_RES* m_handle;
 	MYSQL_ROW m_row;
+	unsigned long* m_lengths;
+
+	// rows of a prepared statement are fetched into these buffers
+	MYSQL_STMT* m_statement;
+	std::vector<MYSQL_BIND> m_columns;
+	std::vector<std::vector<char> > m_buffers;
+	std::vector<unsigned long> m_columnLengths;
+	std::vector<my_bool> m_columnNulls;
+	std::vector<char*> m_rowData;
+};
+
+class MySQLStatement : public _DBStatement
+{
+	friend class DatabaseMySQL;
+
+public:
+	DATABASE_VIRTUAL bool bindInt(int64_t value);
+	DATABASE_VIRTUAL bool bindString(const std::string& value);
+	DATABASE_VIRTUAL bool bindBlob(const char* value, uint32_t length);
+	DATABASE_VIRTUAL void reset();
+
+	DATABASE_VIRTUAL bool executeQuery();
+	DATABASE_VIRTUAL DBResult* storeQuery();
+
+protected:
+	MySQLStatement(DatabaseMySQL* database, const std::string& query);
+	DATABASE_VIRTUAL ~MySQLStatement();
+
+	bool prepare();
+	bool execute();
+
+	struct Param {
+		enum_field_types type;
+		long long number;
+		std::string data;
+	};
+	std::vector<Param> m_params;
+
+	DatabaseMySQL* m_database;
+	MYSQL_STMT* m_handle;
+	std::string m_query;
 };
 
 #endif
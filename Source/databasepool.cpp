@@ -0,0 +1,167 @@
+#include "otpch.h"
+
+#include "databasepool.h"
+
+#include <iostream>
+
+#include "configmanager.h"
+#include "databasetasks.h"
+#include "otsystem.h"
+#include "scheduler.h"
+
+extern ConfigManager g_config;
+
+// connection held by the thread and how many acquire() calls it is held for
+static thread_local Database* t_connection = nullptr;
+static thread_local uint32_t t_holds = 0;
+
+DatabasePool::DatabasePool() : m_open(0), m_running(true)
+{
+}
+
+DatabasePool::~DatabasePool()
+{
+	shutdown();
+}
+
+void DatabasePool::startup()
+{
+	if (g_config.getNumber(ConfigManager::SQL_POOL_KEEPALIVE) > 0) {
+		Scheduler::getScheduler().addEvent(createSchedulerTask(
+		g_config.getNumber(ConfigManager::SQL_POOL_KEEPALIVE) * 1000,
+		boost::bind(&DatabasePool::keepAliveEvent, this)));
+	}
+}
+
+void DatabasePool::shutdown()
+{
+	boost::lock_guard<boost::mutex> lockClass(m_lock);
+	m_running = false;
+	for (std::list<IdleConnection>::iterator it = m_idle.begin(); it != m_idle.end(); ++it) {
+		delete it->connection;
+		--m_open;
+	}
+	m_idle.clear();
+}
+
+Database* DatabasePool::acquire()
+{
+	if (t_connection) {
+		++t_holds;
+		return t_connection;
+	}
+
+	Database* connection = nullptr;
+	boost::unique_lock<boost::mutex> lockClass(m_lock);
+	boost::system_time deadline = boost::get_system_time() +
+	boost::posix_time::milliseconds(g_config.getNumber(ConfigManager::SQL_POOL_WAIT));
+
+	while (!connection) {
+		if (!m_running) {
+			return nullptr;
+		}
+
+		if (!m_idle.empty()) {
+			// the most recently used one, the others age towards the pings
+			connection = m_idle.back().connection;
+			m_idle.pop_back();
+		} else if (m_open < (uint32_t)std::max(1, g_config.getNumber(ConfigManager::SQL_POOL_SIZE))) {
+			// the slot is taken now, connecting may take a while
+			++m_open;
+			lockClass.unlock();
+			connection = Database::createConnection();
+			lockClass.lock();
+
+			if (!connection || !connection->isConnected()) {
+				std::cout << "[Warning - DatabasePool::acquire] Could not open a database connection." << std::endl;
+				delete connection;
+				--m_open;
+				m_released.notify_one();
+				return nullptr;
+			}
+		} else if (!m_released.timed_wait(lockClass, deadline)) {
+			std::cout << "[Warning - DatabasePool::acquire] All " << m_open
+			          << " connections stayed busy for " << g_config.getNumber(ConfigManager::SQL_POOL_WAIT)
+			          << " ms." << std::endl;
+			return nullptr;
+		}
+	}
+	lockClass.unlock();
+
+	t_connection = connection;
+	t_holds = 1;
+	return connection;
+}
+
+void DatabasePool::release(Database* connection)
+{
+	if (connection != t_connection || --t_holds > 0) {
+		return;
+	}
+
+	t_connection = nullptr;
+	giveBack(connection);
+}
+
+void DatabasePool::giveBack(Database* connection)
+{
+	boost::lock_guard<boost::mutex> lockClass(m_lock);
+	if (!m_running || !connection->isConnected()) {
+		delete connection;
+		--m_open;
+	} else {
+		IdleConnection idle;
+		idle.connection = connection;
+		idle.since = OTSYS_TIME();
+		m_idle.push_back(idle);
+	}
+	m_released.notify_one();
+}
+
+Database* DatabasePool::getThreadConnection()
+{
+	return t_connection;
+}
+
+void DatabasePool::getStats(uint32_t& open, uint32_t& idle)
+{
+	boost::lock_guard<boost::mutex> lockClass(m_lock);
+	open = m_open;
+	idle = (uint32_t)m_idle.size();
+}
+
+void DatabasePool::keepAliveEvent()
+{
+	// the pings wait for the network, keep them off the dispatcher
+	DatabaseTasks::getInstance().addTask(createTask(boost::bind(&DatabasePool::pingIdle, this)));
+	startup();
+}
+
+void DatabasePool::pingIdle()
+{
+	// this task holds the most recently used connection, giving it back restamps it
+	// so with a single connection it would never look idle long enough
+	if (Database* held = getThreadConnection()) {
+		if (!held->ping()) {
+			std::cout << "[Warning - DatabasePool::pingIdle] Dropped a broken database connection." << std::endl;
+		}
+	}
+
+	int64_t idleSince = OTSYS_TIME() - g_config.getNumber(ConfigManager::SQL_POOL_KEEPALIVE) * 1000;
+
+	std::list<IdleConnection> pinged;
+	m_lock.lock();
+	// the longest idle ones are at the front
+	while (!m_idle.empty() && m_idle.front().since <= idleSince) {
+		pinged.push_back(m_idle.front());
+		m_idle.pop_front();
+	}
+	m_lock.unlock();
+
+	for (std::list<IdleConnection>::iterator it = pinged.begin(); it != pinged.end(); ++it) {
+		if (!it->connection->ping()) {
+			std::cout << "[Warning - DatabasePool::pingIdle] Dropped a broken database connection." << std::endl;
+		}
+		giveBack(it->connection);
+	}
+}
@@ -0,0 +1,119 @@
+//////////////////////////////////////////////////////////////////////
+// OpenTibia - an opensource roleplaying game
+//////////////////////////////////////////////////////////////////////
+// Pool of database connections for threads other than the dispatcher
+//////////////////////////////////////////////////////////////////////
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef __OTSERV_DATABASEPOOL_H__
+#define __OTSERV_DATABASEPOOL_H__
+
+#include "definitions.h"
+#include "database.h"
+
+#include <boost/thread.hpp>
+#include <list>
+
+/** Connections opened on demand up to SQL_PoolSize and handed to one
+  * thread at a time. While a thread holds one, Database::instance()
+  * returns it on that thread, so code that runs there needs no change.
+  * Idle connections are pinged every SQL_PoolKeepAlive seconds so the
+  * server does not drop them, broken ones are replaced.
+  */
+class DatabasePool
+{
+public:
+	~DatabasePool();
+
+	static DatabasePool& getInstance()
+	{
+		static DatabasePool instance;
+		return instance;
+	}
+
+	/** Starts the keepalive pings */
+	void startup();
+
+	/** Closes the idle connections, held ones are closed when released */
+	void shutdown();
+
+	/** Hands a connection to the calling thread, the same one again if it
+	  * already holds one. Waits up to SQL_PoolWait ms for a free one.
+	  * \return nullptr if none got free or it could not connect
+	  */
+	Database* acquire();
+	void release(Database* connection);
+
+	/** Connection held by the calling thread, nullptr if none */
+	static Database* getThreadConnection();
+
+	/** Connections open and how many of them are idle */
+	void getStats(uint32_t& open, uint32_t& idle);
+
+protected:
+	DatabasePool();
+
+	// back to the idle ones, or closed if broken
+	void giveBack(Database* connection);
+
+	void keepAliveEvent();
+	void pingIdle();
+
+	struct IdleConnection {
+		Database* connection;
+		int64_t since;
+	};
+
+	boost::mutex m_lock;
+	boost::condition_variable m_released;
+	std::list<IdleConnection> m_idle;
+	uint32_t m_open;
+	bool m_running;
+};
+
+/** Holds a pooled connection for the calling thread until it goes out of
+  * scope, check isValid() before use
+  */
+class DBPoolConnection
+{
+public:
+	/** \param acquire false holds nothing, for callers that may not need one */
+	explicit DBPoolConnection(bool acquire = true)
+	: m_connection(acquire ? DatabasePool::getInstance().acquire() : nullptr)
+	{
+	}
+	~DBPoolConnection()
+	{
+		if (m_connection) {
+			DatabasePool::getInstance().release(m_connection);
+		}
+	}
+
+	bool isValid() const
+	{
+		return m_connection != nullptr;
+	}
+
+	Database* get() const
+	{
+		return m_connection;
+	}
+
+private:
+	Database* m_connection;
+};
+
+#endif
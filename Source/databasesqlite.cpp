@@ -6,6 +6,8 @@
 #include "configmanager.h"
 #include "database.h"
 #include "databasesqlite.h"
+#include "querystats.h"
+#include "tools.h"
 
 extern ConfigManager g_config;
 
@@ -17,6 +19,17 @@ extern ConfigManager g_config;
 
 /** DatabaseSQLite definitions */
 
+static bool isPragmaValue(const std::string& value, const char* const* options)
+{
+	for (; *options; ++options) {
+		if (value == *options) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
 DatabaseSQLite::DatabaseSQLite()
 {
 	m_connected = false;
@@ -36,13 +49,58 @@ DatabaseSQLite::DatabaseSQLite()
 		std::cout << "Failed to initialize SQLite connection." << std::endl;
 		sqlite3_close(m_handle);
 	} else {
+		// the database workers keep connections of their own, wait for
+		// their locks instead of failing right away
+		sqlite3_busy_timeout(m_handle, 5000);
 		m_connected = true;
+		setPragmas();
+	}
+}
+
+
+void DatabaseSQLite::setPragmas()
+{
+	static const char* const journalModes[] = {"delete", "truncate", "persist", "memory",
+	                                           "wal",    "off",      nullptr};
+	static const char* const synchronousLevels[] = {"off", "normal", "full", "extra", nullptr};
+
+	std::string journalMode = asLowerCaseString(g_config.getString(ConfigManager::SQLITE_JOURNAL_MODE));
+	if (isPragmaValue(journalMode, journalModes)) {
+		// the mode in effect comes back as a row, older libraries without wal keep theirs
+		DBResult* result = storeQuery("PRAGMA journal_mode = " + journalMode);
+		if (result) {
+			if (result->getDataString("journal_mode") != journalMode) {
+				std::cout << "Warning: [DatabaseSQLite] Journal mode " << journalMode
+				          << " not supported, using " << result->getDataString("journal_mode")
+				          << "." << std::endl;
+			}
+			freeResult(result);
+		}
+	} else {
+		std::cout << "Warning: [DatabaseSQLite] Unknown SQLite_JournalMode " << journalMode << "."
+		          << std::endl;
 	}
+
+	std::string synchronous = asLowerCaseString(g_config.getString(ConfigManager::SQLITE_SYNCHRONOUS));
+	if (isPragmaValue(synchronous, synchronousLevels)) {
+		executeQuery("PRAGMA synchronous = " + synchronous);
+	} else {
+		std::cout << "Warning: [DatabaseSQLite] Unknown SQLite_Synchronous " << synchronous << "."
+		          << std::endl;
+	}
+
+	std::ostringstream query;
+	query << "PRAGMA cache_size = " << g_config.getNumber(ConfigManager::SQLITE_CACHE_SIZE);
+	executeQuery(query.str());
 }
 
 
 DatabaseSQLite::~DatabaseSQLite()
 {
+	for (StatementMap::iterator it = m_statements.begin(); it != m_statements.end(); ++it) {
+		delete it->second;
+	}
+
 	sqlite3_close(m_handle);
 }
 
@@ -114,6 +172,8 @@ bool DatabaseSQLite::executeQuery(const std::string& query)
 		return false;
 	}
 
+	DBQueryTimer timer(query.c_str());
+
 #ifdef __DEBUG_SQL__
 	std::cout << "SQLITE QUERY: " << query << std::endl;
 #endif
@@ -153,6 +213,8 @@ DBResult* DatabaseSQLite::storeQuery(const std::string& query)
 		return nullptr;
 	}
 
+	DBQueryTimer timer(query.c_str());
+
 #ifdef __DEBUG_SQL__
 	std::cout << "SQLITE QUERY: " << query << std::endl;
 #endif
@@ -172,6 +234,35 @@ DBResult* DatabaseSQLite::storeQuery(const std::string& query)
 }
 
 
+DBStatement* DatabaseSQLite::getStatement(const std::string& query)
+{
+	boost::recursive_mutex::scoped_lock lockClass(sqliteLock);
+
+	if (!m_connected) {
+		return nullptr;
+	}
+
+	StatementMap::iterator it = m_statements.find(query);
+	if (it != m_statements.end()) {
+		it->second->reset();
+		return it->second;
+	}
+
+	std::string buf = _parse(query);
+	sqlite3_stmt* stmt;
+	if (OTS_SQLITE3_PREPARE(m_handle, buf.c_str(), buf.length(), &stmt, nullptr) != SQLITE_OK) {
+		sqlite3_finalize(stmt);
+		std::cout << "OTS_SQLITE3_PREPARE(): SQLITE ERROR: " << sqlite3_errmsg(m_handle)
+		          << " (" << buf << ")" << std::endl;
+		return nullptr;
+	}
+
+	SQLiteStatement* statement = new SQLiteStatement(this, stmt);
+	m_statements[query] = statement;
+	return statement;
+}
+
+
 uint64_t DatabaseSQLite::getLastInsertedRowID()
 {
 	return (uint64_t)sqlite3_last_insert_rowid(m_handle);
@@ -223,9 +314,11 @@ void DatabaseSQLite::freeResult(DBResult* res)
 /** SQLiteResult definitions */
 
 
-SQLiteResult::SQLiteResult(sqlite3_stmt* stmt)
+SQLiteResult::SQLiteResult(sqlite3_stmt* stmt, bool prepared /*= false*/)
 {
 	m_handle = stmt;
+	m_prepared = prepared;
+	m_row = 0;
 	m_listNames.clear();
 
 	int32_t fields = sqlite3_column_count(m_handle);
@@ -237,7 +330,47 @@ SQLiteResult::SQLiteResult(sqlite3_stmt* stmt)
 
 SQLiteResult::~SQLiteResult()
 {
-	sqlite3_finalize(m_handle);
+	releaseHandle();
+}
+
+
+void SQLiteResult::releaseHandle()
+{
+	if (!m_handle) {
+		return;
+	}
+
+	if (m_prepared) {
+		sqlite3_reset(m_handle);
+		sqlite3_clear_bindings(m_handle);
+	} else {
+		sqlite3_finalize(m_handle);
+	}
+	m_handle = nullptr;
+}
+
+
+void SQLiteResult::detach()
+{
+	if (!m_handle) {
+		return;
+	}
+
+	// the current row was stepped already, values are kept as their text or blob bytes
+	int32_t fields = sqlite3_column_count(m_handle);
+	do {
+		std::vector<std::string> row(fields);
+		for (int32_t i = 0; i < fields; i++) {
+			const char* value = (const char*)sqlite3_column_blob(m_handle, i);
+			if (value) {
+				row[i].assign(value, sqlite3_column_bytes(m_handle, i));
+			}
+		}
+		m_rows.push_back(row);
+	} while (sqlite3_step(m_handle) == SQLITE_ROW);
+
+	m_row = 0;
+	releaseHandle();
 }
 
 
@@ -245,6 +378,9 @@ int32_t SQLiteResult::getDataInt(const std::string& s)
 {
 	const auto it = m_listNames.find(s);
 	if (it != m_listNames.end()) {
+		if (!m_handle) {
+			return atoi(getDetached(it->second).c_str());
+		}
 		return sqlite3_column_int(m_handle, it->second);
 	}
 
@@ -257,6 +393,9 @@ int64_t SQLiteResult::getDataLong(const std::string& s)
 {
 	const auto it = m_listNames.find(s);
 	if (it != m_listNames.end()) {
+		if (!m_handle) {
+			return ATOI64(getDetached(it->second).c_str());
+		}
 		return sqlite3_column_int64(m_handle, it->second);
 	}
 
@@ -269,6 +408,9 @@ std::string SQLiteResult::getDataString(const std::string& s)
 {
 	const auto it = m_listNames.find(s);
 	if (it != m_listNames.end()) {
+		if (!m_handle) {
+			return getDetached(it->second);
+		}
 		return reinterpret_cast<const char*>(sqlite3_column_text(m_handle, it->second));
 	}
 
@@ -281,6 +423,12 @@ const char* SQLiteResult::getDataStream(const std::string& s, unsigned long& siz
 {
 	const auto it = m_listNames.find(s);
 	if (it != m_listNames.end()) {
+		if (!m_handle) {
+			const std::string& value = getDetached(it->second);
+			size = value.size();
+			return value.data();
+		}
+
 		const char* value = (const char*)sqlite3_column_blob(m_handle, it->second);
 		size = sqlite3_column_bytes(m_handle, it->second);
 		return value;
@@ -293,6 +441,130 @@ const char* SQLiteResult::getDataStream(const std::string& s, unsigned long& siz
 
 bool SQLiteResult::next()
 {
+	if (!m_handle) {
+		if (m_row + 1 >= m_rows.size()) {
+			return false;
+		}
+		++m_row;
+		return true;
+	}
+
 	// checks if after moving to next step we have a row result
 	return sqlite3_step(m_handle) == SQLITE_ROW;
 }
+
+
+/** SQLiteStatement definitions */
+
+
+SQLiteStatement::SQLiteStatement(DatabaseSQLite* database, sqlite3_stmt* stmt)
+{
+	m_database = database;
+	m_handle = stmt;
+	m_bindIndex = 0;
+	m_bindFailed = false;
+}
+
+
+SQLiteStatement::~SQLiteStatement()
+{
+	sqlite3_finalize(m_handle);
+}
+
+
+bool SQLiteStatement::checkBind(int ret)
+{
+	if (ret != SQLITE_OK) {
+		m_bindFailed = true;
+		std::cout << "sqlite3_bind(): SQLITE ERROR: " << sqlite3_errmsg(m_database->m_handle)
+		          << " (" << sqlite3_sql(m_handle) << ")" << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+
+bool SQLiteStatement::bindInt(int64_t value)
+{
+	return checkBind(sqlite3_bind_int64(m_handle, ++m_bindIndex, value));
+}
+
+
+bool SQLiteStatement::bindString(const std::string& value)
+{
+	return checkBind(
+	sqlite3_bind_text(m_handle, ++m_bindIndex, value.c_str(), value.length(), SQLITE_TRANSIENT));
+}
+
+
+bool SQLiteStatement::bindBlob(const char* value, uint32_t length)
+{
+	return checkBind(sqlite3_bind_blob(m_handle, ++m_bindIndex, value, length, SQLITE_TRANSIENT));
+}
+
+
+void SQLiteStatement::reset()
+{
+	// a statement with no bindings may still be stepped by an open result
+	if (m_bindIndex != 0 || m_bindFailed) {
+		sqlite3_clear_bindings(m_handle);
+		m_bindIndex = 0;
+		m_bindFailed = false;
+	}
+}
+
+
+bool SQLiteStatement::executeQuery()
+{
+	boost::recursive_mutex::scoped_lock lockClass(m_database->sqliteLock);
+	if (m_bindFailed) {
+		reset();
+		return false;
+	}
+
+	DBQueryTimer timer(sqlite3_sql(m_handle));
+
+#ifdef __DEBUG_SQL__
+	std::cout << "SQLITE STATEMENT: " << sqlite3_sql(m_handle) << std::endl;
+#endif
+
+	int ret = sqlite3_step(m_handle);
+	bool state = (ret == SQLITE_OK || ret == SQLITE_DONE || ret == SQLITE_ROW);
+	if (!state) {
+		std::cout << "sqlite3_step(): SQLITE ERROR: " << sqlite3_errmsg(m_database->m_handle)
+		          << " (" << sqlite3_sql(m_handle) << ")" << std::endl;
+	}
+
+	sqlite3_reset(m_handle);
+	sqlite3_clear_bindings(m_handle);
+	m_bindIndex = 0;
+	return state;
+}
+
+
+DBResult* SQLiteStatement::storeQuery()
+{
+	boost::recursive_mutex::scoped_lock lockClass(m_database->sqliteLock);
+	if (m_bindFailed) {
+		reset();
+		return nullptr;
+	}
+
+	DBQueryTimer timer(sqlite3_sql(m_handle));
+
+#ifdef __DEBUG_SQL__
+	std::cout << "SQLITE STATEMENT: " << sqlite3_sql(m_handle) << std::endl;
+#endif
+
+	// the result resets the bindings when it is freed
+	m_bindIndex = 0;
+
+	SQLiteResult* result = new SQLiteResult(m_handle, true);
+	if (!result->next()) {
+		delete result;
+		return nullptr;
+	}
+
+	return result;
+}
@@ -30,11 +30,16 @@
 #include "definitions.h"
 
 #include <map>
+#include <vector>
 #include <sqlite3.h>
 #include <sstream>
 
+class SQLiteStatement;
+
 class DatabaseSQLite : public _Database
 {
+	friend class SQLiteStatement;
+
 public:
 	DatabaseSQLite();
 	DATABASE_VIRTUAL ~DatabaseSQLite();
@@ -48,6 +53,8 @@ public:
 	DATABASE_VIRTUAL bool executeQuery(const std::string& query);
 	DATABASE_VIRTUAL DBResult* storeQuery(const std::string& query);
 
+	DATABASE_VIRTUAL DBStatement* getStatement(const std::string& query);
+
 	DATABASE_VIRTUAL uint64_t getLastInsertedRowID();
 
 	DATABASE_VIRTUAL std::string escapeString(const std::string& s);
@@ -70,15 +77,21 @@ public:
 	}
 
 protected:
+	void setPragmas();
+
 	std::string _parse(const std::string& s);
 
 	boost::recursive_mutex sqliteLock;
 	sqlite3* m_handle;
+
+	typedef std::map<std::string, SQLiteStatement*> StatementMap;
+	StatementMap m_statements;
 };
 
 class SQLiteResult : public _DBResult
 {
 	friend class DatabaseSQLite;
+	friend class SQLiteStatement;
 
 public:
 	DATABASE_VIRTUAL int32_t getDataInt(const std::string& s);
@@ -86,14 +99,54 @@ public:
 	DATABASE_VIRTUAL std::string getDataString(const std::string& s);
 	DATABASE_VIRTUAL const char* getDataStream(const std::string& s, unsigned long& size);
 	DATABASE_VIRTUAL bool next();
+	DATABASE_VIRTUAL void detach();
 	size_t size() const;
 
 protected:
-	SQLiteResult(sqlite3_stmt* stmt);
+	SQLiteResult(sqlite3_stmt* stmt, bool prepared = false);
 	DATABASE_VIRTUAL ~SQLiteResult();
 
 	std::map<const std::string, uint32_t> m_listNames;
 	sqlite3_stmt* m_handle;
+	// statement belongs to a SQLiteStatement, reset instead of finalizing it
+	bool m_prepared;
+
+	// filled by detach(), which releases m_handle
+	std::vector<std::vector<std::string> > m_rows;
+	size_t m_row;
+
+	void releaseHandle();
+	// value of a column in the current row of a detached result
+	const std::string& getDetached(uint32_t column) const
+	{
+		return m_rows[m_row][column];
+	}
+};
+
+class SQLiteStatement : public _DBStatement
+{
+	friend class DatabaseSQLite;
+
+public:
+	DATABASE_VIRTUAL bool bindInt(int64_t value);
+	DATABASE_VIRTUAL bool bindString(const std::string& value);
+	DATABASE_VIRTUAL bool bindBlob(const char* value, uint32_t length);
+	DATABASE_VIRTUAL void reset();
+
+	DATABASE_VIRTUAL bool executeQuery();
+	DATABASE_VIRTUAL DBResult* storeQuery();
+
+protected:
+	SQLiteStatement(DatabaseSQLite* database, sqlite3_stmt* stmt);
+	DATABASE_VIRTUAL ~SQLiteStatement();
+
+	bool checkBind(int ret);
+
+	DatabaseSQLite* m_database;
+	sqlite3_stmt* m_handle;
+	int32_t m_bindIndex;
+	// a bind failed since the last execution, it must not run with what is left
+	bool m_bindFailed;
 };
 
 
@@ -0,0 +1,163 @@
+//////////////////////////////////////////////////////////////////////
+// OpenTibia - an opensource roleplaying game
+//////////////////////////////////////////////////////////////////////
+// Worker threads for database work that must not block the dispatcher
+//////////////////////////////////////////////////////////////////////
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//////////////////////////////////////////////////////////////////////
+#include "otpch.h"
+
+#include "databasetasks.h"
+#include "databasepool.h"
+#include "querystats.h"
+
+#include <iostream>
+
+#if defined __EXCEPTION_TRACER__
+#include "exception.h"
+#endif
+
+DatabaseTasks::DatabaseTasks() : m_running(false)
+{
+}
+
+void DatabaseTasks::start(uint32_t workers)
+{
+	boost::unique_lock<boost::mutex> lockClass(m_taskLock);
+	if (m_running) {
+		return;
+	}
+
+	m_running = true;
+	for (uint32_t i = 0; i < std::max<uint32_t>(workers, 1); ++i) {
+		m_threads.create_thread(boost::bind(&DatabaseTasks::workerThread, this));
+	}
+}
+
+void DatabaseTasks::workerThread()
+{
+#if defined __EXCEPTION_TRACER__
+	ExceptionHandler workerExceptionHandler;
+	workerExceptionHandler.InstallHandler();
+#endif
+
+	boost::unique_lock<boost::mutex> taskLockUnique(m_taskLock, boost::defer_lock);
+
+	while (true) {
+		taskLockUnique.lock();
+		while (m_taskList.empty() && m_running) {
+			m_taskSignal.wait(taskLockUnique);
+		}
+
+		if (m_taskList.empty()) {
+			// stopped and nothing left to do
+			taskLockUnique.unlock();
+			break;
+		}
+
+		Task* task = m_taskList.front();
+		m_taskList.pop_front();
+		taskLockUnique.unlock();
+
+		runTask(task, true);
+	}
+
+#if defined __EXCEPTION_TRACER__
+	workerExceptionHandler.RemoveHandler();
+#endif
+}
+
+void DatabaseTasks::addTask(Task* task)
+{
+	m_taskLock.lock();
+	if (!m_running) {
+		m_taskLock.unlock();
+		runTask(task, false);
+		return;
+	}
+
+	m_taskList.push_back(task);
+	m_taskLock.unlock();
+	m_taskSignal.notify_one();
+}
+
+void DatabaseTasks::shutdown()
+{
+	m_taskLock.lock();
+	m_running = false;
+	m_taskLock.unlock();
+
+	// workers drain the queue before leaving
+	m_taskSignal.notify_all();
+	m_threads.join_all();
+}
+
+void DatabaseTasks::runTask(Task* task, bool pooled)
+{
+	DBPoolConnection connection(pooled);
+	if (connection.isValid()) {
+		(*task)();
+	} else {
+		// the shared connection is used by the other threads as well
+		DBQuery lockDatabase;
+		(*task)();
+	}
+	delete task;
+}
+
+size_t DatabaseTasks::getQueueSize()
+{
+	boost::lock_guard<boost::mutex> lockClass(m_taskLock);
+	return m_taskList.size();
+}
+
+Database* DatabaseTasks::getConnection()
+{
+	return Database::instance();
+}
+
+void DatabaseTasks::storeQuery(const std::string& query, const DBResultCallback& callback)
+{
+	addTask(createTask(boost::bind(&DatabaseTasks::runStoreQuery, this, query, callback,
+	                               DBQueryOrigin::current())));
+}
+
+void DatabaseTasks::executeQuery(const std::string& query, const DBExecuteCallback& callback)
+{
+	addTask(createTask(boost::bind(&DatabaseTasks::runExecuteQuery, this, query, callback,
+	                               DBQueryOrigin::current())));
+}
+
+void DatabaseTasks::runStoreQuery(const std::string& query, const DBResultCallback& callback,
+                                  const char* origin)
+{
+	DBQueryOrigin queryOrigin(origin);
+	DBResult* result = getConnection()->storeQuery(query);
+	if (result) {
+		// the connection goes back to the pool before the callback runs
+		result->detach();
+	}
+	Dispatcher::getDispatcher().addTask(createTask(boost::bind(callback, result)));
+}
+
+void DatabaseTasks::runExecuteQuery(const std::string& query, const DBExecuteCallback& callback,
+                                    const char* origin)
+{
+	DBQueryOrigin queryOrigin(origin);
+	bool success = getConnection()->executeQuery(query);
+	if (callback) {
+		Dispatcher::getDispatcher().addTask(createTask(boost::bind(callback, success)));
+	}
+}
@@ -0,0 +1,106 @@
+//////////////////////////////////////////////////////////////////////
+// OpenTibia - an opensource roleplaying game
+//////////////////////////////////////////////////////////////////////
+// Worker threads for database work that must not block the dispatcher
+//////////////////////////////////////////////////////////////////////
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef __OTSERV_DATABASETASKS_H__
+#define __OTSERV_DATABASETASKS_H__
+
+#include "definitions.h"
+#include "database.h"
+#include "tasks.h"
+
+#include <boost/function.hpp>
+#include <boost/thread.hpp>
+#include <list>
+
+typedef boost::function<void (DBResult*)> DBResultCallback;
+typedef boost::function<void (bool)> DBExecuteCallback;
+
+/** Runs tasks on a pool of worker threads.
+  * Every task holds a DatabasePool connection while it runs, tasks must
+  * query through getConnection() and only touch their own data, game state
+  * belongs to the dispatcher: hand the results back with
+  * Dispatcher::addTask.
+  */
+class DatabaseTasks
+{
+public:
+	~DatabaseTasks()
+	{
+	}
+
+	static DatabaseTasks& getInstance()
+	{
+		static DatabaseTasks instance;
+		return instance;
+	}
+
+	/** Starts the worker threads
+	  * \param workers number of threads, at least one is started
+	  */
+	void start(uint32_t workers);
+
+	/** Queues a task, if the pool is not running it is executed right away */
+	void addTask(Task* task);
+
+	/** Runs whatever is still queued and stops the workers */
+	void shutdown();
+
+	/** Number of tasks waiting for a worker */
+	size_t getQueueSize();
+
+	/** Runs a SELECT on a worker and calls back on the dispatcher
+	  * \param callback gets the result (nullptr if empty or failed) and
+	  * must free it with Database::freeResult. The rows are read on the
+	  * worker, the result no longer uses the worker's connection.
+	  */
+	void storeQuery(const std::string& query, const DBResultCallback& callback);
+
+	/** Runs a query on a worker, the optional callback gets its success
+	  * on the dispatcher
+	  */
+	void executeQuery(const std::string& query,
+		const DBExecuteCallback& callback = DBExecuteCallback());
+
+	/** Connection for the calling thread: the pooled one the task holds,
+	  * or the shared one when the pool had none to give
+	  */
+	static Database* getConnection();
+
+protected:
+	DatabaseTasks();
+	void workerThread();
+	// pooled tasks get a connection of their own, the others share the main one
+	void runTask(Task* task, bool pooled);
+
+	// origin is the DBQueryOrigin of the thread that queued the query
+	void runStoreQuery(const std::string& query, const DBResultCallback& callback,
+		const char* origin);
+	void runExecuteQuery(const std::string& query, const DBExecuteCallback& callback,
+		const char* origin);
+
+	boost::mutex m_taskLock;
+	boost::condition_variable m_taskSignal;
+	boost::thread_group m_threads;
+
+	std::list<Task*> m_taskList;
+	bool m_running;
+};
+
+#endif
@@ -8,6 +8,8 @@
 #include "commands.h"
 #include "configmanager.h"
 #include "creature.h"
+#include "databasepool.h"
+#include "databasetasks.h"
 #include "game.h"
 #include "globalevent.h"
 #include "house.h"
@@ -16,9 +18,12 @@
 #include "items.h"
 #include "monster.h"
 #include "movement.h"
+#include "npcscriptpool.h"
 #include "otsystem.h"
 #include "party.h"
 #include "player.h"
+#include "playerdirectory.h"
+#include "playerjournal.h"
 #include "raids.h"
 #include "server.h"
 #include "spawn.h"
@@ -157,8 +162,15 @@ void Game::saveGameState()
 
 bool Game::saveServer(bool globalSave)
 {
+	// the whole save is one transaction, the database syncs to disk once instead
+	// of after every statement, each player's own transaction becomes a savepoint
+	DBQuery lockDatabase;
+	DBTransaction transaction(Database::instance());
+	bool inTransaction = transaction.begin();
+
 	saveGameState();
 
+	PlayerJournal::getInstance().setBatched(true);
 	for (AutoList<Player>::listiterator it = Player::listPlayer.list.begin();
 	     it != Player::listPlayer.list.end(); ++it) {
 		it->second->loginPosition = it->second->getPosition();
@@ -168,9 +180,27 @@ bool Game::saveServer(bool globalSave)
 	if (globalSave) {
 		Houses::getInstance().payHouses();
 		g_bans.clearTemporaryBans();
+	} else {
+		// pick up bans written to the database by other tools
+		g_bans.loadBans();
 	}
 
-	return map->saveMap();
+	bool saved = map->saveMap();
+	PlayerJournal::getInstance().setBatched(false);
+	if (inTransaction && !transaction.commit()) {
+		std::cout << "Failure: [Game::saveServer] Could not commit the save." << std::endl;
+		for (AutoList<Player>::listiterator it = Player::listPlayer.list.begin();
+		     it != Player::listPlayer.list.end(); ++it) {
+			IOPlayer::instance()->dropSaveSnapshot(it->second);
+			// the journal was told they are saved
+			PlayerJournal::getInstance().addPlayer(it->second);
+		}
+		return false;
+	}
+
+	// everyone online is in the database now, what is left of the journal is tiny
+	PlayerJournal::getInstance().compact();
+	return saved;
 }
 
 void Game::loadGameState()
@@ -491,15 +521,9 @@ Creature* Game::getCreatureByName(const std::string& s)
 
 Player* Game::getPlayerByName(const std::string& s)
 {
-	std::string txt1 = asUpperCaseString(s);
-	for (AutoList<Player>::listiterator it = Player::listPlayer.list.begin();
-	     it != Player::listPlayer.list.end(); ++it) {
-		if (!(*it).second->isRemoved()) {
-			std::string txt2 = asUpperCaseString((*it).second->getName());
-			if (txt1 == txt2) {
-				return it->second;
-			}
-		}
+	Player* player = PlayerDirectory::getInstance().getOnlinePlayer(s);
+	if (player && !player->isRemoved()) {
+		return player;
 	}
 
 	return nullptr; // just in case the player doesnt exist
@@ -3190,23 +3214,57 @@ bool Game::playerRequestAddVip(uint32_t playerId, const std::string& vip_name)
 		return false;
 	}
 
-	std::string real_name;
-	real_name = vip_name;
+	std::string real_name = vip_name;
 	uint32_t guid;
 	bool specialVip;
+	// characters made since startup are only in the database
+	if (PlayerDirectory::getInstance().getGuidByName(guid, real_name) &&
+	    IOPlayer::instance()->getGuidByNameEx(guid, specialVip, real_name)) {
+		onVipFound(player, guid, specialVip, real_name);
+		return true;
+	}
+
+	Database* db = Database::instance();
+	DBQuery query;
+	query << "SELECT `name`, `id`, `group_id` FROM `players` WHERE `name`= " << db->escapeString(vip_name);
+	DatabaseTasks::getInstance().storeQuery(query.str(),
+	                                        boost::bind(&Game::onRequestAddVip, this, playerId, _1));
+	return true;
+}
 
-	if (!IOPlayer::instance()->getGuidByNameEx(guid, specialVip, real_name)) {
+void Game::onRequestAddVip(uint32_t playerId, DBResult* result)
+{
+	Player* player = getPlayerByID(playerId);
+	if (!player || player->isRemoved()) {
+		if (result) {
+			Database::instance()->freeResult(result);
+		}
+		return;
+	}
+
+	if (!result) {
 		player->sendTextMessage(MSG_STATUS_SMALL,
 		                        "A player with that name does not exist.");
-		return false;
+		return;
 	}
+
+	std::string real_name;
+	uint32_t guid;
+	bool specialVip;
+	IOPlayer::instance()->readVipEntry(result, guid, specialVip, real_name);
+	Database::instance()->freeResult(result);
+	onVipFound(player, guid, specialVip, real_name);
+}
+
+void Game::onVipFound(Player* player, uint32_t guid, bool specialVip, std::string& real_name)
+{
 	if (specialVip && !player->hasFlag(PlayerFlag_SpecialVIP)) {
 		player->sendTextMessage(MSG_STATUS_SMALL, "You can not add this player.");
-		return false;
+		return;
 	}
 
 	bool online = (getPlayerByName(real_name) != nullptr);
-	return player->addVIP(guid, real_name, online);
+	player->addVIP(guid, real_name, online);
 }
 
 bool Game::playerRequestRemoveVip(uint32_t playerId, uint32_t guid)
@@ -3688,6 +3746,8 @@ void Game::checkCreatures()
 		}
 	}
 
+	// the npc scripts the checks queued, before their npcs can be released
+	NpcScriptPool::getInstance().runThinks();
 	cleanup();
 }
 
@@ -4309,6 +4369,9 @@ void Game::shutdown()
 {
 	std::cout << "Shutting down server...";
 
+	NpcScriptPool::getInstance().shutdown();
+	DatabaseTasks::getInstance().shutdown();
+	DatabasePool::getInstance().shutdown();
 	Scheduler::getScheduler().shutdown();
 	Dispatcher::getDispatcher().shutdown();
 	Spawns::getInstance()->clear();
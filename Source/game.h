@@ -7,6 +7,7 @@
 #include <vector>
 
 #include "container.h"
+#include "database.h"
 #include "definitions.h"
 #include "item.h"
 #include "map.h"
@@ -450,6 +451,8 @@ public:
 	bool playerSetFightModes(uint32_t playerId, fightMode_t fightMode, chaseMode_t chaseMode, bool safeMode);
 	bool playerLookAt(uint32_t playerId, const Position& pos, uint16_t spriteId, uint8_t stackPos);
 	bool playerRequestAddVip(uint32_t playerId, const std::string& name);
+	void onRequestAddVip(uint32_t playerId, DBResult* result);
+	void onVipFound(Player* player, uint32_t guid, bool specialVip, std::string& real_name);
 	bool playerRequestRemoveVip(uint32_t playerId, uint32_t guid);
 	bool playerTurn(uint32_t playerId, Direction dir);
 	bool playerRequestOutfit(uint32_t playerId);
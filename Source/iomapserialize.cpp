@@ -24,12 +24,14 @@
 #include "game.h"
 #include "house.h"
 #include "iomapserialize.h"
+#include "querystats.h"
 
 extern ConfigManager g_config;
 extern Game g_game;
 
 bool IOMapSerialize::loadMap(Map* map)
 {
+	DBQueryOrigin origin("IOMapSerialize::loadMap");
 	const int64_t start = OTSYS_TIME();
 	bool s = false;
 
@@ -49,6 +51,7 @@ bool IOMapSerialize::loadMap(Map* map)
 
 bool IOMapSerialize::saveMap(Map* map)
 {
+	DBQueryOrigin origin("IOMapSerialize::saveMap");
 
 	const int64_t start = OTSYS_TIME();
 	bool s = false;
@@ -687,6 +690,7 @@ bool IOMapSerialize::saveTile(PropWriteStream& stream, const Tile* tile)
 
 bool IOMapSerialize::loadHouseInfo(Map* map)
 {
+	DBQueryOrigin origin("IOMapSerialize::loadHouseInfo");
 	Database* db = Database::instance();
 	DBQuery query;
 	DBResult* result;
@@ -737,6 +741,7 @@ bool IOMapSerialize::loadHouseInfo(Map* map)
 
 bool IOMapSerialize::saveHouseInfo(Map* map)
 {
+	DBQueryOrigin origin("IOMapSerialize::saveHouseInfo");
 	Database* db = Database::instance();
 	DBQuery query;
 	DBTransaction transaction(db);
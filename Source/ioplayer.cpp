@@ -23,6 +23,9 @@
 #include "ioaccount.h"
 #include "ioplayer.h"
 #include "item.h"
+#include "playerdirectory.h"
+#include "playerjournal.h"
+#include "querystats.h"
 #include "tools.h"
 #include "town.h"
 
@@ -36,14 +39,56 @@ extern ConfigManager g_config;
 #pragma warning(disable : 4996)
 #endif
 
+// first field of a player_itemblobs blob
+static const uint16_t ITEM_BLOB_VERSION = 1;
+
+// runs a prepared query taking a single id, like all the player_* lookups
+static DBResult* storeQueryById(Database* db, const std::string& query, int64_t id)
+{
+	DBStatement* stmt = db->getStatement(query);
+	if (!stmt || !stmt->bindInt(id)) {
+		return nullptr;
+	}
+
+	return stmt->storeQuery();
+}
+
+static bool executeQueryById(Database* db, const std::string& query, int64_t id)
+{
+	DBStatement* stmt = db->getStatement(query);
+	if (!stmt || !stmt->bindInt(id)) {
+		return false;
+	}
+
+	return stmt->executeQuery();
+}
+
 bool IOPlayer::loadPlayer(Player* player, const std::string& name, bool preload /*= false*/)
 {
+	DBQueryOrigin origin("IOPlayer::loadPlayer");
 	Database* db = Database::instance();
-	DBQuery query;
+	DBQuery lockDatabase;
+
+	PlayerLoadData data;
+	if (!loadPlayerData(data, name, db)) {
+		return false;
+	}
+
+	if (!preload) {
+		loadPlayerDetails(data, db);
+	}
+
+	return applyPlayerData(player, data, preload);
+}
+
+bool IOPlayer::loadPlayerData(PlayerLoadData& data, const std::string& name, Database* db)
+{
+	DBQueryOrigin origin("IOPlayer::loadPlayerData");
+	DBStatement* stmt;
 	DBResult* result;
 
 #ifdef __PROTOCOL_76__
-	query << "SELECT `players`.`id` AS `id`, `players`.`name` AS `name`, `account_id`, \
+	stmt = db->getStatement("SELECT `players`.`id` AS `id`, `players`.`name` AS `name`, `account_id`, \
 			 `players`.`group_id` as `group_id`, `sex`, `vocation`, `experience`, `level`, \
 			 `maglevel`, `health`, `healthmax`, `mana`, `manamax`, `manaspent`, `soul`, \
 			 `direction`, `lookbody`, `lookfeet`, `lookhead`, `looklegs`, `looktype`, \
@@ -51,10 +96,9 @@ bool IOPlayer::loadPlayer(Player* player, const std::string& name, bool preload
 			 `redskulltime`, `redskull`, `guildnick`, `loss_experience`, `loss_mana`, \
 			 `loss_skills`, `loss_items`, `rank_id`, `town_id`, `balance` \
 			 FROM `players` LEFT JOIN `accounts` ON `account_id` = `accounts`.`id` \
-			 WHERE `players`.`name` = " +
-	         db->escapeString(name);
+			 WHERE `players`.`name` = ?");
 #else
-	query << "SELECT `players`.`id` AS `id`, `players`.`name` AS `name`, `account_id`, \
+	stmt = db->getStatement("SELECT `players`.`id` AS `id`, `players`.`name` AS `name`, `account_id`, \
 			 `players`.`group_id` as `group_id`, `sex`, `vocation`, `experience`, `level`, \
 			 `maglevel`, `health`, `healthmax`, `mana`, `manamax`, `manaspent`, `direction`, \
 			 `lookbody`, `lookfeet`, `lookhead`, `looklegs`, `looktype`, `posx`, `posy`, \
@@ -62,20 +106,278 @@ bool IOPlayer::loadPlayer(Player* player, const std::string& name, bool preload
 			 `redskull`, `guildnick`, `loss_experience`, `loss_mana`, `loss_skills`, \
 			 `loss_items`, `rank_id`, `town_id`, `balance` \
 			 FROM `players` LEFT JOIN `accounts` ON `account_id` = `accounts`.`id` \
-			 WHERE `players`.`name` = " +
-	         db->escapeString(name);
+			 WHERE `players`.`name` = ?");
 #endif // __PROTOCOL_76__
 
-	if (!(result = db->storeQuery(query.str()))) {
+	if (!stmt || !stmt->bindString(name) || !(result = stmt->storeQuery())) {
 		return false;
 	}
-	query.str("");
 
-	player->setGUID(result->getDataInt("id"));
-	player->accountNumber = result->getDataInt("account_id");
-	// player->groupName = result->getDataString("groupname"); fix me
+	data.guid = result->getDataInt("id");
+	data.name = result->getDataString("name");
+	data.accountNumber = result->getDataInt("account_id");
+	data.groupId = result->getDataInt("group_id");
+	data.sex = result->getDataInt("sex");
+	data.direction = result->getDataInt("direction");
+	data.level = result->getDataInt("level");
+	data.experience = (uint64_t)result->getDataLong("experience");
+#ifdef __PROTOCOL_76__
+	data.soul = result->getDataInt("soul");
+#endif // __PROTOCOL_76__
+	data.capacity = result->getDataInt("cap");
+	data.lastLogin = result->getDataInt("lastlogin");
+	data.lastLogout = result->getDataInt("lastlogout");
+	data.health = result->getDataInt("health");
+	data.healthMax = result->getDataInt("healthmax");
+	data.lookType = result->getDataInt("looktype");
+	data.lookHead = result->getDataInt("lookhead");
+	data.lookBody = result->getDataInt("lookbody");
+	data.lookLegs = result->getDataInt("looklegs");
+	data.lookFeet = result->getDataInt("lookfeet");
+	data.redSkullTime = result->getDataInt("redskulltime");
+	data.redSkull = result->getDataInt("redskull");
+
+	unsigned long conditionsSize = 0;
+	const char* conditions = result->getDataStream("conditions", conditionsSize);
+	if (conditions) {
+		data.conditions.assign(conditions, conditionsSize);
+	}
+
+	data.vocation = result->getDataInt("vocation");
+	data.mana = result->getDataInt("mana");
+	data.manaMax = result->getDataInt("manamax");
+	data.magLevel = result->getDataInt("maglevel");
+	data.manaSpent = (uint32_t)result->getDataInt("manaspent");
+	data.lossExperience = result->getDataInt("loss_experience");
+	data.lossMana = result->getDataInt("loss_mana");
+	data.lossSkills = result->getDataInt("loss_skills");
+	data.lossItems = result->getDataInt("loss_items");
+	data.loginPosition.x = result->getDataInt("posx");
+	data.loginPosition.y = result->getDataInt("posy");
+	data.loginPosition.z = result->getDataInt("posz");
+	data.townId = result->getDataInt("town_id");
+	data.rankId = result->getDataInt("rank_id");
+	data.balance = result->getDataInt("balance");
+	data.guildNick = result->getDataString("guildnick");
+	db->freeResult(result);
+	return true;
+}
+
+void IOPlayer::loadPlayerDetails(PlayerLoadData& data, Database* db)
+{
+	DBQueryOrigin origin("IOPlayer::loadPlayerDetails");
+	DBResult* result;
+
+	if (data.rankId) {
+		if ((result = storeQueryById(db,
+		                             "SELECT `guild_ranks`.`name` as `rank`, `guild_ranks`.`guild_id` as "
+		                             "`guildid`, `guild_ranks`.`level` as `level`, `guilds`.`name` as "
+		                             "`guildname` FROM `guild_ranks`, `guilds` WHERE `guild_ranks`.`id` = "
+		                             "? AND `guild_ranks`.`guild_id` = `guilds`.`id`",
+		                             data.rankId))) {
+			data.hasGuild = true;
+			data.guildName = result->getDataString("guildname");
+			data.guildLevel = result->getDataInt("level");
+			data.guildId = result->getDataInt("guildid");
+			data.guildRank = result->getDataString("rank");
+
+			db->freeResult(result);
+		}
+	}
+
+	// get password
+	if ((result = storeQueryById(db, "SELECT `password`, `premend` FROM `accounts` WHERE `id` = ?",
+	                             data.accountNumber))) {
+		data.hasAccount = true;
+		data.password = result->getDataString("password");
+		data.premEnd = result->getDataInt("premend");
+		db->freeResult(result);
+	}
+
+	if ((result = storeQueryById(db, "SELECT `skillid`, `value`, `count` FROM `player_skills` WHERE "
+	                                 "`player_id` = ?",
+	                             data.guid))) {
+		do {
+			PlayerSkillData skill;
+			skill.skillId = result->getDataInt("skillid");
+			skill.level = result->getDataInt("value");
+			skill.tries = result->getDataInt("count");
+			data.skills.push_back(skill);
+		} while (result->next());
+
+		db->freeResult(result);
+	}
+
+	if ((result = storeQueryById(db, "SELECT `name` FROM `player_spells` WHERE `player_id` = ?",
+	                             data.guid))) {
+		do {
+			data.spells.push_back(result->getDataString("name"));
+		} while (result->next());
+
+		db->freeResult(result);
+	}
+
+	// players without a blob are still in the old rows, their next save moves them
+	itemblob_t blob = ITEMBLOB_NONE;
+	if (g_config.getBoolean(ConfigManager::PLAYER_ITEM_BLOBS)) {
+		blob = loadItemBlobs(db, data.guid, data.items, data.depotItems);
+	}
+
+	if (blob == ITEMBLOB_NONE) {
+		loadItemRows(db, data.guid, data.items, data.depotItems);
+	} else if (blob == ITEMBLOB_UNREADABLE) {
+		data.itemsUnreadable = true;
+	}
+
+	if ((result = storeQueryById(db, "SELECT `key`, `value` FROM `player_storage` WHERE `player_id` = ?",
+	                             data.guid))) {
+		do {
+			data.storage.push_back(std::make_pair((uint32_t)result->getDataInt("key"),
+			                                      (int32_t)result->getDataInt("value")));
+		} while (result->next());
+		db->freeResult(result);
+	}
+
+	// the names come along so the vip list costs one query instead of one per entry
+	if ((result = storeQueryById(db, "SELECT `player_viplist`.`vip_id` AS `vip_id`, `players`.`name` AS "
+	                                 "`name` FROM `player_viplist`, `players` WHERE "
+	                                 "`player_viplist`.`player_id` = ? AND `players`.`id` = "
+	                                 "`player_viplist`.`vip_id`",
+	                             data.guid))) {
+		do {
+			data.vips.push_back(
+			std::make_pair((uint32_t)result->getDataInt("vip_id"), result->getDataString("name")));
+		} while (result->next());
+		db->freeResult(result);
+	}
+}
+
+void IOPlayer::loadItemRows(Database* db, uint32_t guid, std::vector<PlayerItemData>& items,
+                            std::vector<PlayerItemData>& depotItems)
+{
+	DBResult* result;
+	if ((result = storeQueryById(db, "SELECT `pid`, `sid`, `itemtype`, `count`, `attributes` FROM "
+	                                 "`player_items` WHERE `player_id` = ? ORDER BY `sid` DESC",
+	                             guid))) {
+		readItems(items, result);
+		db->freeResult(result);
+	}
+
+	if ((result = storeQueryById(db, "SELECT `pid`, `sid`, `itemtype`, `count`, `attributes` FROM "
+	                                 "`player_depotitems` WHERE `player_id` = ? ORDER BY `sid` DESC",
+	                             guid))) {
+		readItems(depotItems, result);
+		db->freeResult(result);
+	}
+}
+
+itemblob_t IOPlayer::loadItemBlobs(Database* db, uint32_t guid, std::vector<PlayerItemData>& items,
+                                   std::vector<PlayerItemData>& depotItems)
+{
+	DBResult* result;
+	if (!(result = storeQueryById(db, "SELECT `items`, `depotitems` FROM `player_itemblobs` WHERE "
+	                                  "`player_id` = ?",
+	                              guid))) {
+		return ITEMBLOB_NONE;
+	}
+
+	unsigned long itemsSize, depotItemsSize;
+	const char* itemsBlob = result->getDataStream("items", itemsSize);
+	const char* depotItemsBlob = result->getDataStream("depotitems", depotItemsSize);
+
+	bool ret = unserializeItems(itemsBlob, itemsSize, items) &&
+	           unserializeItems(depotItemsBlob, depotItemsSize, depotItems);
+	db->freeResult(result);
+
+	if (!ret) {
+		std::cout << "[Error - IOPlayer::loadItemBlobs] Unreadable item blob for player " << guid
+		          << std::endl;
+		items.clear();
+		depotItems.clear();
+		return ITEMBLOB_UNREADABLE;
+	}
+
+	return ITEMBLOB_LOADED;
+}
+
+bool IOPlayer::migrateItems()
+{
+	DBQueryOrigin origin("IOPlayer::migrateItems");
+	Database* db = Database::instance();
+	DBQuery query;
+	DBResult* result;
+
+	bool toBlobs = g_config.getBoolean(ConfigManager::PLAYER_ITEM_BLOBS);
+
+	std::vector<uint32_t> guids;
+	if ((result = db->storeQuery("SELECT `id` FROM `players`"))) {
+		do {
+			guids.push_back(result->getDataInt("id"));
+		} while (result->next());
+		db->freeResult(result);
+	}
+
+	uint32_t migrated = 0;
+	for (std::vector<uint32_t>::const_iterator it = guids.begin(); it != guids.end(); ++it) {
+		std::vector<PlayerItemData> items, depotItems;
+
+		DBTransaction transaction(db);
+		if (!transaction.begin()) {
+			return false;
+		}
+
+		if (toBlobs) {
+			loadItemRows(db, *it, items, depotItems);
+			if (items.empty() && depotItems.empty()) {
+				continue;
+			}
+
+			if (!saveItemBlobs(db, *it, serializeItems(items), serializeItems(depotItems))) {
+				return false;
+			}
+		} else {
+			// an unreadable blob is left for someone to look at
+			if (loadItemBlobs(db, *it, items, depotItems) != ITEMBLOB_LOADED) {
+				continue;
+			}
+
+			DBInsert insert(db);
+			insert.setQuery("INSERT INTO `player_items` (`player_id` , `pid` , `sid` , `itemtype` , "
+			                "`count` , `attributes` ) VALUES ");
+			if (!(saveItems(*it, items, insert) && insert.execute())) {
+				return false;
+			}
+
+			insert.setQuery("INSERT INTO `player_depotitems` (`player_id` , `pid` , `sid` , "
+			                "`itemtype` , `count` , `attributes` ) VALUES ");
+			if (!(saveItems(*it, depotItems, insert) && insert.execute())) {
+				return false;
+			}
 
-	const PlayerGroup* group = getPlayerGroup(result->getDataInt("group_id"));
+			if (!executeQueryById(db, "DELETE FROM `player_itemblobs` WHERE `player_id` = ?", *it)) {
+				return false;
+			}
+		}
+
+		if (!transaction.commit()) {
+			return false;
+		}
+
+		++migrated;
+	}
+
+	std::cout << "Moved the items of " << migrated << " players to "
+	          << (toBlobs ? "player_itemblobs" : "player_items and player_depotitems") << std::endl;
+	return true;
+}
+
+bool IOPlayer::applyPlayerData(Player* player, const PlayerLoadData& data, bool preload /*= false*/)
+{
+	player->setGUID(data.guid);
+	player->accountNumber = data.accountNumber;
+	PlayerDirectory::getInstance().update(data.guid, data.name, data.groupId);
+
+	const PlayerGroup* group = getPlayerGroup(data.groupId);
 	if (group) {
 		player->accessLevel = group->m_access;
 		player->maxDepotLimit = group->m_maxDepotItems;
@@ -85,18 +387,27 @@ bool IOPlayer::loadPlayer(Player* player, const std::string& name, bool preload
 
 	if (preload) {
 		// only loading basic info
-		db->freeResult(result);
 		return true;
 	}
 
+	if (!data.hasAccount) {
+		return false;
+	}
+
+	if (data.itemsUnreadable) {
+		std::cout << "[Error - IOPlayer::loadPlayer] " << data.name
+		          << " can not be loaded, the item blob is unreadable." << std::endl;
+		return false;
+	}
+
 	// Getting all player properties
-	player->setSex((PlayerSex_t)result->getDataInt("sex"));
-	player->setDirection((Direction)result->getDataInt("direction"));
-	player->level = std::max((uint32_t)1, (uint32_t)result->getDataInt("level"));
+	player->setSex((PlayerSex_t)data.sex);
+	player->setDirection((Direction)data.direction);
+	player->level = std::max((uint32_t)1, (uint32_t)data.level);
 
 	uint64_t currExpCount = Player::getExpForLevel(player->level);
 	uint64_t nextExpCount = Player::getExpForLevel(player->level + 1);
-	uint64_t experience = (uint64_t)result->getDataLong("experience");
+	uint64_t experience = data.experience;
 	if (experience < currExpCount || experience > nextExpCount) {
 		experience = currExpCount;
 	}
@@ -104,37 +415,35 @@ bool IOPlayer::loadPlayer(Player* player, const std::string& name, bool preload
 	player->levelPercent =
 	Player::getPercentLevel(player->experience - currExpCount, nextExpCount - currExpCount);
 #ifdef __PROTOCOL_76__
-	player->soul = result->getDataInt("soul");
+	player->soul = data.soul;
 #endif // __PROTOCOL_76__
-	player->capacity = result->getDataInt("cap");
-	player->lastLoginSaved = result->getDataInt("lastlogin");
-	player->lastLogout = result->getDataInt("lastlogout");
-
-	player->health = result->getDataInt("health");
-	player->healthMax = result->getDataInt("healthmax");
-	player->defaultOutfit.lookType = result->getDataInt("looktype");
-	player->defaultOutfit.lookHead = result->getDataInt("lookhead");
-	player->defaultOutfit.lookBody = result->getDataInt("lookbody");
-	player->defaultOutfit.lookLegs = result->getDataInt("looklegs");
-	player->defaultOutfit.lookFeet = result->getDataInt("lookfeet");
+	player->capacity = data.capacity;
+	player->lastLoginSaved = data.lastLogin;
+	player->lastLogout = data.lastLogout;
+
+	player->health = data.health;
+	player->healthMax = data.healthMax;
+	player->defaultOutfit.lookType = data.lookType;
+	player->defaultOutfit.lookHead = data.lookHead;
+	player->defaultOutfit.lookBody = data.lookBody;
+	player->defaultOutfit.lookLegs = data.lookLegs;
+	player->defaultOutfit.lookFeet = data.lookFeet;
 	player->currentOutfit = player->defaultOutfit;
 
 #ifdef __SKULLSYSTEM__
-	int32_t redSkullSeconds = result->getDataInt("redskulltime") - std::time(nullptr);
+	int32_t redSkullSeconds = data.redSkullTime - std::time(nullptr);
 	if (redSkullSeconds > 0) {
 		// ensure that we round up the number of ticks
 		player->redSkullTicks = (redSkullSeconds + 2) * 1000;
 
-		if (result->getDataInt("redskull") == 1) {
+		if (data.redSkull == 1) {
 			player->skull = SKULL_RED;
 		}
 	}
 #endif
 
-	unsigned long conditionsSize = 0;
-	const char* conditions = result->getDataStream("conditions", conditionsSize);
 	PropStream propStream;
-	propStream.init(conditions, conditionsSize);
+	propStream.init(data.conditions.data(), data.conditions.size());
 
 	Condition* condition;
 	while ((condition = Condition::createCondition(propStream))) {
@@ -146,14 +455,14 @@ bool IOPlayer::loadPlayer(Player* player, const std::string& name, bool preload
 	}
 	// you need to set the vocation after conditions in order to ensure the proper regeneration
 	// rates for the vocation
-	player->setVocation(result->getDataInt("vocation"));
+	player->setVocation(data.vocation);
 	// this stuff has to go after the vocation is set
-	player->mana = result->getDataInt("mana");
-	player->manaMax = result->getDataInt("manamax");
-	player->magLevel = result->getDataInt("maglevel");
+	player->mana = data.mana;
+	player->manaMax = data.manaMax;
+	player->magLevel = data.magLevel;
 
 	uint32_t nextManaCount = (uint32_t)player->vocation->getReqMana(player->magLevel + 1);
-	uint32_t manaSpent = (uint32_t)result->getDataInt("manaspent");
+	uint32_t manaSpent = data.manaSpent;
 	if (manaSpent > nextManaCount) {
 		// make sure its not out of bound
 		manaSpent = 0;
@@ -161,16 +470,14 @@ bool IOPlayer::loadPlayer(Player* player, const std::string& name, bool preload
 	player->manaSpent = manaSpent;
 	player->magLevelPercent = Player::getPercentLevel(player->manaSpent, nextManaCount);
 
-	player->setLossPercent(LOSS_EXPERIENCE, result->getDataInt("loss_experience"));
-	player->setLossPercent(LOSS_MANASPENT, result->getDataInt("loss_mana"));
-	player->setLossPercent(LOSS_SKILLTRIES, result->getDataInt("loss_skills"));
-	player->setLossPercent(LOSS_ITEMS, result->getDataInt("loss_items"));
+	player->setLossPercent(LOSS_EXPERIENCE, data.lossExperience);
+	player->setLossPercent(LOSS_MANASPENT, data.lossMana);
+	player->setLossPercent(LOSS_SKILLTRIES, data.lossSkills);
+	player->setLossPercent(LOSS_ITEMS, data.lossItems);
 
-	player->loginPosition.x = result->getDataInt("posx");
-	player->loginPosition.y = result->getDataInt("posy");
-	player->loginPosition.z = result->getDataInt("posz");
+	player->loginPosition = data.loginPosition;
 
-	player->town = result->getDataInt("town_id");
+	player->town = data.townId;
 	Town* town = Towns::getInstance().getTown(player->town);
 	if (town) {
 		player->masterPos = town->getTemplePosition();
@@ -190,179 +497,124 @@ bool IOPlayer::loadPlayer(Player* player, const std::string& name, bool preload
 		player->loginPosition = town->getTemplePosition();
 	}
 
-	uint32_t rankid = result->getDataInt("rank_id");
-	// place it here and now we can drop all additional query instances as all data were loaded
-	player->balance = result->getDataInt("balance");
-	player->guildNick = result->getDataString("guildnick");
-	db->freeResult(result);
-
-	if (rankid) {
-		query << "SELECT `guild_ranks`.`name` as `rank`, `guild_ranks`.`guild_id` as "
-		         "`guildid`, `guild_ranks`.`level` as `level`, `guilds`.`name` as "
-		         "`guildname` FROM `guild_ranks`, `guilds` WHERE `guild_ranks`.`id` = "
-		      << rankid << " AND `guild_ranks`.`guild_id` = `guilds`.`id`";
-		if ((result = db->storeQuery(query.str()))) {
-			player->guildName = result->getDataString("guildname");
-			player->guildLevel = result->getDataInt("level");
-			player->guildId = result->getDataInt("guildid");
-			player->guildRank = result->getDataString("rank");
-
-			db->freeResult(result);
-		}
-		query.str("");
-	}
+	player->balance = data.balance;
+	player->guildNick = data.guildNick;
 
-	// get password
-	query << "SELECT `password`, `premend` FROM `accounts` WHERE `id` = " << player->accountNumber;
-	if (!(result = db->storeQuery(query.str()))) {
-		return false;
+	if (data.hasGuild) {
+		player->guildName = data.guildName;
+		player->guildLevel = data.guildLevel;
+		player->guildId = data.guildId;
+		player->guildRank = data.guildRank;
 	}
 
-	player->password = result->getDataString("password");
-	player->premiumDays = Account::getPremiumDaysLeft(result->getDataInt("premend"));
-	db->freeResult(result);
+	player->password = data.password;
+	player->premiumDays = Account::getPremiumDaysLeft(data.premEnd);
 
-	// we need to find out our skills
-	// so we query the skill table
-	query.str("");
-	query << "SELECT `skillid`, `value`, `count` FROM `player_skills` WHERE `player_id` = "
-	      << player->getGUID();
-	if ((result = db->storeQuery(query.str()))) {
-		// now iterate over the skills
-		do {
-			int skillid = result->getDataInt("skillid");
-			if (skillid >= SKILL_FIRST && skillid <= SKILL_LAST) {
-				uint32_t skillLevel = result->getDataInt("value");
-				uint32_t skillCount = result->getDataInt("count");
-
-				uint32_t nextSkillCount =
-				player->vocation->getReqSkillTries(skillid, skillLevel + 1);
-				if (skillCount > nextSkillCount) {
-					// make sure its not out of bound
-					skillCount = 0;
-				}
+	for (std::vector<PlayerSkillData>::const_iterator it = data.skills.begin();
+	     it != data.skills.end(); ++it) {
+		int skillid = it->skillId;
+		if (skillid >= SKILL_FIRST && skillid <= SKILL_LAST) {
+			uint32_t skillLevel = it->level;
+			uint32_t skillCount = it->tries;
 
-				player->skills[skillid][SKILL_LEVEL] = skillLevel;
-				player->skills[skillid][SKILL_TRIES] = skillCount;
-				player->skills[skillid][SKILL_PERCENT] =
-				Player::getPercentLevel(skillCount, nextSkillCount);
+			uint32_t nextSkillCount = player->vocation->getReqSkillTries(skillid, skillLevel + 1);
+			if (skillCount > nextSkillCount) {
+				// make sure its not out of bound
+				skillCount = 0;
 			}
-		} while (result->next());
 
-		db->freeResult(result);
+			player->skills[skillid][SKILL_LEVEL] = skillLevel;
+			player->skills[skillid][SKILL_TRIES] = skillCount;
+			player->skills[skillid][SKILL_PERCENT] = Player::getPercentLevel(skillCount, nextSkillCount);
+		}
 	}
 
-	query.str("");
-	query << "SELECT `name` FROM `player_spells` WHERE `player_id` = " << player->getGUID();
-	if ((result = db->storeQuery(query.str()))) {
-		do {
-			std::string spellName = result->getDataString("name");
-			player->learnedInstantSpellList.push_back(spellName);
-		} while (result->next());
-
-		db->freeResult(result);
-	}
+	player->learnedInstantSpellList.insert(player->learnedInstantSpellList.end(),
+	                                       data.spells.begin(), data.spells.end());
 
 	// load inventory items
 	ItemMap itemMap;
+	loadItems(itemMap, data.items);
 
-	query.str("");
-	query << "SELECT `pid`, `sid`, `itemtype`, `count`, `attributes` FROM `player_items` WHERE "
-	         "`player_id` = "
-	      << player->getGUID() << " ORDER BY `sid` DESC";
-	if ((result = db->storeQuery(query.str()))) {
-		loadItems(itemMap, result);
-
-		ItemMap::reverse_iterator it;
-		ItemMap::iterator it2;
-
-		for (it = itemMap.rbegin(); it != itemMap.rend(); ++it) {
-			Item* item = it->second.first;
-			int pid = it->second.second;
-			if (pid >= 1 && pid <= 10) {
-				player->__internalAddThing(pid, item);
-			} else {
-				it2 = itemMap.find(pid);
-				if (it2 != itemMap.end()) {
-					if (Container* container = it2->second.first->getContainer()) {
-						container->__internalAddThing(item);
-					}
+	ItemMap::reverse_iterator it;
+	ItemMap::iterator it2;
+
+	for (it = itemMap.rbegin(); it != itemMap.rend(); ++it) {
+		Item* item = it->second.first;
+		int pid = it->second.second;
+		if (pid >= 1 && pid <= 10) {
+			player->__internalAddThing(pid, item);
+		} else {
+			it2 = itemMap.find(pid);
+			if (it2 != itemMap.end()) {
+				if (Container* container = it2->second.first->getContainer()) {
+					container->__internalAddThing(item);
 				}
 			}
 		}
-
-		db->freeResult(result);
 	}
 
-
 	// load depot items
 	itemMap.clear();
-
-	query.str("");
-	query << "SELECT `pid`, `sid`, `itemtype`, `count`, `attributes` FROM `player_depotitems` "
-	         "WHERE `player_id` = "
-	      << player->getGUID() << " ORDER BY `sid` DESC";
-	if ((result = db->storeQuery(query.str()))) {
-		loadItems(itemMap, result);
-
-		ItemMap::reverse_iterator it;
-		ItemMap::iterator it2;
-
-		for (it = itemMap.rbegin(); it != itemMap.rend(); ++it) {
-			Item* item = it->second.first;
-			int pid = it->second.second;
-			if (pid >= 0 && pid < 100) {
-				if (Container* c = item->getContainer()) {
-					if (Depot* depot = c->getDepot()) {
-						player->addDepot(depot, pid);
-					} else {
-						std::cout << "Error loading depot " << pid
-						          << " for player " << player->getGUID()
-						          << std::endl;
-					}
+	loadItems(itemMap, data.depotItems);
+
+	for (it = itemMap.rbegin(); it != itemMap.rend(); ++it) {
+		Item* item = it->second.first;
+		int pid = it->second.second;
+		if (pid >= 0 && pid < 100) {
+			if (Container* c = item->getContainer()) {
+				if (Depot* depot = c->getDepot()) {
+					player->addDepot(depot, pid);
 				} else {
 					std::cout << "Error loading depot " << pid << " for player "
 					          << player->getGUID() << std::endl;
 				}
 			} else {
-				it2 = itemMap.find(pid);
-				if (it2 != itemMap.end()) {
-					if (Container* container = it2->second.first->getContainer()) {
-						container->__internalAddThing(item);
-					}
+				std::cout << "Error loading depot " << pid << " for player " << player->getGUID()
+				          << std::endl;
+			}
+		} else {
+			it2 = itemMap.find(pid);
+			if (it2 != itemMap.end()) {
+				if (Container* container = it2->second.first->getContainer()) {
+					container->__internalAddThing(item);
 				}
 			}
 		}
+	}
 
-		db->freeResult(result);
+	for (std::vector<std::pair<uint32_t, int32_t>>::const_iterator sit = data.storage.begin();
+	     sit != data.storage.end(); ++sit) {
+		player->addStorageValue(sit->first, sit->second);
 	}
 
-	// load storage map
-	query.str("");
-	query << "SELECT `key`, `value` FROM `player_storage` WHERE `player_id` = " << player->getGUID();
-	if ((result = db->storeQuery(query.str()))) {
-		do {
-			uint32_t key = result->getDataInt("key");
-			int32_t value = result->getDataInt("value");
-			player->addStorageValue(key, value);
-		} while (result->next());
-		db->freeResult(result);
+	for (std::vector<std::pair<uint32_t, std::string>>::const_iterator vit = data.vips.begin();
+	     vit != data.vips.end(); ++vit) {
+		uint32_t groupId = 0;
+		PlayerDirectory::getInstance().getGroupId(vit->first, groupId);
+		PlayerDirectory::getInstance().update(vit->first, vit->second, groupId);
+
+		std::string dummy_str;
+		player->addVIP(vit->first, dummy_str, false, true);
 	}
 
-	// load vip
-	query.str("");
-	query << "SELECT `vip_id` FROM `player_viplist` WHERE `player_id` = " << player->getGUID();
-	if ((result = db->storeQuery(query.str()))) {
-		do {
-			uint32_t vip_id = result->getDataInt("vip_id");
-			std::string dummy_str;
-			if (storeNameByGuid(*db, vip_id)) {
-				player->addVIP(vip_id, dummy_str, false, true);
-			}
-		} while (result->next());
-		db->freeResult(result);
+	// remember what the database holds now, the next save only writes what differs
+	player->savedItems = getInventoryBlob(player);
+
+	ItemBlockList itemList;
+	std::vector<PlayerItemData> items;
+	for (DepotMap::iterator dit = player->depots.begin(); dit != player->depots.end(); ++dit) {
+		itemList.push_back(itemBlock(dit->first, dit->second));
 	}
 
+	collectItems(itemList, items);
+	player->savedDepotItems = serializeItems(items);
+	player->hasSaveSnapshot = true;
+	player->journaled = true;
+	player->spellsDirty = false;
+	player->storageDirty = false;
+	player->vipListDirty = false;
+
 	player->updateBaseSpeed();
 	player->updateInventoryWeigth();
 	player->updateItemsLight(true);
@@ -370,23 +622,18 @@ bool IOPlayer::loadPlayer(Player* player, const std::string& name, bool preload
 	return true;
 }
 
-bool IOPlayer::saveItems(Player* player, const ItemBlockList& itemList, DBInsert& query_insert)
+void IOPlayer::collectItems(const ItemBlockList& itemList, std::vector<PlayerItemData>& items)
 {
-	std::list<Container*> listContainer;
-	std::stringstream stream;
-
 	typedef std::pair<Container*, int32_t> containerBlock;
 	std::list<containerBlock> stack;
 
 	int32_t parentId = 0;
 	int32_t runningId = 100;
 
-	Database* db = Database::instance();
 	Item* item;
-	int32_t pid;
+	PlayerItemData data;
 
 	for (ItemBlockList::const_iterator it = itemList.begin(); it != itemList.end(); ++it) {
-		pid = it->first;
 		item = it->second;
 		++runningId;
 
@@ -396,13 +643,12 @@ bool IOPlayer::saveItems(Player* player, const ItemBlockList& itemList, DBInsert
 		item->serializeAttr(propWriteStream);
 		const char* attributes = propWriteStream.getStream(attributesSize);
 
-		stream << player->getGUID() << ", " << pid << ", " << runningId << ", "
-		       << item->getID() << ", " << (int32_t)item->getSubType() << ", "
-		       << db->escapeBlob(attributes, attributesSize);
-
-		if (!query_insert.addRow(stream)) {
-			return false;
-		}
+		data.sid = runningId;
+		data.pid = it->first;
+		data.type = item->getID();
+		data.count = item->getSubType();
+		data.attributes.assign(attributes, attributesSize);
+		items.push_back(data);
 
 		if (Container* container = item->getContainer()) {
 			stack.push_back(containerBlock(container, runningId));
@@ -428,47 +674,191 @@ bool IOPlayer::saveItems(Player* player, const ItemBlockList& itemList, DBInsert
 			item->serializeAttr(propWriteStream);
 			const char* attributes = propWriteStream.getStream(attributesSize);
 
-			stream << player->getGUID() << ", " << parentId << ", " << runningId << ", "
-			       << item->getID() << ", " << (int32_t)item->getSubType() << ", "
-			       << db->escapeBlob(attributes, attributesSize);
+			data.sid = runningId;
+			data.pid = parentId;
+			data.type = item->getID();
+			data.count = item->getSubType();
+			data.attributes.assign(attributes, attributesSize);
+			items.push_back(data);
+		}
+	}
+}
 
-			if (!query_insert.addRow(stream)) {
-				return false;
-			}
+void IOPlayer::collectInventory(Player* player, std::vector<PlayerItemData>& items)
+{
+	ItemBlockList itemList;
+	for (int32_t slotId = 1; slotId <= 10; ++slotId) {
+		if (Item* item = player->inventory[slotId]) {
+			itemList.push_back(itemBlock(slotId, item));
+		}
+	}
+
+	collectItems(itemList, items);
+}
+
+std::string IOPlayer::getInventoryBlob(Player* player)
+{
+	std::vector<PlayerItemData> items;
+	collectInventory(player, items);
+	return serializeItems(items);
+}
+
+bool IOPlayer::replaceInventory(Database* db, uint32_t guid, const std::string& blob)
+{
+	std::vector<PlayerItemData> items;
+	if (!unserializeItems(blob.data(), blob.size(), items)) {
+		return false;
+	}
+
+	if (g_config.getBoolean(ConfigManager::PLAYER_ITEM_BLOBS)) {
+		// the depot half of the blob stays as it is
+		std::vector<PlayerItemData> oldItems, depotItems;
+		itemblob_t saved = loadItemBlobs(db, guid, oldItems, depotItems);
+		if (saved == ITEMBLOB_UNREADABLE) {
+			std::cout << "[Error - IOPlayer::replaceInventory] Not replacing the inventory of player "
+			          << guid << ", its depot items would be lost." << std::endl;
+			return false;
+		} else if (saved == ITEMBLOB_NONE) {
+			loadItemRows(db, guid, oldItems, depotItems);
+		}
+
+		return saveItemBlobs(db, guid, blob, serializeItems(depotItems));
+	}
+
+	if (!executeQueryById(db, "DELETE FROM `player_items` WHERE `player_id` = ?", guid)) {
+		return false;
+	}
+
+	DBInsert insert(db);
+	insert.setQuery("INSERT INTO `player_items` (`player_id` , `pid` , `sid` , `itemtype` , "
+	                "`count` , `attributes` ) VALUES ");
+	return saveItems(guid, items, insert) && insert.execute();
+}
+
+void IOPlayer::setInventorySnapshot(Player* player, const std::string& blob)
+{
+	if (player->hasSaveSnapshot) {
+		player->savedItems = blob;
+	}
+}
+
+std::string IOPlayer::serializeItems(const std::vector<PlayerItemData>& items)
+{
+	PropWriteStream stream;
+	stream.ADD_UINT16(ITEM_BLOB_VERSION);
+	stream.ADD_UINT32(items.size());
+	for (std::vector<PlayerItemData>::const_iterator it = items.begin(); it != items.end(); ++it) {
+		stream.ADD_INT32(it->sid);
+		stream.ADD_INT32(it->pid);
+		stream.ADD_UINT16(it->type);
+		stream.ADD_UINT16(it->count);
+		stream.ADD_LSTRING(it->attributes);
+	}
+
+	uint32_t size;
+	const char* blob = stream.getStream(size);
+	return std::string(blob, size);
+}
+
+bool IOPlayer::unserializeItems(const char* blob, unsigned long size, std::vector<PlayerItemData>& items)
+{
+	PropStream stream;
+	stream.init(blob, size);
+
+	uint16_t version;
+	uint32_t count;
+	if (!stream.GET_UINT16(version) || version != ITEM_BLOB_VERSION || !stream.GET_UINT32(count)) {
+		return false;
+	}
+
+	PlayerItemData data;
+	for (uint32_t i = 0; i < count; ++i) {
+		if (!stream.GET_INT32(data.sid) || !stream.GET_INT32(data.pid) ||
+		    !stream.GET_UINT16(data.type) || !stream.GET_UINT16(data.count) ||
+		    !stream.GET_LSTRING(data.attributes)) {
+			return false;
+		}
+
+		items.push_back(data);
+	}
+
+	return true;
+}
+
+bool IOPlayer::saveItems(uint32_t guid, const std::vector<PlayerItemData>& items, DBInsert& query_insert)
+{
+	std::stringstream stream;
+	Database* db = Database::instance();
+
+	for (std::vector<PlayerItemData>::const_iterator it = items.begin(); it != items.end(); ++it) {
+		stream << guid << ", " << it->pid << ", " << it->sid << ", " << it->type
+		       << ", " << (int32_t)it->count << ", "
+		       << db->escapeBlob(it->attributes.data(), it->attributes.size());
+
+		if (!query_insert.addRow(stream)) {
+			return false;
 		}
 	}
 
 	return true;
 }
 
+bool IOPlayer::saveItemBlobs(Database* db, uint32_t guid, const std::string& items,
+                             const std::string& depotItems)
+{
+	if (!executeQueryById(db, "DELETE FROM `player_itemblobs` WHERE `player_id` = ?", guid)) {
+		return false;
+	}
+
+	DBStatement* stmt = db->getStatement("INSERT INTO `player_itemblobs` (`player_id`, `items`, "
+	                                     "`depotitems`) VALUES (?, ?, ?)");
+	if (!stmt) {
+		return false;
+	}
+
+	stmt->bindInt(guid);
+	stmt->bindBlob(items.data(), items.size());
+	stmt->bindBlob(depotItems.data(), depotItems.size());
+	if (!stmt->executeQuery()) {
+		return false;
+	}
+
+	// rows of a player that was not migrated yet
+	return executeQueryById(db, "DELETE FROM `player_items` WHERE `player_id` = ?", guid) &&
+	       executeQueryById(db, "DELETE FROM `player_depotitems` WHERE `player_id` = ?", guid);
+}
+
 bool IOPlayer::savePlayer(Player* player)
 {
+	DBQueryOrigin origin("IOPlayer::savePlayer");
 	player->preSave();
 
 	Database* db = Database::instance();
 	DBQuery query;
+	DBStatement* stmt;
 	DBResult* result;
 
 	// check if the player have to be saved or not
-	query << "SELECT `save` FROM `players` WHERE `id` = " << player->getGUID();
-	if (!(result = db->storeQuery(query.str()))) {
+	if (!(result = storeQueryById(db, "SELECT `save` FROM `players` WHERE `id` = ?", player->getGUID()))) {
 		return false;
 	}
 
 	const uint32_t save = result->getDataInt("save");
 	db->freeResult(result);
 	if (save == 0) {
-
-		query.str("");
-		query << "UPDATE `players` SET `lastlogin` = " << player->lastLoginSaved
-		      << ", `lastip` = " << player->lastip << " WHERE `id` = " << player->getGUID();
-
 		DBTransaction transaction(db);
 		if (!transaction.begin()) {
 			return false;
 		}
 
-		if (!db->executeQuery(query.str())) {
+		if (!(stmt = db->getStatement("UPDATE `players` SET `lastlogin` = ?, `lastip` = ? WHERE `id` = ?"))) {
+			return false;
+		}
+
+		stmt->bindInt(player->lastLoginSaved);
+		stmt->bindInt(player->lastip);
+		stmt->bindInt(player->getGUID());
+		if (!stmt->executeQuery()) {
 			return false;
 		}
 
@@ -492,33 +882,63 @@ bool IOPlayer::savePlayer(Player* player)
 	uint32_t conditionsSize;
 	const char* conditions = propWriteStream.getStream(conditionsSize);
 
+	DBTransaction transaction(db);
+	if (!transaction.begin()) {
+		return false;
+	}
+
 	// First, an UPDATE query to write the player itself
-	query.str("");
-	query << "UPDATE `players` SET `level` = " << player->level
-	      << ", `vocation` = " << (int)player->getVocationId()
-	      << ", `health` = " << player->health << ", `healthmax` = " << player->healthMax
-	      << ", `direction` = " << (int)player->getDirection() << ", `experience` = " << player->experience
-	      << ", `lookbody` = " << (int)player->defaultOutfit.lookBody
-	      << ", `lookfeet` = " << (int)player->defaultOutfit.lookFeet
-	      << ", `lookhead` = " << (int)player->defaultOutfit.lookHead
-	      << ", `looklegs` = " << (int)player->defaultOutfit.lookLegs
-	      << ", `looktype` = " << (int)player->defaultOutfit.lookType
-	      << ", `maglevel` = " << player->magLevel << ", `mana` = " << player->mana
-	      << ", `manamax` = " << player->manaMax << ", `manaspent` = " << player->manaSpent
+	if (!(stmt = db->getStatement("UPDATE `players` SET `level` = ?, `vocation` = ?, `health` = ?, "
+	                              "`healthmax` = ?, `direction` = ?, `experience` = ?, `lookbody` = ?, "
+	                              "`lookfeet` = ?, `lookhead` = ?, `looklegs` = ?, `looktype` = ?, "
+	                              "`maglevel` = ?, `mana` = ?, `manamax` = ?, `manaspent` = ?, "
 #ifdef __PROTOCOL_76__
-	      << ", `soul` = " << player->soul
+	                              "`soul` = ?, "
 #endif // __PROTOCOL_76__
-	      << ", `town_id` = " << player->town << ", `posx` = " << player->getLoginPosition().x
-	      << ", `posy` = " << player->getLoginPosition().y
-	      << ", `posz` = " << player->getLoginPosition().z << ", `cap` = " << player->getCapacity()
-	      << ", `sex` = " << player->sex << ", `lastlogin` = " << player->lastLoginSaved
-	      << ", `lastlogout` = " << player->lastLogout << ", `lastip` = " << player->lastip
-	      << ", `conditions` = " << db->escapeBlob(conditions, conditionsSize)
-	      << ", `loss_experience` = " << (int)player->getLossPercent(LOSS_EXPERIENCE)
-	      << ", `loss_mana` = " << (int)player->getLossPercent(LOSS_MANASPENT)
-	      << ", `loss_skills` = " << (int)player->getLossPercent(LOSS_SKILLTRIES)
-	      << ", `loss_items` = " << (int)player->getLossPercent(LOSS_ITEMS)
-	      << ", `balance` = " << player->balance;
+	                              "`town_id` = ?, `posx` = ?, `posy` = ?, `posz` = ?, `cap` = ?, "
+	                              "`sex` = ?, `lastlogin` = ?, `lastlogout` = ?, `lastip` = ?, "
+	                              "`conditions` = ?, `loss_experience` = ?, `loss_mana` = ?, "
+	                              "`loss_skills` = ?, `loss_items` = ?, `balance` = ?"
+#ifdef __SKULLSYSTEM__
+	                              ", `redskulltime` = ?, `redskull` = ?"
+#endif
+	                              " WHERE `id` = ?"))) {
+		return false;
+	}
+
+	stmt->bindInt(player->level);
+	stmt->bindInt(player->getVocationId());
+	stmt->bindInt(player->health);
+	stmt->bindInt(player->healthMax);
+	stmt->bindInt(player->getDirection());
+	stmt->bindInt(player->experience);
+	stmt->bindInt(player->defaultOutfit.lookBody);
+	stmt->bindInt(player->defaultOutfit.lookFeet);
+	stmt->bindInt(player->defaultOutfit.lookHead);
+	stmt->bindInt(player->defaultOutfit.lookLegs);
+	stmt->bindInt(player->defaultOutfit.lookType);
+	stmt->bindInt(player->magLevel);
+	stmt->bindInt(player->mana);
+	stmt->bindInt(player->manaMax);
+	stmt->bindInt(player->manaSpent);
+#ifdef __PROTOCOL_76__
+	stmt->bindInt(player->soul);
+#endif // __PROTOCOL_76__
+	stmt->bindInt(player->town);
+	stmt->bindInt(player->getLoginPosition().x);
+	stmt->bindInt(player->getLoginPosition().y);
+	stmt->bindInt(player->getLoginPosition().z);
+	stmt->bindInt(player->getCapacity());
+	stmt->bindInt(player->sex);
+	stmt->bindInt(player->lastLoginSaved);
+	stmt->bindInt(player->lastLogout);
+	stmt->bindInt(player->lastip);
+	stmt->bindBlob(conditions, conditionsSize);
+	stmt->bindInt(player->getLossPercent(LOSS_EXPERIENCE));
+	stmt->bindInt(player->getLossPercent(LOSS_MANASPENT));
+	stmt->bindInt(player->getLossPercent(LOSS_SKILLTRIES));
+	stmt->bindInt(player->getLossPercent(LOSS_ITEMS));
+	stmt->bindInt(player->balance);
 
 #ifdef __SKULLSYSTEM__
 	int32_t redSkullTime = 0;
@@ -526,157 +946,177 @@ bool IOPlayer::savePlayer(Player* player)
 		redSkullTime = std::time(nullptr) + player->redSkullTicks / 1000;
 	}
 
-	query << ", `redskulltime` = " << redSkullTime;
-	query << ", `redskull` = " << (player->skull == SKULL_RED ? 1 : 0);
+	stmt->bindInt(redSkullTime);
+	stmt->bindInt(player->skull == SKULL_RED ? 1 : 0);
 #endif
 
-	query << " WHERE `id` = " << player->getGUID();
-
-	DBTransaction transaction(db);
-	if (!transaction.begin()) {
+	stmt->bindInt(player->getGUID());
+	if (!stmt->executeQuery()) {
 		return false;
 	}
 
-	if (!db->executeQuery(query.str())) {
+	// skills
+	if (!(stmt = db->getStatement("UPDATE `player_skills` SET `value` = ?, `count` = ? WHERE "
+	                              "`player_id` = ? AND `skillid` = ?"))) {
 		return false;
 	}
-	query.str("");
 
-	// skills
 	for (int i = 0; i <= 6; i++) {
-		query << "UPDATE `player_skills` SET `value` = " << player->skills[i][SKILL_LEVEL]
-		      << ", `count` = " << player->skills[i][SKILL_TRIES]
-		      << " WHERE `player_id` = " << player->getGUID() << " AND `skillid` = " << i;
+		stmt->bindInt(player->skills[i][SKILL_LEVEL]);
+		stmt->bindInt(player->skills[i][SKILL_TRIES]);
+		stmt->bindInt(player->getGUID());
+		stmt->bindInt(i);
 
-		if (!db->executeQuery(query.str())) {
+		if (!stmt->executeQuery()) {
 			return false;
 		}
-		query.str("");
 	}
 
-	// deletes all player-related stuff
-
-	query << "DELETE FROM `player_spells` WHERE `player_id` = " << player->getGUID();
-
-	if (!db->executeQuery(query.str())) {
-		return false;
-	}
-	query.str("");
+	// only the sections that changed since the last save are rewritten
+	DBInsert insert(db);
+	bool itemBlobs = g_config.getBoolean(ConfigManager::PLAYER_ITEM_BLOBS);
 
-	query << "DELETE FROM `player_items` WHERE `player_id` = " << player->getGUID();
-
-	if (!db->executeQuery(query.str())) {
-		return false;
-	}
-	query.str("");
-
-	query << "DELETE FROM `player_depotitems` WHERE `player_id` = " << player->getGUID();
-
-	if (!db->executeQuery(query.str())) {
-		return false;
-	}
-	query.str("");
-
-	query << "DELETE FROM `player_storage` WHERE `player_id` = " << player->getGUID();
+	if (player->spellsDirty) {
+		if (!executeQueryById(db, "DELETE FROM `player_spells` WHERE `player_id` = ?", player->getGUID())) {
+			return false;
+		}
 
-	if (!db->executeQuery(query.str())) {
-		return false;
-	}
-	query.str("");
+		insert.setQuery("INSERT INTO `player_spells` (`player_id`, `name`) VALUES ");
+		for (LearnedInstantSpellList::const_iterator it = player->learnedInstantSpellList.begin();
+		     it != player->learnedInstantSpellList.end(); ++it) {
+			query << player->getGUID() << ", " << db->escapeString(*it);
 
-	query << "DELETE FROM `player_viplist` WHERE `player_id` = " << player->getGUID();
+			if (!insert.addRow(query)) {
+				return false;
+			}
+		}
 
-	if (!db->executeQuery(query.str())) {
-		return false;
+		if (!insert.execute()) {
+			return false;
+		}
 	}
-	query.str("");
 
-	DBInsert stmt(db);
-
-	// learned spells
-	stmt.setQuery("INSERT INTO `player_spells` (`player_id`, `name`) VALUES ");
-	for (LearnedInstantSpellList::const_iterator it = player->learnedInstantSpellList.begin();
-	     it != player->learnedInstantSpellList.end(); ++it) {
-		query << player->getGUID() << ", " << db->escapeString(*it);
+	std::vector<PlayerItemData> items;
+	collectInventory(player, items);
+	std::string savedItems = serializeItems(items);
+	bool itemsChanged = (!player->hasSaveSnapshot || savedItems != player->savedItems);
+	if (itemsChanged && !itemBlobs) {
+		if (!executeQueryById(db, "DELETE FROM `player_items` WHERE `player_id` = ?", player->getGUID())) {
+			return false;
+		}
 
-		if (!stmt.addRow(query)) {
+		// item saving
+		insert.setQuery("INSERT INTO `player_items` (`player_id` , `pid` , `sid` , `itemtype` , "
+		                "`count` , `attributes` ) VALUES ");
+		if (!(saveItems(player->getGUID(), items, insert) && insert.execute())) {
 			return false;
 		}
 	}
 
-	if (!stmt.execute()) {
-		return false;
+	ItemBlockList itemList;
+	items.clear();
+	for (DepotMap::iterator it = player->depots.begin(); it != player->depots.end(); ++it) {
+		itemList.push_back(itemBlock(it->first, it->second));
 	}
 
-	ItemBlockList itemList;
+	collectItems(itemList, items);
+	std::string savedDepotItems = serializeItems(items);
+	bool depotChanged = (!player->hasSaveSnapshot || savedDepotItems != player->savedDepotItems);
+	if (depotChanged && !itemBlobs) {
+		if (!executeQueryById(db, "DELETE FROM `player_depotitems` WHERE `player_id` = ?",
+		                      player->getGUID())) {
+			return false;
+		}
 
-	Item* item;
-	for (int32_t slotId = 1; slotId <= 10; ++slotId) {
-		if ((item = player->inventory[slotId])) {
-			itemList.push_back(itemBlock(slotId, item));
+		// save depot items
+		insert.setQuery("INSERT INTO `player_depotitems` (`player_id` , `pid` , `sid` , "
+		                "`itemtype` , `count` , `attributes` ) VALUES ");
+		if (!(saveItems(player->getGUID(), items, insert) && insert.execute())) {
+			return false;
 		}
 	}
 
-	// item saving
-	stmt.setQuery("INSERT INTO `player_items` (`player_id` , `pid` , `sid` , `itemtype` , "
-	              "`count` , `attributes` ) VALUES ");
-	if (!(saveItems(player, itemList, stmt) && stmt.execute())) {
+	if ((itemsChanged || depotChanged) && itemBlobs &&
+	    !saveItemBlobs(db, player->getGUID(), savedItems, savedDepotItems)) {
 		return false;
 	}
 
-	itemList.clear();
-	for (DepotMap::iterator it = player->depots.begin(); it != player->depots.end(); ++it) {
-		itemList.push_back(itemBlock(it->first, it->second));
-	}
+	if (player->storageDirty) {
+		if (!executeQueryById(db, "DELETE FROM `player_storage` WHERE `player_id` = ?", player->getGUID())) {
+			return false;
+		}
 
-	// save depot items
-	stmt.setQuery("INSERT INTO `player_depotitems` (`player_id` , `pid` , `sid` , `itemtype` , "
-	              "`count` , `attributes` ) VALUES ");
-	if (!(saveItems(player, itemList, stmt) && stmt.execute())) {
-		return false;
-	}
+		insert.setQuery("INSERT INTO `player_storage` (`player_id` , `key` , `value` ) VALUES ");
+		for (StorageMap::const_iterator cit = player->getStorageIteratorBegin();
+		     cit != player->getStorageIteratorEnd(); cit++) {
+			query << player->getGUID() << ", " << cit->first << ", " << cit->second;
 
-	stmt.setQuery("INSERT INTO `player_storage` (`player_id` , `key` , `value` ) VALUES ");
-	for (StorageMap::const_iterator cit = player->getStorageIteratorBegin();
-	     cit != player->getStorageIteratorEnd(); cit++) {
-		query << player->getGUID() << ", " << cit->first << ", " << cit->second;
+			if (!insert.addRow(query)) {
+				return false;
+			}
+		}
 
-		if (!stmt.addRow(query)) {
+		if (!insert.execute()) {
 			return false;
 		}
 	}
 
-	if (!stmt.execute()) {
-		return false;
-	}
-
 	// save vip list
-	if (!player->VIPList.empty()) {
-		query << "INSERT INTO `player_viplist` (`player_id`, `vip_id`) SELECT "
-		      << player->getGUID() << ", `id` FROM `players` WHERE `id` IN (";
+	if (player->vipListDirty) {
+		if (!executeQueryById(db, "DELETE FROM `player_viplist` WHERE `player_id` = ?", player->getGUID())) {
+			return false;
+		}
 
-		for (VIPListSet::iterator it = player->VIPList.begin(); it != player->VIPList.end();) {
-			query << (*it);
-			++it;
+		if (!player->VIPList.empty()) {
+			query << "INSERT INTO `player_viplist` (`player_id`, `vip_id`) SELECT "
+			      << player->getGUID() << ", `id` FROM `players` WHERE `id` IN (";
 
-			if (it != player->VIPList.end()) {
-				query << ",";
-			} else {
-				query << ")";
+			for (VIPListSet::iterator it = player->VIPList.begin(); it != player->VIPList.end();) {
+				query << (*it);
+				++it;
+
+				if (it != player->VIPList.end()) {
+					query << ",";
+				} else {
+					query << ")";
+				}
 			}
-		}
 
-		if (!db->executeQuery(query.str())) {
-			return false;
+			if (!db->executeQuery(query.str())) {
+				return false;
+			}
 		}
 	}
 
 	// End the transaction
-	return transaction.commit();
+	if (!transaction.commit()) {
+		return false;
+	}
+
+	player->savedItems.swap(savedItems);
+	player->savedDepotItems.swap(savedDepotItems);
+	player->hasSaveSnapshot = true;
+	player->spellsDirty = false;
+	player->storageDirty = false;
+	player->vipListDirty = false;
+
+	PlayerJournal::getInstance().addSaved(player);
+	return true;
+}
+
+void IOPlayer::dropSaveSnapshot(Player* player)
+{
+	player->hasSaveSnapshot = false;
+	player->savedItems.clear();
+	player->savedDepotItems.clear();
+	player->spellsDirty = true;
+	player->storageDirty = true;
+	player->vipListDirty = true;
 }
 
 void IOPlayer::saveDeath(std::string name, uint32_t time, uint16_t level, std::string killer, std::string altKiller)
 {
+	DBQueryOrigin origin("IOPlayer::saveDeath");
 	uint32_t guid;
 	if (!getGuidByName(guid, name)) {
 		return;
@@ -698,57 +1138,32 @@ void IOPlayer::saveDeath(std::string name, uint32_t time, uint16_t level, std::s
 	}
 }
 
-bool IOPlayer::storeNameByGuid(Database& db, uint32_t guid)
-{
-	DBQuery query;
-	DBResult* result;
-
-	NameCacheMap::iterator it = nameCacheMap.find(guid);
-	if (it != nameCacheMap.end()) {
-		return true;
-	}
-
-	query << "SELECT `name` FROM `players` WHERE `id` = " << guid;
-
-	if (!(result = db.storeQuery(query.str()))) {
-		return false;
-	}
-
-	nameCacheMap[guid] = result->getDataString("name");
-	db.freeResult(result);
-	return true;
-}
-
 bool IOPlayer::getNameByGuid(uint32_t guid, std::string& name)
 {
-	NameCacheMap::iterator it = nameCacheMap.find(guid);
-	if (it != nameCacheMap.end()) {
-		name = it->second;
+	if (PlayerDirectory::getInstance().getNameByGuid(guid, name)) {
 		return true;
 	}
 
+	// made after the directory was loaded
 	Database* db = Database::instance();
 	DBQuery query;
 	DBResult* result;
 
-	query << "SELECT `name` FROM `players` WHERE `id` = " << guid;
+	query << "SELECT `name`, `group_id` FROM `players` WHERE `id` = " << guid;
 
 	if (!(result = db->storeQuery(query.str()))) {
 		return false;
 	}
 
 	name = result->getDataString("name");
-	nameCacheMap[guid] = name;
+	PlayerDirectory::getInstance().update(guid, name, result->getDataInt("group_id"));
 	db->freeResult(result);
 	return true;
 }
 
 bool IOPlayer::getGuidByName(uint32_t& guid, std::string& name)
 {
-	GuidCacheMap::iterator it = guidCacheMap.find(name);
-	if (it != guidCacheMap.end()) {
-		name = it->first;
-		guid = it->second;
+	if (PlayerDirectory::getInstance().getGuidByName(guid, name)) {
 		return true;
 	}
 
@@ -756,7 +1171,7 @@ bool IOPlayer::getGuidByName(uint32_t& guid, std::string& name)
 	DBResult* result;
 	DBQuery query;
 
-	if (!(result = db->storeQuery("SELECT `name`, `id` FROM `players` WHERE `name` = " +
+	if (!(result = db->storeQuery("SELECT `name`, `id`, `group_id` FROM `players` WHERE `name` = " +
 	                              db->escapeString(name)))) {
 		return false;
 	}
@@ -764,7 +1179,7 @@ bool IOPlayer::getGuidByName(uint32_t& guid, std::string& name)
 	name = result->getDataString("name");
 	guid = result->getDataInt("id");
 
-	guidCacheMap[name] = guid;
+	PlayerDirectory::getInstance().update(guid, name, result->getDataInt("group_id"));
 	db->freeResult(result);
 	return true;
 }
@@ -788,27 +1203,26 @@ uint32_t IOPlayer::getAccountIdByName(std::string& name)
 
 bool IOPlayer::getGuidByNameEx(uint32_t& guid, bool& specialVip, std::string& name)
 {
-	Database* db = Database::instance();
-	DBResult* result;
-	DBQuery query;
-
-	if (!(result = db->storeQuery(
-	      "SELECT `name`, `id`, `group_id` FROM `players` WHERE `name`= " + db->escapeString(name)))) {
+	uint32_t groupId;
+	if (!getGuidByName(guid, name) || !PlayerDirectory::getInstance().getGroupId(guid, groupId)) {
 		return false;
 	}
 
+	specialVip = isSpecialVip(groupId);
+	return true;
+}
+
+void IOPlayer::readVipEntry(DBResult* result, uint32_t& guid, bool& specialVip, std::string& name)
+{
 	name = result->getDataString("name");
 	guid = result->getDataInt("id");
-	const PlayerGroup* group = getPlayerGroup(result->getDataInt("group_id"));
-
-	if (group) {
-		specialVip = (0 != (group->m_flags & ((uint64_t)1 << PlayerFlag_SpecialVIP)));
-	} else {
-		specialVip = false;
-	}
+	specialVip = isSpecialVip(result->getDataInt("group_id"));
+}
 
-	db->freeResult(result);
-	return true;
+bool IOPlayer::isSpecialVip(uint32_t groupId)
+{
+	const PlayerGroup* group = getPlayerGroup(groupId);
+	return group && (0 != (group->m_flags & ((uint64_t)1 << PlayerFlag_SpecialVIP)));
 }
 
 bool IOPlayer::getGuildIdByName(uint32_t& guildId, const std::string& guildName)
@@ -828,16 +1242,8 @@ bool IOPlayer::getGuildIdByName(uint32_t& guildId, const std::string& guildName)
 
 bool IOPlayer::playerExists(std::string name)
 {
-	Database* db = Database::instance();
-	DBResult* result;
-	DBQuery query;
-
-	if (!(result = db->storeQuery("SELECT `id` FROM `players` WHERE `name`= " + db->escapeString(name)))) {
-		return false;
-	}
-
-	db->freeResult(result);
-	return true;
+	uint32_t guid;
+	return getGuidByName(guid, name);
 }
 
 bool IOPlayer::hasFlag(std::string name, PlayerFlags value)
@@ -948,28 +1354,39 @@ uint32_t IOPlayer::getLastIP(std::string name) const
 	return lastip;
 }
 
-void IOPlayer::loadItems(ItemMap& itemMap, DBResult* result)
+void IOPlayer::readItems(std::vector<PlayerItemData>& items, DBResult* result)
 {
 	do {
-		int sid = result->getDataInt("sid");
-		int pid = result->getDataInt("pid");
-		int type = result->getDataInt("itemtype");
-		int count = result->getDataInt("count");
+		PlayerItemData row;
+		row.sid = result->getDataInt("sid");
+		row.pid = result->getDataInt("pid");
+		row.type = result->getDataInt("itemtype");
+		row.count = result->getDataInt("count");
 
 		unsigned long attrSize = 0;
 		const char* attr = result->getDataStream("attributes", attrSize);
+		if (attr) {
+			row.attributes.assign(attr, attrSize);
+		}
 
+		items.push_back(row);
+	} while (result->next());
+}
+
+void IOPlayer::loadItems(ItemMap& itemMap, const std::vector<PlayerItemData>& items)
+{
+	for (std::vector<PlayerItemData>::const_iterator it = items.begin(); it != items.end(); ++it) {
 		PropStream propStream;
-		propStream.init(attr, attrSize);
+		propStream.init(it->attributes.data(), it->attributes.size());
 
-		Item* item = Item::CreateItem(type, count);
+		Item* item = Item::CreateItem(it->type, it->count);
 		if (item) {
 			if (!item->unserializeAttr(propStream)) {
 				std::cout << "WARNING: Serialize error in IOPlayer::loadItems" << std::endl;
 			}
 
-			std::pair<Item*, int> pair(item, pid);
-			itemMap[sid] = pair;
+			std::pair<Item*, int> pair(item, it->pid);
+			itemMap[it->sid] = pair;
 		}
-	} while (result->next());
+	}
 }
@@ -26,6 +26,7 @@
 #include "player.h"
 
 #include <string>
+#include <vector>
 
 class PlayerGroup
 {
@@ -40,6 +41,90 @@ public:
 	uint32_t m_maxVip;
 };
 
+/** A row of player_items or player_depotitems */
+struct PlayerItemData {
+	int32_t sid;
+	int32_t pid;
+	uint16_t type;
+	uint16_t count;
+	std::string attributes;
+};
+
+/** A row of player_skills */
+struct PlayerSkillData {
+	int32_t skillId;
+	uint32_t level;
+	uint32_t tries;
+};
+
+/** What loadItemBlobs found for a player */
+enum itemblob_t { ITEMBLOB_NONE, ITEMBLOB_LOADED, ITEMBLOB_UNREADABLE };
+
+/** Everything loadPlayer reads from the database, kept as plain values so the
+  * queries can run away from the dispatcher and the game objects are only
+  * built once the data is handed back to it.
+  */
+struct PlayerLoadData {
+	// players
+	uint32_t guid = 0;
+	std::string name;
+	uint32_t accountNumber = 0;
+	uint32_t groupId = 0;
+	int32_t sex = 0;
+	int32_t direction = 0;
+	int32_t level = 0;
+	uint64_t experience = 0;
+	int32_t soul = 0;
+	int32_t capacity = 0;
+	int32_t lastLogin = 0;
+	int32_t lastLogout = 0;
+	int32_t health = 0;
+	int32_t healthMax = 0;
+	int32_t lookType = 0;
+	int32_t lookHead = 0;
+	int32_t lookBody = 0;
+	int32_t lookLegs = 0;
+	int32_t lookFeet = 0;
+	int32_t redSkullTime = 0;
+	int32_t redSkull = 0;
+	std::string conditions;
+	int32_t vocation = 0;
+	int32_t mana = 0;
+	int32_t manaMax = 0;
+	int32_t magLevel = 0;
+	uint32_t manaSpent = 0;
+	int32_t lossExperience = 0;
+	int32_t lossMana = 0;
+	int32_t lossSkills = 0;
+	int32_t lossItems = 0;
+	Position loginPosition;
+	uint32_t townId = 0;
+	uint32_t rankId = 0;
+	int32_t balance = 0;
+	std::string guildNick;
+
+	// guild_ranks, guilds
+	bool hasGuild = false;
+	std::string guildName;
+	std::string guildRank;
+	uint32_t guildLevel = 0;
+	uint32_t guildId = 0;
+
+	// accounts
+	bool hasAccount = false;
+	std::string password;
+	int32_t premEnd = 0;
+
+	std::vector<PlayerSkillData> skills;
+	std::vector<std::string> spells;
+	std::vector<PlayerItemData> items;
+	std::vector<PlayerItemData> depotItems;
+	// loading the player without them would overwrite the blob on its next save
+	bool itemsUnreadable = false;
+	std::vector<std::pair<uint32_t, int32_t>> storage;
+	std::vector<std::pair<uint32_t, std::string>> vips;
+};
+
 typedef std::pair<int32_t, Item*> itemBlock;
 typedef std::list<itemBlock> ItemBlockList;
 
@@ -69,51 +154,109 @@ public:
 	  */
 	bool loadPlayer(Player* player, const std::string& name, bool preload = false);
 
+	/** Reads the players row without touching any game object,
+	  * safe to call from a database worker
+	  * \param data record to fill
+	  * \param name Name of the player
+	  * \param db connection to read from, the caller holds its lock if it is shared
+	  * \return returns true if the player exists
+	  */
+	bool loadPlayerData(PlayerLoadData& data, const std::string& name, Database* db);
+
+	/** Reads the rest of what a full load needs (guild, account, skills, spells,
+	  * items, depot, storage and vip list), safe to call from a database worker
+	  * \param data record filled by loadPlayerData
+	  * \param db connection to read from, the caller holds its lock if it is shared
+	  */
+	void loadPlayerDetails(PlayerLoadData& data, Database* db);
+
+	/** Builds the player from a loaded record, must run on the dispatcher
+	  * \param player Player structure to load to
+	  * \param data record filled by loadPlayerData and, unless preload, loadPlayerDetails
+	  * \param preload if set to true only group, guid and account id are set
+	  * \return returns false if the account of a full load was not found
+	  */
+	bool applyPlayerData(Player* player, const PlayerLoadData& data, bool preload = false);
+
 	/** Save a player
 	  * \param player the player to save
 	  * \return true if the player was successfully saved
 	  */
 	bool savePlayer(Player* player);
 
+	/** Forget what was last saved of a player, for when a save
+	  * reported as done was rolled back afterwards
+	  * \param player the player whose next save rewrites everything
+	  */
+	void dropSaveSnapshot(Player* player);
+
+	/** Inventory of a player packed the way player_itemblobs keeps it */
+	std::string getInventoryBlob(Player* player);
+
+	/** Overwrites the saved inventory of a player, depot items are kept
+	  * \param blob packed by getInventoryBlob
+	  * \return false if the blob or the saved one can't be read or a query failed
+	  */
+	bool replaceInventory(Database* db, uint32_t guid, const std::string& blob);
+
+	/** Tells an online player's next save that the database now holds
+	  * this inventory
+	  */
+	void setInventorySnapshot(Player* player, const std::string& blob);
+
 	// bool loadDepot(Player* player, unsigned long depotId);
 
 	bool getGuidByName(uint32_t& guid, std::string& name);
 	uint32_t getAccountIdByName(std::string& name);
 	bool getGuidByNameEx(uint32_t& guid, bool& specialVip, std::string& name);
+	/** Reads a `name`, `id`, `group_id` row of the players table the way
+	  * getGuidByNameEx does, for lookups that ran on a database worker
+	  */
+	void readVipEntry(DBResult* result, uint32_t& guid, bool& specialVip, std::string& name);
 	bool getNameByGuid(uint32_t guid, std::string& name);
 	bool getGuildIdByName(uint32_t& guildId, const std::string& guildName);
 	bool playerExists(std::string name);
 	uint32_t getLastIP(std::string name) const;
 	void saveDeath(std::string name, uint32_t time, uint16_t level, std::string killer, std::string altKiller);
 
+	/** Moves every player's items to the format PlayerItemBlobs selects,
+	  * rows to player_itemblobs or back
+	  * \return false if a query failed, the player it stopped at is left as it was
+	  */
+	bool migrateItems();
+
 	bool hasFlag(std::string name, PlayerFlags value);
 	uint32_t getAccessByName(std::string name);
 
 protected:
-	bool storeNameByGuid(Database& mysql, uint32_t guid);
-
 	const PlayerGroup* getPlayerGroup(uint32_t groupid);
+	bool isSpecialVip(uint32_t groupId);
 	bool internalHasFlag(uint32_t groupId, PlayerFlags value);
 
-	struct StringCompareCase {
-		bool operator()(const std::string& l, const std::string& r) const
-		{
-			return asLowerCaseString(l).compare(asLowerCaseString(r)) < 0;
-		}
-	};
-
 	typedef std::map<int, std::pair<Item*, int>> ItemMap;
 
-	void loadItems(ItemMap& itemMap, DBResult* result);
-	bool saveItems(Player* player, const ItemBlockList& itemList, DBInsert& query_insert);
+	void readItems(std::vector<PlayerItemData>& items, DBResult* result);
+	void loadItems(ItemMap& itemMap, const std::vector<PlayerItemData>& items);
+	/** Flattens item trees into rows numbered the way they are saved */
+	void collectItems(const ItemBlockList& itemList, std::vector<PlayerItemData>& items);
+	void collectInventory(Player* player, std::vector<PlayerItemData>& items);
+	/** Packs rows into the versioned blob of player_itemblobs, also used to
+	  * tell whether a section changed since it was saved
+	  */
+	std::string serializeItems(const std::vector<PlayerItemData>& items);
+	bool unserializeItems(const char* blob, unsigned long size, std::vector<PlayerItemData>& items);
+	bool saveItems(uint32_t guid, const std::vector<PlayerItemData>& items, DBInsert& query_insert);
+	bool saveItemBlobs(Database* db, uint32_t guid, const std::string& items,
+	                   const std::string& depotItems);
+	void loadItemRows(Database* db, uint32_t guid, std::vector<PlayerItemData>& items,
+	                  std::vector<PlayerItemData>& depotItems);
+	/** Only ITEMBLOB_NONE means the items may still be in the old rows */
+	itemblob_t loadItemBlobs(Database* db, uint32_t guid, std::vector<PlayerItemData>& items,
+	                         std::vector<PlayerItemData>& depotItems);
 
-	typedef std::map<uint32_t, std::string> NameCacheMap;
-	typedef std::map<std::string, uint32_t, StringCompareCase> GuidCacheMap;
 	typedef std::map<uint32_t, PlayerGroup*> PlayerGroupMap;
 
 	PlayerGroupMap playerGroupMap;
-	NameCacheMap nameCacheMap;
-	GuidCacheMap guidCacheMap;
 };
 
 #endif
@@ -24,7 +24,6 @@
 #include "spells.h"
 #include "weapons.h"
 
-#include <boost/algorithm/string/predicate.hpp>
 #include <libxml/parser.h>
 #include <libxml/xmlmemory.h>
 
@@ -66,6 +65,7 @@ ItemType::ItemType()
 	wieldInfo = 0;
 	minReqLevel = 0;
 	minReqMagicLevel = 0;
+	hasMoveEvent = false;
 
 	runeMagLevel = 0;
 	runeLevel = 0;
@@ -1390,6 +1390,7 @@ bool Items::loadFromXml(const std::string& datadir)
 		*/
 	}
 
+	buildNameMap();
 	return true;
 }
 
@@ -1516,18 +1517,38 @@ bool Abilities::Absorb::reduce(CombatType_t ctype, int32_t& dmg) const
 
 int32_t Items::getItemIdByName(const std::string& name)
 {
-	if (!name.empty()) {
-		uint32_t i = 100;
-		ItemType* iType;
-		do {
-			iType = items.getElement(i);
-			if (iType) {
-				if (boost::algorithm::iequals(name, iType->name)) {
-					return i;
-				}
-			}
-			i++;
-		} while (iType);
+	NameMap::const_iterator it = nameMap.find(asLowerCaseString(name));
+	if (it != nameMap.end()) {
+		return it->second;
 	}
 	return -1;
 }
+
+void Items::buildNameMap()
+{
+	nameMap.clear();
+
+	// names first so a plural never hides the item that is called that
+	uint32_t duplicates = 0;
+	for (uint32_t i = 100; i < items.size(); ++i) {
+		const ItemType* iType = items.getElement(i);
+		if (iType && !iType->name.empty()) {
+			if (!nameMap.insert(NameMap::value_type(asLowerCaseString(iType->name), i)).second) {
+				++duplicates;
+			}
+		}
+	}
+
+	for (uint32_t i = 100; i < items.size(); ++i) {
+		const ItemType* iType = items.getElement(i);
+		if (iType && !iType->pluralName.empty()) {
+			nameMap.insert(NameMap::value_type(asLowerCaseString(iType->pluralName), i));
+		}
+	}
+
+	if (duplicates != 0) {
+		std::cout << "Warning: [Items::buildNameMap] " << duplicates
+		          << " items share their name with a lower id, getItemIdByName returns the lowest one."
+		          << std::endl;
+	}
+}
@@ -2,6 +2,7 @@
 #define __OTSERV_ITEMS_H__
 
 #include <map>
+#include <unordered_map>
 
 #include "const.h"
 #include "definitions.h"
@@ -213,6 +214,8 @@ public:
 	std::string vocationString;
 	uint32_t minReqLevel;
 	uint32_t minReqMagicLevel;
+	// an itemid move event is registered for this type
+	bool hasMoveEvent;
 
 	int32_t lightLevel;
 	int32_t lightColor;
@@ -289,6 +292,10 @@ public:
 	ItemType& getItemType(int32_t id);
 	const ItemType& getItemIdByClientId(int32_t spriteId) const;
 
+	/** Case insensitive, also matches plural names. When items share a
+	  * name the lowest id is returned.
+	  * \return the item id or -1 if no item has that name
+	  */
 	int32_t getItemIdByName(const std::string& name);
 
 	static uint32_t dwMajorVersion;
@@ -312,6 +319,11 @@ protected:
 	typedef std::map<int32_t, int32_t> ReverseItemMap;
 	ReverseItemMap reverseItemMap;
 
+	// lower case names and plural names to ids, built by loadFromXml
+	typedef std::unordered_map<std::string, int32_t> NameMap;
+	NameMap nameMap;
+	void buildNameMap();
+
 	Array<ItemType*> items;
 	std::string m_datadir;
 };
@@ -0,0 +1,94 @@
+#include "otpch.h"
+
+#include "luachunkcache.h"
+
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iterator>
+
+#include "configmanager.h"
+
+extern "C" {
+#include <lauxlib.h>
+}
+
+extern ConfigManager g_config;
+
+static int writeChunk(lua_State* L, const void* p, size_t size, void* ud)
+{
+	static_cast<std::string*>(ud)->append(static_cast<const char*>(p), size);
+	return 0;
+}
+
+int LuaChunkCache::load(lua_State* L, const std::string& file)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	int ret;
+	if (!g_config.getBoolean(ConfigManager::LUA_CHUNK_CACHE)) {
+		ret = luaL_loadfile(L, file.c_str());
+		if (ret == 0) {
+			++m_compiled;
+		}
+	} else {
+		ret = cachedLoad(L, file);
+	}
+
+	m_micros += std::chrono::duration_cast<std::chrono::microseconds>(
+	            std::chrono::steady_clock::now() - start)
+	            .count();
+	return ret;
+}
+
+int LuaChunkCache::cachedLoad(lua_State* L, const std::string& file)
+{
+	std::ifstream source(file.c_str(), std::ios::binary);
+	if (!source.is_open()) {
+		// let lua report the missing file
+		m_chunks.erase(file);
+		return luaL_loadfile(L, file.c_str());
+	}
+
+	// reading is cheap next to parsing, and unlike the mtime it catches every edit
+	std::string content((std::istreambuf_iterator<char>(source)), std::istreambuf_iterator<char>());
+	source.close();
+	size_t hash = std::hash<std::string>()(content);
+
+	ChunkMap::const_iterator it = m_chunks.find(file);
+	if (it != m_chunks.end() && it->second.size == content.size() && it->second.hash == hash) {
+		// the chunk name is kept for error messages, the bytecode has its own
+		std::string name = "@" + file;
+		int ret = luaL_loadbuffer(L, it->second.bytecode.data(), it->second.bytecode.size(), name.c_str());
+		if (ret == 0) {
+			++m_cached;
+			return 0;
+		}
+
+		m_chunks.erase(file);
+		lua_pop(L, 1);
+	}
+
+	return compile(L, file, content, hash);
+}
+
+int LuaChunkCache::compile(lua_State* L, const std::string& file, const std::string& content, size_t hash)
+{
+	// the content that was hashed, the file may have changed since it was read
+	int ret = luaL_loadbuffer(L, content.data(), content.size(), ("@" + file).c_str());
+	if (ret != 0) {
+		m_chunks.erase(file);
+		return ret;
+	}
+
+	++m_compiled;
+
+	Chunk& chunk = m_chunks[file];
+	chunk.size = content.size();
+	chunk.hash = hash;
+	chunk.bytecode.clear();
+	if (lua_dump(L, writeChunk, &chunk.bytecode) != 0) {
+		m_chunks.erase(file);
+	}
+	return 0;
+}
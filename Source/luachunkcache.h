@@ -0,0 +1,83 @@
+//////////////////////////////////////////////////////////////////////
+// OpenTibia - an opensource roleplaying game
+//////////////////////////////////////////////////////////////////////
+// Compiled Lua chunks reused while their file does not change
+//////////////////////////////////////////////////////////////////////
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//////////////////////////////////////////////////////////////////////
+
+
+#ifndef __OTSERV_LUACHUNKCACHE_H__
+#define __OTSERV_LUACHUNKCACHE_H__
+
+#include "definitions.h"
+
+#include <string>
+#include <unordered_map>
+
+extern "C" {
+#include <lua.h>
+}
+
+/** Bytecode of every script file LuaScriptInterface::loadFile compiled,
+  * so global.lua, the npc libraries and the scripts of each reload are
+  * parsed once as long as the file content stays the same. Dispatcher
+  * thread only.
+  */
+class LuaChunkCache
+{
+public:
+	static LuaChunkCache& getInstance()
+	{
+		static LuaChunkCache instance;
+		return instance;
+	}
+
+	/** Same as luaL_loadfile, the chunk is left at the stack top */
+	int load(lua_State* L, const std::string& file);
+
+	/** Files compiled from source, files loaded from bytecode and the
+	  * time spent in load() for both since the start. Counted with the
+	  * cache disabled as well, to compare against.
+	  */
+	void getStats(uint32_t& compiled, uint32_t& cached, uint64_t& micros) const
+	{
+		compiled = m_compiled;
+		cached = m_cached;
+		micros = m_micros;
+	}
+
+protected:
+	LuaChunkCache() : m_compiled(0), m_cached(0), m_micros(0) {}
+
+	struct Chunk {
+		// of the source the bytecode was compiled from
+		size_t size;
+		size_t hash;
+		std::string bytecode;
+	};
+
+	int cachedLoad(lua_State* L, const std::string& file);
+	int compile(lua_State* L, const std::string& file, const std::string& content, size_t hash);
+
+	typedef std::unordered_map<std::string, Chunk> ChunkMap;
+	ChunkMap m_chunks;
+
+	uint32_t m_compiled;
+	uint32_t m_cached;
+	uint64_t m_micros;
+};
+
+#endif
@@ -9,6 +9,7 @@
 #include "baseevents.h"
 #include "combat.h"
 #include "condition.h"
+#include "databasetasks.h"
 #include "configmanager.h"
 #include "game.h"
 #include "house.h"
@@ -16,11 +17,14 @@
 #include "ioaccount.h"
 #include "ioplayer.h"
 #include "item.h"
+#include "luachunkcache.h"
 #include "luascript.h"
 #include "monsters.h"
 #include "movement.h"
 #include "party.h"
 #include "player.h"
+#include "querystats.h"
+#include "scriptprofiler.h"
 #include "spells.h"
 #include "status.h"
 #include "teleport.h"
@@ -83,25 +87,35 @@ void ScriptEnviroment::resetEnv()
 	m_callbackId = 0;
 	m_timerEvent = false;
 	m_interface = nullptr;
-	m_localMap.clear();
+	if (m_localMap.bucket_count() > 1024) {
+		// clear() would wipe every bucket a big script left behind on each call
+		ThingMap().swap(m_localMap);
+		ThingUidMap().swap(m_localUids);
+	} else {
+		m_localMap.clear();
+		m_localUids.clear();
+	}
 
-	for (auto& mit : m_tempItems) {
-		ItemList& itemList = mit.second;
-		for (auto& it : itemList) {
-			if (it->getParent() == nullptr) g_game.FreeThing(it);
+	// only the dispatcher fills these, npc script threads must not write them
+	if (!m_tempItems.empty()) {
+		for (auto& mit : m_tempItems) {
+			ItemList& itemList = mit.second;
+			for (auto& it : itemList) {
+				if (it->getParent() == nullptr) g_game.FreeThing(it);
+			}
 		}
-	}
 
-	m_tempItems.clear();
+		m_tempItems.clear();
+	}
 
 	if (!m_tempResults.empty()) {
 		Database* db = Database::instance();
 		for (auto& it : m_tempResults) {
 			if (it.second) db->freeResult(it.second);
 		}
-	}
 
-	m_tempResults.clear();
+		m_tempResults.clear();
+	}
 
 	m_realPos.x = 0;
 	m_realPos.y = 0;
@@ -113,6 +127,7 @@ void ScriptEnviroment::resetEnv()
 
 bool ScriptEnviroment::saveGameState()
 {
+	DBQueryOrigin origin("ScriptEnviroment::saveGameState");
 	Database* db = Database::instance();
 	DBQuery query;
 
@@ -140,6 +155,7 @@ bool ScriptEnviroment::saveGameState()
 
 bool ScriptEnviroment::loadGameState()
 {
+	DBQueryOrigin origin("ScriptEnviroment::loadGameState");
 	Database* db = Database::instance();
 	DBResult* result;
 	DBQuery query;
@@ -224,14 +240,32 @@ void ScriptEnviroment::removeUniqueThing(Thing* thing)
 	}
 }
 
+void ScriptEnviroment::setLocalThing(uint32_t uid, Thing* thing)
+{
+	ThingMap::iterator it = m_localMap.find(uid);
+	if (it != m_localMap.end()) {
+		eraseLocalThing(it);
+	}
+
+	m_localMap[uid] = thing;
+	m_localUids.insert(std::make_pair(thing, uid));
+}
+
+void ScriptEnviroment::eraseLocalThing(ThingMap::iterator it)
+{
+	ThingUidMap::iterator uit = m_localUids.find(it->second);
+	if (uit != m_localUids.end() && uit->second == it->first) {
+		m_localUids.erase(uit);
+	}
+	m_localMap.erase(it);
+}
+
 uint32_t ScriptEnviroment::addThing(Thing* thing)
 {
 	if (thing && !thing->isRemoved()) {
-		ThingMap::iterator it;
-		for (it = m_localMap.begin(); it != m_localMap.end(); ++it) {
-			if (it->second == thing) {
-				return it->first;
-			}
+		ThingUidMap::iterator it = m_localUids.find(thing);
+		if (it != m_localUids.end()) {
+			return it->second;
 		}
 
 		uint32_t newUid;
@@ -241,7 +275,7 @@ uint32_t ScriptEnviroment::addThing(Thing* thing)
 			if (Item* item = thing->getItem()) {
 				uint32_t uid = item->getUniqueId();
 				if (uid && item->getTile() == item->getParent()) {
-					m_localMap[uid] = thing;
+					setLocalThing(uid, thing);
 					return uid;
 				}
 			}
@@ -249,13 +283,13 @@ uint32_t ScriptEnviroment::addThing(Thing* thing)
 			++m_lastUID;
 			if (m_lastUID > 0xFFFFFF) m_lastUID = 70000;
 
-			while (m_localMap[m_lastUID]) {
+			while (m_localMap.find(m_lastUID) != m_localMap.end()) {
 				++m_lastUID;
 			}
 			newUid = m_lastUID;
 		}
 
-		m_localMap[newUid] = thing;
+		setLocalThing(newUid, thing);
 		return newUid;
 	} else {
 		return 0;
@@ -266,7 +300,7 @@ void ScriptEnviroment::insertThing(uint32_t uid, Thing* thing)
 {
 	ThingMap::iterator it = m_localMap.find(uid);
 	if (it == m_localMap.end()) {
-		m_localMap[uid] = thing;
+		setLocalThing(uid, thing);
 	} else {
 		std::cout << std::endl << "Lua Script Error: Thing uid already taken.";
 	}
@@ -287,7 +321,7 @@ Thing* ScriptEnviroment::getThingByUID(uint32_t uid)
 	if (uid >= PLAYER_ID_RANGE) { // is a creature id
 		Thing* thing = g_game.getCreatureByID(uid);
 		if (thing && !thing->isRemoved()) {
-			m_localMap[uid] = thing;
+			setLocalThing(uid, thing);
 			return thing;
 		}
 	}
@@ -340,7 +374,7 @@ void ScriptEnviroment::removeItemByUID(uint32_t uid)
 	ThingMap::iterator it;
 	it = m_localMap.find(uid);
 	if (it != m_localMap.end()) {
-		m_localMap.erase(it);
+		eraseLocalThing(it);
 	}
 
 	it = m_globalMap.find(uid);
@@ -520,7 +554,10 @@ std::string LuaScriptInterface::getErrorDesc(ErrorCode_t code)
 }
 
 ScriptEnviroment LuaScriptInterface::m_scriptEnv[16];
-int32_t LuaScriptInterface::m_scriptEnvIndex = -1;
+thread_local ScriptEnviroment* LuaScriptInterface::m_threadScriptEnv = LuaScriptInterface::m_scriptEnv;
+thread_local int32_t LuaScriptInterface::m_scriptEnvIndex = -1;
+LuaScriptInterface::LuaAsyncQueries LuaScriptInterface::m_asyncQueries;
+uint32_t LuaScriptInterface::m_lastAsyncQueryId = 0;
 
 LuaScriptInterface::LuaScriptInterface(std::string interfaceName)
 {
@@ -557,7 +594,7 @@ void LuaScriptInterface::dumpLuaStack()
 int32_t LuaScriptInterface::loadFile(const std::string& file, bool reserveEnviroment /*= true*/)
 {
 	// loads file as a chunk at stack top
-	int ret = luaL_loadfile(m_luaState, file.c_str());
+	int ret = LuaChunkCache::getInstance().load(m_luaState, file);
 	if (ret != 0) {
 		m_lastLuaError = popString(m_luaState);
 		return -1;
@@ -736,6 +773,9 @@ bool LuaScriptInterface::initState()
 	std::string datadir = g_config.getString(ConfigManager::DATA_DIRECTORY);
 
 	registerFunctions();
+#ifdef __LUAJIT__
+	registerFFIFunctions();
+#endif
 
 	if (loadFile(std::string(datadir + "global.lua")) == -1) {
 		std::cout << "Warning: [LuaScriptInterface::initState] Can not load " << datadir
@@ -765,6 +805,15 @@ bool LuaScriptInterface::closeState()
 		}
 		m_timerEvents.clear();
 
+		for (LuaAsyncQueries::iterator qt = m_asyncQueries.begin(); qt != m_asyncQueries.end();) {
+			if (qt->second.scriptInterface == this) {
+				luaL_unref(m_luaState, LUA_REGISTRYINDEX, qt->second.function);
+				m_asyncQueries.erase(qt++);
+			} else {
+				++qt;
+			}
+		}
+
 		lua_close(m_luaState);
 	}
 
@@ -808,6 +857,62 @@ void LuaScriptInterface::executeTimerEvent(uint32_t eventIndex)
 	}
 }
 
+uint32_t LuaScriptInterface::addAsyncQuery(lua_State* L)
+{
+	// the callback is on top of the stack
+	ScriptEnviroment* env = getScriptEnv();
+
+	LuaAsyncQueryDesc queryDesc;
+	queryDesc.scriptInterface = env->getScriptInterface();
+	queryDesc.scriptId = env->getScriptId();
+	queryDesc.function = luaL_ref(L, LUA_REGISTRYINDEX);
+
+	m_asyncQueries[++m_lastAsyncQueryId] = queryDesc;
+	return m_lastAsyncQueryId;
+}
+
+void LuaScriptInterface::executeAsyncQuery(uint32_t queryId, DBResult* result, bool success)
+{
+	LuaAsyncQueries::iterator it = m_asyncQueries.find(queryId);
+	if (it == m_asyncQueries.end()) {
+		// the script was reloaded meanwhile
+		if (result) {
+			Database::instance()->freeResult(result);
+		}
+		return;
+	}
+
+	LuaAsyncQueryDesc queryDesc = it->second;
+	m_asyncQueries.erase(it);
+
+	LuaScriptInterface* scriptInterface = queryDesc.scriptInterface;
+	lua_State* L = scriptInterface->m_luaState;
+
+	if (reserveScriptEnv()) {
+		ScriptEnviroment* env = getScriptEnv();
+		env->setScriptId(queryDesc.scriptId, scriptInterface);
+
+		lua_rawgeti(L, LUA_REGISTRYINDEX, queryDesc.function);
+		if (result) {
+			// owned by the environment from here on
+			lua_pushnumber(L, env->addResult(result));
+		} else {
+			lua_pushboolean(L, success);
+		}
+
+		scriptInterface->callFunction(1, false);
+		releaseScriptEnv();
+	} else {
+		std::cout << "[Error] Call stack overflow. LuaScriptInterface::executeAsyncQuery"
+		          << std::endl;
+		if (result) {
+			Database::instance()->freeResult(result);
+		}
+	}
+
+	luaL_unref(L, LUA_REGISTRYINDEX, queryDesc.function);
+}
+
 int LuaScriptInterface::luaErrorHandler(lua_State* L)
 {
 	lua_getfield(L, LUA_GLOBALSINDEX, "debug");
@@ -840,7 +945,26 @@ bool LuaScriptInterface::callFunction(uint32_t nParams, bool getReturnValue /*=t
 		qtdRet = 0;
 	}
 
+	ScriptProfiler& profiler = ScriptProfiler::getInstance();
+	// it keeps the dispatcher's call stack, npc script threads are not profiled
+	bool profiled = profiler.isEnabled() && m_threadScriptEnv == m_scriptEnv;
+	if (profiled) {
+		ScriptEnviroment* env = getScriptEnv();
+		int32_t scriptId, callbackId;
+		bool timerEvent;
+		std::string eventDesc;
+		LuaScriptInterface* scriptInterface;
+		env->getEventInfo(scriptId, eventDesc, scriptInterface, callbackId, timerEvent);
+
+		const std::string& script = getFileById(callbackId ? callbackId : scriptId);
+		profiler.enter(m_luaState, m_interfaceName, timerEvent ? "addEvent " + script : script);
+	}
+
 	int ret = lua_pcall(m_luaState, nParams, qtdRet, error_index);
+	if (profiled) {
+		profiler.leave();
+	}
+
 	if (ret != 0) {
 		LuaScriptInterface::reportError(nullptr, LuaScriptInterface::popString(m_luaState));
 	} else {
@@ -8165,10 +8289,13 @@ const luaL_Reg LuaScriptInterface::luaDatabaseTable[] =
   { "updateLimiter", LuaScriptInterface::luaDatabaseUpdateLimiter },
   { "connected", LuaScriptInterface::luaDatabaseConnected },
   { "tableExists", LuaScriptInterface::luaDatabaseTableExists },
+  { "asyncQuery", LuaScriptInterface::luaDatabaseAsyncQuery },
+  { "asyncStoreQuery", LuaScriptInterface::luaDatabaseAsyncStoreQuery },
   { nullptr, nullptr } };
 
 int32_t LuaScriptInterface::luaDatabaseExecute(lua_State* L)
 {
+	DBQueryOrigin origin("Lua db.query");
 	DBQuery query;
 	lua_pushboolean(L, Database::instance()->executeQuery(popString(L)));
 	return 1;
@@ -8176,6 +8303,7 @@ int32_t LuaScriptInterface::luaDatabaseExecute(lua_State* L)
 
 int32_t LuaScriptInterface::luaDatabaseStoreQuery(lua_State* L)
 {
+	DBQueryOrigin origin("Lua db.storeQuery");
 	ScriptEnviroment* env = getScriptEnv();
 
 	DBQuery query;
@@ -8187,6 +8315,54 @@ int32_t LuaScriptInterface::luaDatabaseStoreQuery(lua_State* L)
 	return 1;
 }
 
+int32_t LuaScriptInterface::luaDatabaseAsyncQuery(lua_State* L)
+{
+	DBQueryOrigin origin("Lua db.asyncQuery");
+	// db.asyncQuery(query[, callback])
+	// callback(success) runs once a database worker is done with the query
+	DBExecuteCallback callback;
+	if (lua_gettop(L) >= 2) {
+		if (lua_isfunction(L, -1) && getScriptEnv()->getScriptInterface()) {
+			callback = boost::bind(&LuaScriptInterface::executeAsyncQuery, addAsyncQuery(L),
+			                       (DBResult*)nullptr, _1);
+		} else {
+			lua_pop(L, 1);
+		}
+	}
+
+	DatabaseTasks::getInstance().executeQuery(popString(L), callback);
+	lua_pushboolean(L, true);
+	return 1;
+}
+
+int32_t LuaScriptInterface::luaDatabaseAsyncStoreQuery(lua_State* L)
+{
+	DBQueryOrigin origin("Lua db.asyncStoreQuery");
+	// db.asyncStoreQuery(query, callback)
+	// callback(resultId) runs once a database worker is done with the query,
+	// resultId is false if nothing was found
+	if (!lua_isfunction(L, -1)) {
+		reportError(__FUNCTION__, "callback parameter should be a function.");
+		lua_pop(L, 2);
+		lua_pushboolean(L, false);
+		return 1;
+	}
+
+	if (!getScriptEnv()->getScriptInterface()) {
+		reportError(__FUNCTION__, "No valid script interface!");
+		lua_pop(L, 2);
+		lua_pushboolean(L, false);
+		return 1;
+	}
+
+	uint32_t queryId = addAsyncQuery(L);
+	DatabaseTasks::getInstance().storeQuery(popString(L),
+	                                        boost::bind(&LuaScriptInterface::executeAsyncQuery,
+	                                                    queryId, _1, false));
+	lua_pushboolean(L, true);
+	return 1;
+}
+
 int32_t LuaScriptInterface::luaDatabaseEscapeString(lua_State* L)
 {
 	DBQuery query;
@@ -200,7 +200,8 @@ public:
 	}
 
 private:
-	typedef std::map<uint32_t, Thing*> ThingMap;
+	typedef std::unordered_map<uint32_t, Thing*> ThingMap;
+	typedef std::unordered_map<const Thing*, uint32_t> ThingUidMap;
 	typedef std::vector<const LuaVariant*> VariantVector;
 	typedef std::map<uint32_t, int32_t> StorageMap;
 	typedef std::map<uint32_t, AreaCombat*> AreaMap;
@@ -226,6 +227,11 @@ private:
 	// item/creature map
 	int32_t m_lastUID;
 	ThingMap m_localMap;
+	// first uid each thing of m_localMap got, so addThing needs no scan
+	ThingUidMap m_localUids;
+
+	void setLocalThing(uint32_t uid, Thing* thing);
+	void eraseLocalThing(ThingMap::iterator it);
 
 	// temporary item list
 	typedef std::map<ScriptEnviroment*, ItemList> TempItemListMap;
@@ -323,7 +329,7 @@ public:
 	static ScriptEnviroment* getScriptEnv()
 	{
 		assert(m_scriptEnvIndex >= 0 && m_scriptEnvIndex < 16);
-		return &m_scriptEnv[m_scriptEnvIndex];
+		return &m_threadScriptEnv[m_scriptEnvIndex];
 	}
 
 	static bool reserveScriptEnv()
@@ -340,11 +346,20 @@ public:
 	static void releaseScriptEnv()
 	{
 		if (m_scriptEnvIndex >= 0) {
-			m_scriptEnv[m_scriptEnvIndex].resetEnv();
+			m_threadScriptEnv[m_scriptEnvIndex].resetEnv();
 			--m_scriptEnvIndex;
 		}
 	}
 
+	/** Gives the calling thread a stack of its own, for threads other than
+	  * the dispatcher that run scripts (see NpcScriptPool)
+	  * \param envs 16 environments, they must outlive the thread's scripts
+	  */
+	static void setThreadScriptEnv(ScriptEnviroment* envs)
+	{
+		m_threadScriptEnv = envs;
+	}
+
 	static void reportError(const char* function, const std::string& error_desc);
 
 	std::string getInterfaceName()
@@ -722,6 +737,11 @@ protected:
 
 	static int internalGetPlayerInfo(lua_State* L, PlayerInfo_t info);
 
+#ifdef __LUAJIT__
+	// FFI versions of the hottest player getters, see luascriptffi.cpp
+	void registerFFIFunctions();
+#endif
+
 	static int luaIsNpcName(lua_State* L);
 	static int luaGetMonsterParameter(lua_State* L);
 	static int luaGetNpcParameterByName(lua_State* L);
@@ -740,7 +760,7 @@ protected:
 	static int luaBitULeftShift(lua_State* L);
 	static int luaBitURightShift(lua_State* L);
 
-	static const luaL_Reg luaDatabaseTable[10];
+	static const luaL_Reg luaDatabaseTable[12];
 	static int32_t luaDatabaseExecute(lua_State* L);
 	static int32_t luaDatabaseStoreQuery(lua_State* L);
 	static int32_t luaDatabaseEscapeString(lua_State* L);
@@ -750,6 +770,8 @@ protected:
 	static int32_t luaDatabaseUpdateLimiter(lua_State* L);
 	static int32_t luaDatabaseConnected(lua_State* L);
 	static int32_t luaDatabaseTableExists(lua_State* L);
+	static int32_t luaDatabaseAsyncQuery(lua_State* L);
+	static int32_t luaDatabaseAsyncStoreQuery(lua_State* L);
 
 	static const luaL_Reg luaResultTable[8];
 	static int32_t luaResultGetDataInt(lua_State* L);
@@ -774,7 +796,9 @@ protected:
 
 private:
 	static ScriptEnviroment m_scriptEnv[16];
-	static int32_t m_scriptEnvIndex;
+	// the dispatcher's stack is m_scriptEnv
+	static thread_local ScriptEnviroment* m_threadScriptEnv;
+	static thread_local int32_t m_scriptEnvIndex;
 
 	int32_t m_runningEventId;
 	std::string m_loadingFile;
@@ -797,6 +821,21 @@ private:
 
 	void executeTimerEvent(uint32_t eventIndex);
 
+	// callbacks of db.asyncQuery and db.asyncStoreQuery waiting for a database
+	// worker, dropped when their interface closes
+	struct LuaAsyncQueryDesc {
+		LuaScriptInterface* scriptInterface;
+		int32_t scriptId;
+		int function;
+	};
+
+	typedef std::map<uint32_t, LuaAsyncQueryDesc> LuaAsyncQueries;
+	static LuaAsyncQueries m_asyncQueries;
+	static uint32_t m_lastAsyncQueryId;
+
+	static uint32_t addAsyncQuery(lua_State* L);
+	static void executeAsyncQuery(uint32_t queryId, DBResult* result, bool success);
+
 	std::string m_interfaceName;
 };
 
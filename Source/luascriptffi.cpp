@@ -0,0 +1,180 @@
+#include "otpch.h"
+
+#ifdef __LUAJIT__
+
+#include "game.h"
+#include "luascript.h"
+#include "player.h"
+
+#include <cstring>
+#include <iostream>
+
+extern Game g_game;
+
+#ifdef _WIN32
+#define OTSERV_FFI_EXPORT extern "C" __declspec(dllexport)
+#else
+#define OTSERV_FFI_EXPORT extern "C" __attribute__((visibility("default")))
+#endif
+
+// Looked up by ffi.C, so the executable has to export them. They return -1
+// when the cid is not an online player, the wrappers then call the regular
+// function which also resolves script uids and reports the error.
+
+OTSERV_FFI_EXPORT int32_t otserv_getPlayerLevel(uint32_t cid)
+{
+	const Player* player = g_game.getPlayerByID(cid);
+	return player ? (int32_t)player->getLevel() : -1;
+}
+
+OTSERV_FFI_EXPORT int32_t otserv_getPlayerMagLevel(uint32_t cid)
+{
+	const Player* player = g_game.getPlayerByID(cid);
+	return player ? (int32_t)player->getMagicLevel() : -1;
+}
+
+OTSERV_FFI_EXPORT int32_t otserv_getPlayerMana(uint32_t cid)
+{
+	const Player* player = g_game.getPlayerByID(cid);
+	return player ? player->getMana() : -1;
+}
+
+OTSERV_FFI_EXPORT int32_t otserv_getPlayerMaxMana(uint32_t cid)
+{
+	const Player* player = g_game.getPlayerByID(cid);
+	return player ? player->getMaxMana() : -1;
+}
+
+OTSERV_FFI_EXPORT int32_t otserv_getPlayerVocation(uint32_t cid)
+{
+	const Player* player = g_game.getPlayerByID(cid);
+	return player ? (int32_t)player->getVocationId() : -1;
+}
+
+OTSERV_FFI_EXPORT int32_t otserv_getPlayerAccess(uint32_t cid)
+{
+	const Player* player = g_game.getPlayerByID(cid);
+	return player ? player->getAccessLevel() : -1;
+}
+
+// 1 and the value if set, 0 if not set
+OTSERV_FFI_EXPORT int32_t otserv_getPlayerStorageValue(uint32_t cid, uint32_t key, int32_t* value)
+{
+	const Player* player = g_game.getPlayerByID(cid);
+	if (!player) {
+		return -1;
+	}
+	return player->getStorageValue(key, *value) ? 1 : 0;
+}
+
+// Replaces the globals registerFunctions made, ffi itself is only given to
+// this chunk so scripts can not reach raw memory through it
+static const char* ffiWrappers =
+"local ffi = ...\n"
+"ffi.cdef[[\n"
+"int32_t otserv_getPlayerLevel(uint32_t cid);\n"
+"int32_t otserv_getPlayerMagLevel(uint32_t cid);\n"
+"int32_t otserv_getPlayerMana(uint32_t cid);\n"
+"int32_t otserv_getPlayerMaxMana(uint32_t cid);\n"
+"int32_t otserv_getPlayerVocation(uint32_t cid);\n"
+"int32_t otserv_getPlayerAccess(uint32_t cid);\n"
+"int32_t otserv_getPlayerStorageValue(uint32_t cid, uint32_t key, int32_t* value);\n"
+"]]\n"
+"local C = ffi.C\n"
+"local type = type\n"
+"-- fail here rather than in a script when the symbols are not exported\n"
+"for _, name in ipairs({ 'otserv_getPlayerLevel', 'otserv_getPlayerMagLevel', 'otserv_getPlayerMana',\n"
+"		'otserv_getPlayerMaxMana', 'otserv_getPlayerVocation', 'otserv_getPlayerAccess',\n"
+"		'otserv_getPlayerStorageValue' }) do\n"
+"	local _ = C[name]\n"
+"end\n"
+"\n"
+"local getPlayerLevel = getPlayerLevel\n"
+"_G.getPlayerLevel = function(cid)\n"
+"	if type(cid) == 'number' then\n"
+"		local value = C.otserv_getPlayerLevel(cid)\n"
+"		if value >= 0 then return value end\n"
+"	end\n"
+"	return getPlayerLevel(cid)\n"
+"end\n"
+"\n"
+"local getPlayerMagLevel = getPlayerMagLevel\n"
+"_G.getPlayerMagLevel = function(cid)\n"
+"	if type(cid) == 'number' then\n"
+"		local value = C.otserv_getPlayerMagLevel(cid)\n"
+"		if value >= 0 then return value end\n"
+"	end\n"
+"	return getPlayerMagLevel(cid)\n"
+"end\n"
+"\n"
+"local getPlayerMana = getPlayerMana\n"
+"_G.getPlayerMana = function(cid)\n"
+"	if type(cid) == 'number' then\n"
+"		local value = C.otserv_getPlayerMana(cid)\n"
+"		if value >= 0 then return value end\n"
+"	end\n"
+"	return getPlayerMana(cid)\n"
+"end\n"
+"\n"
+"local getPlayerMaxMana = getPlayerMaxMana\n"
+"_G.getPlayerMaxMana = function(cid)\n"
+"	if type(cid) == 'number' then\n"
+"		local value = C.otserv_getPlayerMaxMana(cid)\n"
+"		if value >= 0 then return value end\n"
+"	end\n"
+"	return getPlayerMaxMana(cid)\n"
+"end\n"
+"\n"
+"local getPlayerVocation = getPlayerVocation\n"
+"_G.getPlayerVocation = function(cid)\n"
+"	if type(cid) == 'number' then\n"
+"		local value = C.otserv_getPlayerVocation(cid)\n"
+"		if value >= 0 then return value end\n"
+"	end\n"
+"	return getPlayerVocation(cid)\n"
+"end\n"
+"\n"
+"local getPlayerAccess = getPlayerAccess\n"
+"_G.getPlayerAccess = function(cid)\n"
+"	if type(cid) == 'number' then\n"
+"		local value = C.otserv_getPlayerAccess(cid)\n"
+"		if value >= 0 then return value end\n"
+"	end\n"
+"	return getPlayerAccess(cid)\n"
+"end\n"
+"\n"
+"local getPlayerStorageValue = getPlayerStorageValue\n"
+"local storageValue = ffi.new('int32_t[1]')\n"
+"_G.getPlayerStorageValue = function(cid, key)\n"
+"	if type(cid) == 'number' and type(key) == 'number' then\n"
+"		local found = C.otserv_getPlayerStorageValue(cid, key, storageValue)\n"
+"		if found == 1 then return storageValue[0], true end\n"
+"		if found == 0 then return -1, false end\n"
+"	end\n"
+"	return getPlayerStorageValue(cid, key)\n"
+"end\n";
+
+void LuaScriptInterface::registerFFIFunctions()
+{
+	if (luaL_loadbuffer(m_luaState, ffiWrappers, strlen(ffiWrappers), "=ffi") != 0) {
+		std::cout << "[Warning - LuaScriptInterface::registerFFIFunctions] " << popString(m_luaState)
+		          << std::endl;
+		return;
+	}
+
+	lua_pushcfunction(m_luaState, luaopen_ffi);
+	if (lua_pcall(m_luaState, 0, 1, 0) != 0) {
+		std::cout << "[Warning - LuaScriptInterface::registerFFIFunctions] " << popString(m_luaState)
+		          << std::endl;
+		lua_pop(m_luaState, 1);
+		return;
+	}
+
+	if (lua_pcall(m_luaState, 1, 0, 0) != 0) {
+		// the regular functions stay in place
+		std::cout << "[Warning - LuaScriptInterface::registerFFIFunctions] " << popString(m_luaState)
+		          << std::endl;
+	}
+}
+
+#endif
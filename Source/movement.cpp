@@ -51,20 +51,25 @@ void MoveEvents::clear()
 	m_lastCacheTile = nullptr;
 	m_lastCacheItemVector.clear();
 
-	MoveListMap::iterator it = m_itemIdMap.begin();
-	while (it != m_itemIdMap.end()) {
+	for (uint32_t id = 0; id < m_itemIdVector.size(); ++id) {
+		MoveEventList* eventList = m_itemIdVector[id];
+		if (!eventList) {
+			continue;
+		}
+
 		for (int i = 0; i < MOVE_EVENT_LAST; ++i) {
-			std::list<MoveEvent*>& moveEventList = it->second.moveEvent[i];
+			std::list<MoveEvent*>& moveEventList = eventList->moveEvent[i];
 			for (std::list<MoveEvent*>::iterator it = moveEventList.begin();
 			     it != moveEventList.end(); ++it) {
 				delete (*it);
 			}
 		}
-		m_itemIdMap.erase(it);
-		it = m_itemIdMap.begin();
+		delete eventList;
+		Item::items.getItemType(id).hasMoveEvent = false;
 	}
+	m_itemIdVector.clear();
 
-	it = m_actionIdMap.begin();
+	MoveListMap::iterator it = m_actionIdMap.begin();
 	while (it != m_actionIdMap.end()) {
 		for (int i = 0; i < MOVE_EVENT_LAST; ++i) {
 			std::list<MoveEvent*>& moveEventList = it->second.moveEvent[i];
@@ -164,7 +169,9 @@ bool MoveEvents::registerEvent(Event* event, xmlNodePtr p)
 			it.vocationString = moveEvent->getVocationString();
 		}
 
-		addEvent(moveEvent, id, m_itemIdMap);
+		if (!addItemIdEvent(moveEvent, id)) {
+			success = false;
+		}
 	} else if (readXMLInteger(p, "uniqueid", id)) {
 		addEvent(moveEvent, id, m_uniqueIdMap);
 	} else if (readXMLInteger(p, "actionid", id)) {
@@ -188,24 +195,52 @@ bool MoveEvents::registerEvent(Event* event, xmlNodePtr p)
 
 void MoveEvents::addEvent(MoveEvent* moveEvent, int32_t id, MoveListMap& map)
 {
-	MoveListMap::iterator it = map.find(id);
-	if (it == map.end()) {
-		MoveEventList moveEventList;
-		moveEventList.moveEvent[moveEvent->getEventType()].push_back(moveEvent);
-		map[id] = moveEventList;
-	} else {
-		std::list<MoveEvent*>& moveEventList = it->second.moveEvent[moveEvent->getEventType()];
-		for (std::list<MoveEvent*>::iterator it = moveEventList.begin();
-		     it != moveEventList.end(); ++it) {
-			if ((*it)->getSlot() == moveEvent->getSlot()) {
-				std::cout
-				<< "Warning: [MoveEvents::addEvent] Duplicate move event found: " << id
-				<< std::endl;
-			}
+	addEvent(moveEvent, id, map[id]);
+}
+
+void MoveEvents::addEvent(MoveEvent* moveEvent, int32_t id, MoveEventList& eventList)
+{
+	std::list<MoveEvent*>& moveEventList = eventList.moveEvent[moveEvent->getEventType()];
+	for (std::list<MoveEvent*>::iterator it = moveEventList.begin(); it != moveEventList.end(); ++it) {
+		if ((*it)->getSlot() == moveEvent->getSlot()) {
+			std::cout << "Warning: [MoveEvents::addEvent] Duplicate move event found: " << id
+			          << std::endl;
 		}
+	}
 
-		moveEventList.push_back(moveEvent);
+	moveEventList.push_back(moveEvent);
+}
+
+bool MoveEvents::addItemIdEvent(MoveEvent* moveEvent, int32_t id)
+{
+	if (id <= 0 || id > 0xFFFF) {
+		std::cout << "Warning: [MoveEvents::addItemIdEvent] Invalid item id: " << id << std::endl;
+		return false;
+	}
+
+	if ((uint32_t)id >= m_itemIdVector.size()) {
+		m_itemIdVector.resize(std::max<uint32_t>(id + 1, Item::items.size()), nullptr);
+	}
+
+	if (!m_itemIdVector[id]) {
+		m_itemIdVector[id] = new MoveEventList;
+	}
+	addEvent(moveEvent, id, *m_itemIdVector[id]);
+
+	if (Item::items.getElement(id)) {
+		Item::items.getItemType(id).hasMoveEvent = true;
+	}
+	return true;
+}
+
+bool MoveEvents::mayHaveEvent(const Item* item) const
+{
+	if (Item::items[item->getID()].hasMoveEvent) {
+		return true;
 	}
+
+	return (!m_uniqueIdMap.empty() && item->getUniqueId() != 0) ||
+	       (!m_actionIdMap.empty() && item->getActionId() != 0);
 }
 
 MoveEvent* MoveEvents::getEvent(Item* item, MoveEvent_t eventType, slots_t slot)
@@ -247,9 +282,9 @@ MoveEvent* MoveEvents::getEvent(Item* item, MoveEvent_t eventType, slots_t slot)
 		break;
 	}
 
-	MoveListMap::iterator it = m_itemIdMap.find(item->getID());
-	if (it != m_itemIdMap.end()) {
-		std::list<MoveEvent*>& moveEventList = it->second.moveEvent[eventType];
+	MoveEventList* eventList = getItemIdEvents(item->getID());
+	if (eventList) {
+		std::list<MoveEvent*>& moveEventList = eventList->moveEvent[eventType];
 		for (std::list<MoveEvent*>::iterator it = moveEventList.begin();
 		     it != moveEventList.end(); ++it) {
 			if (((*it)->getSlot() & slotp) != 0) {
@@ -284,9 +319,9 @@ MoveEvent* MoveEvents::getEvent(Item* item, MoveEvent_t eventType)
 		}
 	}
 
-	it = m_itemIdMap.find(item->getID());
-	if (it != m_itemIdMap.end()) {
-		std::list<MoveEvent*>& moveEventList = it->second.moveEvent[eventType];
+	MoveEventList* eventList = getItemIdEvents(item->getID());
+	if (eventList) {
+		std::list<MoveEvent*>& moveEventList = eventList->moveEvent[eventType];
 		if (!moveEventList.empty()) {
 			return *moveEventList.begin();
 		}
@@ -380,7 +415,7 @@ uint32_t MoveEvents::onCreatureMove(Creature* creature, const Tile* fromTile, co
 	int32_t j = tile->__getLastIndex();
 	for (int32_t i = tile->__getFirstIndex(); i < j; ++i) {
 		Thing* thing = tile->__getThing(i);
-		if (thing && (tileItem = thing->getItem())) {
+		if (thing && (tileItem = thing->getItem()) && mayHaveEvent(tileItem)) {
 			moveEvent = getEvent(tileItem, eventType);
 			if (moveEvent) {
 				m_lastCacheItemVector.push_back(tileItem);
@@ -463,7 +498,7 @@ uint32_t MoveEvents::onItemMove(Item* item, Tile* tile, bool isAdd)
 	int32_t j = tile->__getLastIndex();
 	for (int32_t i = tile->__getFirstIndex(); i < j; ++i) {
 		Thing* thing = tile->__getThing(i);
-		if (thing && (tileItem = thing->getItem()) && (tileItem != item)) {
+		if (thing && (tileItem = thing->getItem()) && (tileItem != item) && mayHaveEvent(tileItem)) {
 			moveEvent = getEvent(tileItem, eventType2);
 			if (moveEvent) {
 				m_lastCacheItemVector.push_back(tileItem);
@@ -479,6 +514,10 @@ uint32_t MoveEvents::onItemMove(Item* item, Tile* tile, bool isAdd)
 
 bool MoveEvents::hasTileEvent(Item* item)
 {
+	if (!mayHaveEvent(item)) {
+		return false;
+	}
+
 	return (getEvent(item, MOVE_EVENT_ADD_ITEM_ITEMTILE) || getEvent(item, MOVE_EVENT_REMOVE_ITEM_ITEMTILE) ||
 	        getEvent(item, MOVE_EVENT_STEP_IN) || getEvent(item, MOVE_EVENT_STEP_OUT));
 }
@@ -27,6 +27,8 @@
 #include "luascript.h"
 
 #include <map>
+#include <unordered_map>
+#include <vector>
 
 enum MoveEvent_t {
 	MOVE_EVENT_STEP_IN = 0,
@@ -67,7 +69,7 @@ public:
 
 protected:
 	typedef std::map<int32_t, MoveEventList> MoveListMap;
-	typedef std::map<Position, MoveEventList> MovePosListMap;
+	typedef std::unordered_map<Position, MoveEventList, PositionHash> MovePosListMap;
 	void clear() override;
 	LuaScriptInterface& getScriptInterface() override;
 	std::string getScriptBaseName() override;
@@ -75,14 +77,27 @@ protected:
 	bool registerEvent(Event* event, xmlNodePtr p) override;
 
 	void addEvent(MoveEvent* moveEvent, int32_t id, MoveListMap& map);
+	void addEvent(MoveEvent* moveEvent, int32_t id, MoveEventList& moveEventList);
+	bool addItemIdEvent(MoveEvent* moveEvent, int32_t id);
 	void addEvent(MoveEvent* moveEvent, Position pos, MovePosListMap& map);
 	MoveEvent* getEvent(const Tile* tile, MoveEvent_t eventType);
 	MoveEvent* getEvent(Item* item, MoveEvent_t eventType, slots_t slot);
 	bool hasTileEvent(Item* item);
 
+	/** False when no move event can be registered for the item, which is
+	  * most of what lies on a tile
+	  */
+	bool mayHaveEvent(const Item* item) const;
+
+	MoveEventList* getItemIdEvents(uint16_t id) const
+	{
+		return id < m_itemIdVector.size() ? m_itemIdVector[id] : nullptr;
+	}
+
 	MoveListMap m_uniqueIdMap;
 	MoveListMap m_actionIdMap;
-	MoveListMap m_itemIdMap;
+	// indexed by item id
+	std::vector<MoveEventList*> m_itemIdVector;
 	MovePosListMap m_positionMap;
 
 	LuaScriptInterface m_scriptInterface;
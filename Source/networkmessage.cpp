@@ -39,7 +39,7 @@ int32_t NetworkMessage::decodeHeader()
 std::string NetworkMessage::GetString()
 {
 	uint16_t stringlen = GetU16();
-	if (stringlen >= (NETWORKMESSAGE_MAXSIZE - m_ReadPos)) {
+	if (stringlen > (m_bufferSize - m_ReadPos)) {
 		return std::string();
 	}
 
@@ -51,7 +51,7 @@ std::string NetworkMessage::GetString()
 std::string NetworkMessage::GetRaw()
 {
 	uint16_t stringlen = m_MsgSize - m_ReadPos;
-	if (stringlen >= (NETWORKMESSAGE_MAXSIZE - m_ReadPos)) {
+	if (stringlen > (m_bufferSize - m_ReadPos)) {
 		return std::string();
 	}
 
@@ -38,15 +38,24 @@ public:
 	enum { header_length = 2 };
 	enum { max_body_length = NETWORKMESSAGE_MAXSIZE - header_length };
 
-	// constructor/destructor
-	NetworkMessage()
+	// wraps a received packet of length bytes (header included) in place,
+	// the buffer has to outlive the message
+	NetworkMessage(uint8_t* packet, int32_t length) : m_MsgBuf(packet), m_bufferSize(length)
 	{
-		Reset();
+		m_overrun = false;
+		m_MsgSize = length;
+		m_ReadPos = header_length;
 	}
 	virtual ~NetworkMessage(){};
 
-	// resets the internal buffer to an empty message
 protected:
+	// for subclasses owning a NETWORKMESSAGE_MAXSIZE buffer
+	explicit NetworkMessage(uint8_t* buffer) : m_MsgBuf(buffer), m_bufferSize(NETWORKMESSAGE_MAXSIZE)
+	{
+		Reset();
+	}
+
+	// resets the internal buffer to an empty message
 	void Reset()
 	{
 		m_overrun = false;
@@ -58,6 +67,10 @@ public:
 	// simply read functions for incoming message
 	uint8_t GetByte()
 	{
+		if (!expectRead(1)) {
+			return 0;
+		}
+
 		return m_MsgBuf[m_ReadPos++];
 	}
 
@@ -241,12 +254,12 @@ public:
 protected:
 	inline bool canAdd(int size)
 	{
-		return (size + m_ReadPos < NETWORKMESSAGE_MAXSIZE - 16);
+		return (size + m_ReadPos < m_bufferSize - 16);
 	};
 
 	inline bool expectRead(int32_t size)
 	{
-		if (size >= (NETWORKMESSAGE_MAXSIZE - m_ReadPos)) {
+		if (size > (m_bufferSize - m_ReadPos)) {
 			m_overrun = true;
 			return false;
 		}
@@ -259,7 +272,8 @@ protected:
 
 	bool m_overrun;
 
-	uint8_t m_MsgBuf[NETWORKMESSAGE_MAXSIZE];
+	uint8_t* m_MsgBuf;
+	int32_t m_bufferSize;
 };
 
 typedef boost::shared_ptr<NetworkMessage> NetworkMessage_ptr;
@@ -24,6 +24,7 @@
 #include "game.h"
 #include "luascript.h"
 #include "npc.h"
+#include "npcscriptpool.h"
 #include "player.h"
 #include "position.h"
 #include "spells.h"
@@ -44,7 +45,8 @@ extern Spells* g_spells;
 
 AutoList<Npc> Npc::listNpc;
 
-NpcScriptInterface* Npc::m_scriptInterface = nullptr;
+std::vector<NpcScriptInterface*> Npc::m_scriptInterfaces;
+uint32_t Npc::m_lastScriptInterface = 0;
 
 #ifdef __ENABLE_SERVER_DIAGNOSTIC__
 uint32_t Npc::npcCount = 0;
@@ -52,8 +54,11 @@ uint32_t Npc::npcCount = 0;
 
 void Npcs::reload()
 {
-	delete Npc::m_scriptInterface;
-	Npc::m_scriptInterface = nullptr;
+	for (std::vector<NpcScriptInterface*>::iterator it = Npc::m_scriptInterfaces.begin();
+	     it != Npc::m_scriptInterfaces.end(); ++it) {
+		delete *it;
+	}
+	Npc::m_scriptInterfaces.clear();
 
 	for (AutoList<Npc>::listiterator it = Npc::listNpc.list.begin(); it != Npc::listNpc.list.end(); ++it) {
 		it->second->reload();
@@ -83,6 +88,8 @@ Npc::Npc(const std::string& _name) : Creature()
 	loaded = false;
 
 	m_npcEventHandler = nullptr;
+	m_scriptInterface = nullptr;
+	m_scriptThread = -1;
 	reset();
 
 #ifdef __ENABLE_SERVER_DIAGNOSTIC__
@@ -107,11 +114,20 @@ bool Npc::load()
 
 	reset();
 
-	if (!m_scriptInterface) {
-		m_scriptInterface = new NpcScriptInterface();
-		m_scriptInterface->loadNpcLib(std::string(m_datadir + "npc/scripts/lib/npc.lua"));
+	uint32_t threads = NpcScriptPool::getInstance().getThreads();
+	if (m_scriptInterfaces.empty()) {
+		for (uint32_t i = 0; i < std::max<uint32_t>(threads, 1); ++i) {
+			NpcScriptInterface* scriptInterface = new NpcScriptInterface(threads > 0);
+			scriptInterface->loadNpcLib(std::string(m_datadir + "npc/scripts/lib/npc.lua"));
+			m_scriptInterfaces.push_back(scriptInterface);
+		}
 	}
 
+	// the npcs take turns, each thread gets about as many
+	uint32_t index = m_lastScriptInterface++ % m_scriptInterfaces.size();
+	m_scriptInterface = m_scriptInterfaces[index];
+	m_scriptThread = (threads > 0 ? (int32_t)index : -1);
+
 	loaded = loadFromXml(m_filename);
 	return isLoaded();
 }
@@ -321,6 +337,7 @@ void Npc::onCreatureAppear(const Creature* creature, bool isLogin)
 	}
 	// only players for script events
 	else if (Player* player = const_cast<Player*>(creature->getPlayer())) {
+		wakeUp(player->getPosition());
 		if (m_npcEventHandler) {
 			m_npcEventHandler->onCreatureAppear(creature);
 		}
@@ -363,6 +380,7 @@ void Npc::onCreatureMove(const Creature* creature,
 			m_npcEventHandler->onCreatureMove(creature, oldPos, newPos);
 		}
 	} else if (Player* player = const_cast<Player*>(creature->getPlayer())) {
+		wakeUp(newPos);
 		if (m_npcEventHandler) {
 			m_npcEventHandler->onCreatureMove(creature, oldPos, newPos);
 		}
@@ -382,6 +400,7 @@ void Npc::onCreatureSay(const Creature* creature, SpeakClasses type, const std::
 
 	// only players for script events
 	if (const Player* player = creature->getPlayer()) {
+		wakeUp(player->getPosition());
 		if (m_npcEventHandler) {
 			m_npcEventHandler->onCreatureSay(player, type, text);
 		}
@@ -405,12 +424,74 @@ void Npc::onPlayerLeave(Player* player)
 
 void Npc::onThink(uint32_t interval)
 {
+	if (canSleep()) {
+		// wakeUp brings it back once a player comes close
+		g_game.removeCreatureCheck(this);
+		return;
+	}
+
 	Creature::onThink(interval);
+	if (m_npcEventHandler) {
+		if (m_scriptThread >= 0) {
+			// runs once the creature checks of this round are done
+			NpcScriptPool::getInstance().addThink(this, m_scriptThread);
+		} else {
+			m_npcEventHandler->onThink();
+		}
+	}
+}
+
+void Npc::onScriptThink()
+{
 	if (m_npcEventHandler) {
 		m_npcEventHandler->onThink();
 	}
 }
 
+// a player further away does not get the appear and move events that wake
+// the NPC up again, so larger ranges count as the spectator range
+static int32_t getThinkRange()
+{
+	return std::min<int32_t>(g_config.getNumber(ConfigManager::NPC_THINK_RANGE),
+	                         std::min(Map::maxViewportX, Map::maxViewportY));
+}
+
+bool Npc::isInThinkRange(const Position& pos) const
+{
+	int32_t range = getThinkRange();
+	const Position& myPos = getPosition();
+	return pos.z == myPos.z && std::abs(pos.x - myPos.x) <= range && std::abs(pos.y - myPos.y) <= range;
+}
+
+bool Npc::canSleep() const
+{
+	int32_t range = getThinkRange();
+	if (range <= 0 || focusCreature != 0 || followCreature || !conditions.empty()) {
+		return false;
+	}
+
+	SpectatorVec list;
+	g_game.getSpectators(list, getPosition(), false, false, range, range, range, range);
+	for (SpectatorVec::const_iterator it = list.begin(); it != list.end(); ++it) {
+		if ((*it)->getPlayer() && isInThinkRange((*it)->getPosition())) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void Npc::wakeUp(const Position& pos)
+{
+	if (checkCreatureVectorIndex != 0 || isRemoved()) {
+		return;
+	}
+
+	if (getThinkRange() <= 0 || isInThinkRange(pos)) {
+		g_game.addCreatureCheck(this);
+	}
+}
+
 void Npc::doSay(std::string msg, uint32_t delay)
 {
 	Scheduler::getScheduler().addEvent(
@@ -585,9 +666,10 @@ NpcScriptInterface* Npc::getScriptInterface()
 	return m_scriptInterface;
 }
 
-NpcScriptInterface::NpcScriptInterface() : LuaScriptInterface("Npc interface")
+NpcScriptInterface::NpcScriptInterface(bool scriptThread) : LuaScriptInterface("Npc interface")
 {
 	m_libLoaded = false;
+	m_scriptThread = scriptThread;
 	initState();
 }
 
@@ -623,8 +705,35 @@ bool NpcScriptInterface::loadNpcLib(std::string file)
 	return true;
 }
 
+// What an onThink may call on an NpcScriptPool thread besides the Lua
+// libraries: reads of the game, the npc's own idle time and queue, and
+// selfSay and selfMoveTo, which are deferred
+static const char* const scriptThreadFunctions[] = {
+	"selfSay", "selfMoveTo", "selfGetPosition", "creatureGetName", "creatureGetName2",
+	"creatureGetPosition", "getDistanceTo", "getNpcCid", "getNpcPos", "getNpcName", "getNpcFocus",
+	"isNpcIdle", "resetNpcIdle", "updateNpcIdle", "queuePlayer", "unqueuePlayer",
+	"getQueuedPlayer", "getOTSYSTime", "getPlayerFood", "getPlayerMana", "getPlayerMaxMana",
+	"getPlayerLevel", "getPlayerMagLevel", "getPlayerAccess", "getPlayerVocation", "getPlayerSex",
+	"getPlayerGUID", "isPremium", "getPlayerStorageValue", "getGlobalStorageValue",
+	"getCreaturePosition", "getCreatureName", "getCreatureHealth", "getCreatureMaxHealth",
+	"getCreatureLookDir", "getThingPos", "isCreature", "getItemName", "getWorldType",
+	"getWorldTime", "getWorldLight", "isIntegerInArray"};
+
 void NpcScriptInterface::registerFunctions()
 {
+	std::set<std::string> allowed(scriptThreadFunctions,
+	                              scriptThreadFunctions + sizeof(scriptThreadFunctions) / sizeof(char*));
+	if (m_scriptThread) {
+		// the libraries are open already
+		lua_pushnil(m_luaState);
+		while (lua_next(m_luaState, LUA_GLOBALSINDEX) != 0) {
+			if (lua_type(m_luaState, -2) == LUA_TSTRING && lua_iscfunction(m_luaState, -1)) {
+				allowed.insert(lua_tostring(m_luaState, -2));
+			}
+			lua_pop(m_luaState, 1);
+		}
+	}
+
 	LuaScriptInterface::registerFunctions();
 
 	// npc exclusive functions
@@ -652,6 +761,55 @@ void NpcScriptInterface::registerFunctions()
 	lua_register(m_luaState, "unqueuePlayer", NpcScriptInterface::luaUnqueuePlayer);
 	lua_register(m_luaState, "getQueuedPlayer", NpcScriptInterface::luaGetQueuedPlayer);
 	lua_register(m_luaState, "faceCreature", NpcScriptInterface::luaFaceCreature);
+
+	if (m_scriptThread) {
+		lua_pushvalue(m_luaState, LUA_GLOBALSINDEX);
+		guardFunctions(allowed);
+		lua_getfield(m_luaState, -1, "db");
+		guardFunctions(std::set<std::string>());
+		lua_getfield(m_luaState, -2, "result");
+		guardFunctions(std::set<std::string>());
+		lua_pop(m_luaState, 3);
+	}
+}
+
+void NpcScriptInterface::guardFunctions(const std::set<std::string>& allowed)
+{
+	lua_pushnil(m_luaState);
+	while (lua_next(m_luaState, -2) != 0) {
+		if (lua_type(m_luaState, -2) == LUA_TSTRING && lua_iscfunction(m_luaState, -1) &&
+		    allowed.find(lua_tostring(m_luaState, -2)) == allowed.end()) {
+			// the function and its name are the upvalues, replacing the value
+			// of an existing key does not disturb lua_next
+			lua_pushvalue(m_luaState, -2);
+			lua_pushcclosure(m_luaState, NpcScriptInterface::luaGameThreadOnly, 2);
+			lua_pushvalue(m_luaState, -2);
+			lua_insert(m_luaState, -2);
+			lua_rawset(m_luaState, -4);
+		} else {
+			lua_pop(m_luaState, 1);
+		}
+	}
+}
+
+int NpcScriptInterface::luaGameThreadOnly(lua_State* L)
+{
+	if (NpcScriptPool::isScriptThread()) {
+		// this onThink stops here, the next ones run on the dispatcher
+		Npc* npc = getScriptEnv()->getNpc();
+		if (npc) {
+			npc->m_scriptThread = -1;
+		}
+
+		return luaL_error(L, "%s changes the game, %s thinks on the game thread from now on",
+		                  lua_tostring(L, lua_upvalueindex(2)),
+		                  npc ? npc->getName().c_str() : "the npc");
+	}
+
+	lua_pushvalue(L, lua_upvalueindex(1));
+	lua_insert(L, 1);
+	lua_call(L, lua_gettop(L) - 1, LUA_MULTRET);
+	return lua_gettop(L);
 }
 
 
@@ -719,7 +877,11 @@ int NpcScriptInterface::luaActionSay(lua_State* L)
 
 	Npc* npc = env->getNpc();
 	if (npc) {
-		npc->doSay(msg, delay);
+		if (NpcScriptPool::isScriptThread()) {
+			NpcScriptPool::getInstance().deferSay(npc, msg, delay);
+		} else {
+			npc->doSay(msg, delay);
+		}
 	}
 
 	return 0;
@@ -750,7 +912,11 @@ int NpcScriptInterface::luaActionMoveTo(lua_State* L)
 	ScriptEnviroment* env = getScriptEnv();
 	Npc* npc = env->getNpc();
 	if (npc) {
-		npc->doMoveTo(target);
+		if (NpcScriptPool::isScriptThread()) {
+			NpcScriptPool::getInstance().deferMoveTo(npc, target);
+		} else {
+			npc->doMoveTo(target);
+		}
 	}
 
 	return 0;
@@ -1040,7 +1206,22 @@ bool NpcEventsHandler::isLoaded()
 NpcScript::NpcScript(std::string file, Npc* npc) : NpcEventsHandler(npc)
 {
 	m_scriptInterface = npc->getScriptInterface();
+	lua_State* L = m_scriptInterface->getLuaState();
+
+	// All npcs share one state, the script runs with a globals table of its
+	// own so each npc keeps its conversation state and helper functions.
+	// Reads fall through to the shared globals, the functions it defines
+	// keep the table as their environment.
+	lua_pushvalue(L, LUA_GLOBALSINDEX);
+	int32_t sharedGlobals = lua_gettop(L);
+	lua_newtable(L);
+	lua_newtable(L);
+	lua_pushvalue(L, sharedGlobals);
+	lua_setfield(L, -2, "__index");
+	lua_setmetatable(L, -2);
+	lua_replace(L, LUA_GLOBALSINDEX);
 
+	m_loaded = true;
 	if (m_scriptInterface->reserveScriptEnv()) {
 		m_scriptInterface->getScriptEnv()->setNpc(npc);
 		if (m_scriptInterface->loadFile(file, false) == -1) {
@@ -1048,19 +1229,22 @@ NpcScript::NpcScript(std::string file, Npc* npc) : NpcEventsHandler(npc)
 			          << std::endl;
 			std::cout << m_scriptInterface->getLastLuaError() << std::endl;
 			m_loaded = false;
-			m_scriptInterface->releaseScriptEnv();
-			return;
 		}
 
 		m_scriptInterface->releaseScriptEnv();
 	}
 
-	m_onCreatureSay = m_scriptInterface->getEvent("onCreatureSay");
-	m_onCreatureDisappear = m_scriptInterface->getEvent("onCreatureDisappear");
-	m_onCreatureAppear = m_scriptInterface->getEvent("onCreatureAppear");
-	m_onCreatureMove = m_scriptInterface->getEvent("onCreatureMove");
-	m_onThink = m_scriptInterface->getEvent("onThink");
-	m_loaded = true;
+	if (m_loaded) {
+		m_onCreatureSay = m_scriptInterface->getEvent("onCreatureSay");
+		m_onCreatureDisappear = m_scriptInterface->getEvent("onCreatureDisappear");
+		m_onCreatureAppear = m_scriptInterface->getEvent("onCreatureAppear");
+		m_onCreatureMove = m_scriptInterface->getEvent("onCreatureMove");
+		m_onThink = m_scriptInterface->getEvent("onThink");
+	}
+
+	lua_pushvalue(L, sharedGlobals);
+	lua_replace(L, LUA_GLOBALSINDEX);
+	lua_settop(L, sharedGlobals - 1);
 }
 
 NpcScript::~NpcScript()
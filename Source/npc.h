@@ -26,6 +26,10 @@
 #include "luascript.h"
 #include "templates.h"
 
+#include <set>
+#include <string>
+#include <vector>
+
 //////////////////////////////////////////////////////////////////////
 // Defines an NPC...
 
@@ -44,13 +48,19 @@ public:
 class NpcScriptInterface : public LuaScriptInterface
 {
 public:
-	NpcScriptInterface();
+	/** \param scriptThread its npcs think on an NpcScriptPool thread */
+	NpcScriptInterface(bool scriptThread = false);
 	~NpcScriptInterface() override;
 
 	bool loadNpcLib(std::string file);
 
 protected:
 	void registerFunctions() override;
+	// wraps the C functions of the table on top of the stack that change the
+	// game and are not in the allowed set with luaGameThreadOnly
+	void guardFunctions(const std::set<std::string>& allowed);
+
+	static int luaGameThreadOnly(lua_State* L);
 
 	static int luaActionSay(lua_State* L);
 	static int luaActionMove(lua_State* L);
@@ -82,6 +92,7 @@ private:
 	bool closeState() override;
 
 	bool m_libLoaded;
+	bool m_scriptThread;
 };
 
 class NpcEventsHandler
@@ -246,6 +257,8 @@ protected:
 	void onCreatureSay(const Creature* creature, SpeakClasses type, const std::string& text) override;
 	void onCreatureChangeOutfit(const Creature* creature, const Outfit_t& outfit) override;
 	void onThink(uint32_t interval) override;
+	// the script's onThink, on the NpcScriptPool thread owning its Lua state
+	void onScriptThink();
 	std::string getDescription(int32_t lookDistance) const override;
 
 	bool isImmune(CombatType_t type) const override
@@ -271,6 +284,11 @@ protected:
 	void onPlayerEnter(Player* player);
 	void onPlayerLeave(Player* player);
 
+	// NpcThinkRange, idle npcs stop thinking until a player comes close
+	bool isInThinkRange(const Position& pos) const;
+	bool canSleep() const;
+	void wakeUp(const Position& pos);
+
 	typedef std::map<std::string, std::string> ParametersMap;
 	ParametersMap m_parameters;
 
@@ -297,10 +315,17 @@ protected:
 
 	bool loaded;
 
-	static NpcScriptInterface* m_scriptInterface;
+	// one for each NpcScriptPool thread, or just one if it does not run
+	static std::vector<NpcScriptInterface*> m_scriptInterfaces;
+	static uint32_t m_lastScriptInterface;
+
+	NpcScriptInterface* m_scriptInterface;
+	// the pool thread its onThink runs on, -1 for the dispatcher
+	int32_t m_scriptThread;
 
 	friend class Npcs;
 	friend class NpcScriptInterface;
+	friend class NpcScriptPool;
 };
 
 #endif
@@ -0,0 +1,206 @@
+//////////////////////////////////////////////////////////////////////
+// OpenTibia - an opensource roleplaying game
+//////////////////////////////////////////////////////////////////////
+// Worker threads for the onThink of NPC scripts
+//////////////////////////////////////////////////////////////////////
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//////////////////////////////////////////////////////////////////////
+#include "otpch.h"
+
+#include "npcscriptpool.h"
+#include "luascript.h"
+#include "npc.h"
+
+#if defined __EXCEPTION_TRACER__
+#include "exception.h"
+#endif
+
+thread_local NpcScriptPool::Worker* NpcScriptPool::m_threadWorker = nullptr;
+
+NpcScriptPool::NpcScriptPool() : m_round(0), m_busy(0), m_running(false)
+{
+}
+
+NpcScriptPool::~NpcScriptPool()
+{
+	shutdown();
+	for (std::vector<Worker*>::iterator it = m_workers.begin(); it != m_workers.end(); ++it) {
+		delete *it;
+	}
+}
+
+void NpcScriptPool::start(uint32_t threads)
+{
+	boost::lock_guard<boost::mutex> lockClass(m_lock);
+	if (m_running || threads == 0) {
+		return;
+	}
+
+	m_running = true;
+	for (uint32_t i = 0; i < threads; ++i) {
+		Worker* worker = new Worker;
+		m_workers.push_back(worker);
+		m_threads.create_thread(boost::bind(&NpcScriptPool::workerThread, this, worker));
+	}
+}
+
+void NpcScriptPool::shutdown()
+{
+	m_lock.lock();
+	m_running = false;
+	m_lock.unlock();
+
+	m_startSignal.notify_all();
+	m_threads.join_all();
+}
+
+bool NpcScriptPool::isScriptThread()
+{
+	return m_threadWorker != nullptr;
+}
+
+void NpcScriptPool::addThink(Npc* npc, uint32_t thread)
+{
+	m_workers[thread]->thinks.push_back(npc);
+}
+
+void NpcScriptPool::runThinks()
+{
+	bool queued = false;
+	for (std::vector<Worker*>::iterator it = m_workers.begin(); it != m_workers.end(); ++it) {
+		if (!(*it)->thinks.empty()) {
+			queued = true;
+			break;
+		}
+	}
+
+	if (!queued) {
+		return;
+	}
+
+	boost::unique_lock<boost::mutex> lockClass(m_lock);
+	if (!m_running) {
+		// shutting down, the threads are gone
+		lockClass.unlock();
+		for (std::vector<Worker*>::iterator it = m_workers.begin(); it != m_workers.end(); ++it) {
+			for (std::vector<Npc*>::iterator nit = (*it)->thinks.begin(); nit != (*it)->thinks.end();
+			     ++nit) {
+				if (!(*nit)->isRemoved()) {
+					(*nit)->onScriptThink();
+				}
+			}
+			(*it)->thinks.clear();
+		}
+		return;
+	}
+
+	// every thread takes part in a round, the ones without npcs finish at once
+	m_busy = (uint32_t)m_workers.size();
+	++m_round;
+	m_startSignal.notify_all();
+	while (m_busy > 0) {
+		m_doneSignal.wait(lockClass);
+	}
+	lockClass.unlock();
+
+	// in the order the npcs of each thread recorded them
+	for (std::vector<Worker*>::iterator it = m_workers.begin(); it != m_workers.end(); ++it) {
+		Worker* worker = *it;
+		for (std::vector<Command>::iterator cit = worker->commands.begin();
+		     cit != worker->commands.end(); ++cit) {
+			if (cit->npc->isRemoved()) {
+				continue;
+			}
+
+			switch (cit->type) {
+			case COMMAND_SAY:
+				cit->npc->doSay(cit->text, cit->delay);
+				break;
+
+			case COMMAND_MOVETO:
+				cit->npc->doMoveTo(cit->pos);
+				break;
+			}
+		}
+
+		worker->thinks.clear();
+		worker->commands.clear();
+	}
+}
+
+void NpcScriptPool::deferSay(Npc* npc, const std::string& text, uint32_t delay)
+{
+	Command command;
+	command.type = COMMAND_SAY;
+	command.npc = npc;
+	command.text = text;
+	command.delay = delay;
+	m_threadWorker->commands.push_back(command);
+}
+
+void NpcScriptPool::deferMoveTo(Npc* npc, const Position& pos)
+{
+	Command command;
+	command.type = COMMAND_MOVETO;
+	command.npc = npc;
+	command.delay = 0;
+	command.pos = pos;
+	m_threadWorker->commands.push_back(command);
+}
+
+void NpcScriptPool::workerThread(Worker* worker)
+{
+#if defined __EXCEPTION_TRACER__
+	ExceptionHandler workerExceptionHandler;
+	workerExceptionHandler.InstallHandler();
+#endif
+
+	m_threadWorker = worker;
+	LuaScriptInterface::setThreadScriptEnv(worker->scriptEnv);
+
+	boost::unique_lock<boost::mutex> lockClass(m_lock);
+	// rounds count from 1, one that started before this thread did is not missed
+	uint32_t round = 0;
+	while (true) {
+		while (m_running && m_round == round) {
+			m_startSignal.wait(lockClass);
+		}
+
+		if (!m_running) {
+			break;
+		}
+
+		round = m_round;
+		lockClass.unlock();
+
+		for (std::vector<Npc*>::iterator it = worker->thinks.begin(); it != worker->thinks.end();
+		     ++it) {
+			if (!(*it)->isRemoved()) {
+				(*it)->onScriptThink();
+			}
+		}
+
+		lockClass.lock();
+		if (--m_busy == 0) {
+			m_doneSignal.notify_one();
+		}
+	}
+
+	m_threadWorker = nullptr;
+
+#if defined __EXCEPTION_TRACER__
+	workerExceptionHandler.RemoveHandler();
+#endif
+}
@@ -0,0 +1,114 @@
+//////////////////////////////////////////////////////////////////////
+// OpenTibia - an opensource roleplaying game
+//////////////////////////////////////////////////////////////////////
+// Worker threads for the onThink of NPC scripts
+//////////////////////////////////////////////////////////////////////
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef __OTSERV_NPCSCRIPTPOOL_H__
+#define __OTSERV_NPCSCRIPTPOOL_H__
+
+#include "definitions.h"
+#include "luascript.h"
+#include "position.h"
+
+#include <boost/thread.hpp>
+#include <string>
+#include <vector>
+
+class Npc;
+
+/** Runs the onThink of NPC scripts on NpcScriptThreads threads, each one
+  * owns the Lua state of a share of the NPCs. The dispatcher queues them
+  * during the creature checks and waits in runThinks() until all finished,
+  * so the scripts read the game while nothing changes it. selfSay and
+  * selfMoveTo are recorded and applied on the dispatcher afterwards, the
+  * other functions that change the game make the NPC think on the
+  * dispatcher from then on (NpcScriptInterface::luaGameThreadOnly).
+  */
+class NpcScriptPool
+{
+public:
+	~NpcScriptPool();
+
+	static NpcScriptPool& getInstance()
+	{
+		static NpcScriptPool instance;
+		return instance;
+	}
+
+	/** Starts the threads, with 0 every script runs on the dispatcher */
+	void start(uint32_t threads);
+	void shutdown();
+
+	/** Number of threads, 0 if the pool is not running */
+	uint32_t getThreads() const
+	{
+		return (uint32_t)m_workers.size();
+	}
+
+	/** Whether the calling thread is one of the pool's */
+	static bool isScriptThread();
+
+	/** Queues the onThink of the npc on the thread owning its Lua state */
+	void addThink(Npc* npc, uint32_t thread);
+
+	/** Runs the queued onThinks and waits for them, then applies the
+	  * commands they recorded. Dispatcher only, before the removed creatures
+	  * are released.
+	  */
+	void runThinks();
+
+	/** Record a command of the npc the calling script thread runs */
+	void deferSay(Npc* npc, const std::string& text, uint32_t delay);
+	void deferMoveTo(Npc* npc, const Position& pos);
+
+protected:
+	NpcScriptPool();
+
+	enum CommandType_t { COMMAND_SAY, COMMAND_MOVETO };
+
+	struct Command {
+		CommandType_t type;
+		Npc* npc;
+		std::string text;
+		uint32_t delay;
+		Position pos;
+	};
+
+	struct Worker {
+		std::vector<Npc*> thinks;
+		std::vector<Command> commands;
+		// the dispatcher's script environments are in use meanwhile
+		ScriptEnviroment scriptEnv[16];
+	};
+
+	void workerThread(Worker* worker);
+
+	boost::mutex m_lock;
+	boost::condition_variable m_startSignal;
+	boost::condition_variable m_doneSignal;
+	boost::thread_group m_threads;
+
+	// filled by start(), the dispatcher only touches them while the threads wait
+	std::vector<Worker*> m_workers;
+	static thread_local Worker* m_threadWorker;
+	uint32_t m_round;
+	uint32_t m_busy;
+	bool m_running;
+};
+
+#endif
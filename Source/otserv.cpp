@@ -30,9 +30,18 @@
 
 #include "commands.h"
 #include "configmanager.h"
+#include "databasepool.h"
+#include "databasetasks.h"
+#include "ioplayer.h"
+#include "luachunkcache.h"
 #include "monsters.h"
 #include "npc.h"
+#include "npcscriptpool.h"
+#include "playerdirectory.h"
+#include "playerjournal.h"
+#include "querystats.h"
 #include "scriptmanager.h"
+#include "scriptprofiler.h"
 #include "status.h"
 #include "vocation.h"
 
@@ -78,6 +87,7 @@ time_t start_time;
 struct CommandLineOptions {
 	std::string configfile;
 	bool truncate_log;
+	bool migrate_items;
 	std::string logfile;
 	std::string errfile;
 	std::string runfile;
@@ -236,6 +246,7 @@ bool parseCommandLine(CommandLineOptions& opts, std::vector<std::string> args)
 {
 	std::vector<std::string>::iterator argi = args.begin();
 	opts.truncate_log = false;
+	opts.migrate_items = false;
 
 	if (argi != args.end()) {
 		++argi;
@@ -269,6 +280,8 @@ bool parseCommandLine(CommandLineOptions& opts, std::vector<std::string> args)
 			opts.configfile = *argi;
 		} else if (arg == "--truncate-log") {
 			opts.truncate_log = true;
+		} else if (arg == "--migrate-items") {
+			opts.migrate_items = true;
 		} else if (arg == "-l" || arg == "--log-file") {
 			if (++argi == args.end()) {
 				std::cout << "Missing parameter 1 for '" << arg << "'" << std::endl;
@@ -296,7 +309,9 @@ bool parseCommandLine(CommandLineOptions& opts, std::vector<std::string> args)
 			   "\n\t\t\t\t(UNIX).\n"
 #endif
 			   "\t--truncate-log\t\tReset log file each time the server is \n"
-			   "\t\t\t\tstarted.\n";
+			   "\t\t\t\tstarted.\n"
+			   "\t--migrate-items\t\tMove all player items to the format selected\n"
+			   "\t\t\t\tby PlayerItemBlobs and exit.\n";
 			return false;
 		} else {
 			std::cout << "Unrecognized command line argument '" << arg
@@ -413,8 +428,35 @@ void mainLoader(const CommandLineOptions& command_opts)
 		LOG_ERROR("Database Connection Failed!");
 		exit(-1);
 	}
+	DatabaseTasks::getInstance().start(g_config.getNumber(ConfigManager::DATABASE_WORKERS));
+	DatabasePool::getInstance().startup();
+	QueryStats::getInstance().startup();
+	ScriptProfiler::getInstance().setEnabled(g_config.getBoolean(ConfigManager::SCRIPT_PROFILER));
+	NpcScriptPool::getInstance().start(g_config.getNumber(ConfigManager::NPC_SCRIPT_THREADS));
+	g_bans.loadBans();
 	std::cout << "[done]" << std::endl;
 
+	if (!PlayerJournal::getInstance().startup()) {
+		LOG_ERROR("Unable to write the player journal to the database!");
+		exit(-1);
+	}
+
+	std::cout << ":: Loading player names... " << std::flush;
+	if (!PlayerDirectory::getInstance().load()) {
+		LOG_ERROR("Unable to load player names!");
+		exit(-1);
+	}
+	std::cout << "[done] " << PlayerDirectory::getInstance().size() << " players" << std::endl;
+
+	if (command_opts.migrate_items) {
+		std::cout << ":: Migrating player items... " << std::endl;
+		if (!IOPlayer::instance()->migrateItems()) {
+			LOG_ERROR("Unable to migrate player items!");
+			exit(-1);
+		}
+		exit(0);
+	}
+
 	std::stringstream filename;
 
 
@@ -473,6 +515,12 @@ void mainLoader(const CommandLineOptions& command_opts)
 		exit(-1);
 	}
 
+	uint32_t compiledChunks, cachedChunks;
+	uint64_t chunkMicros;
+	LuaChunkCache::getInstance().getStats(compiledChunks, cachedChunks, chunkMicros);
+	std::cout << ":: Lua chunks: " << compiledChunks << " compiled, " << cachedChunks << " from cache in "
+	          << chunkMicros / 1000 << " ms" << std::endl;
+
 
 
 	// load monster data
@@ -26,7 +26,7 @@
 
 // extern Dispatcher g_dispatcher;
 
-OutputMessage::OutputMessage()
+OutputMessage::OutputMessage() : NetworkMessage(m_buffer)
 {
 	freeMessage();
 }
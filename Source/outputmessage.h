@@ -161,6 +161,8 @@ protected:
 	uint64_t m_frame;
 
 	OutputMessageState m_state;
+
+	uint8_t m_buffer[NETWORKMESSAGE_MAXSIZE];
 };
 
 typedef boost::shared_ptr<OutputMessage> OutputMessage_ptr;
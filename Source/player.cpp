@@ -32,6 +32,8 @@
 #include "ioplayer.h"
 #include "movement.h"
 #include "player.h"
+#include "playerdirectory.h"
+#include "playerjournal.h"
 #include "status.h"
 #include "town.h"
 #include "weapons.h"
@@ -153,6 +155,12 @@ Player::Player(const std::string& _name, ProtocolGame* p) : Creature()
 
 	maxDepotLimit = 1000;
 	maxVipLimit = 50;
+
+	hasSaveSnapshot = false;
+	journaled = false;
+	spellsDirty = true;
+	storageDirty = true;
+	vipListDirty = true;
 	groupFlags = 0;
 	premiumDays = 0;
 	balance = 0;
@@ -842,7 +850,19 @@ void Player::dropLoot(Container* corpse)
 
 void Player::addStorageValue(const uint32_t key, const int32_t value)
 {
-	storageMap[key] = value;
+	StorageMap::iterator it = storageMap.find(key);
+	if (it == storageMap.end()) {
+		storageMap[key] = value;
+	} else if (it->second != value) {
+		it->second = value;
+	} else {
+		return;
+	}
+
+	storageDirty = true;
+	if (journaled) {
+		PlayerJournal::getInstance().addStorageValue(this, key, value);
+	}
 }
 
 bool Player::getStorageValue(const uint32_t key, int32_t& value) const
@@ -1812,6 +1832,9 @@ void Player::addManaSpent(uint32_t amount, bool useMultiplier /*= true*/)
 void Player::addExperience(uint64_t exp)
 {
 	experience += exp;
+	if (journaled) {
+		PlayerJournal::getInstance().addExperience(this);
+	}
 	int prevLevel = getLevel();
 	int newLevel = getLevel();
 
@@ -2280,6 +2303,7 @@ void Player::addDefaultRegeneration(uint32_t addTicks)
 void Player::removeList()
 {
 	listPlayer.removeList(getID());
+	PlayerDirectory::getInstance().removeOnline(this);
 
 	for (AutoList<Player>::listiterator it = Player::listPlayer.list.begin();
 	     it != Player::listPlayer.list.end(); ++it) {
@@ -2297,6 +2321,7 @@ void Player::addList()
 	}
 
 	listPlayer.addList(this);
+	PlayerDirectory::getInstance().addOnline(this);
 
 	Status::instance()->addPlayer();
 }
@@ -2341,6 +2366,7 @@ bool Player::removeVIP(uint32_t _guid)
 	VIPListSet::iterator it = VIPList.find(_guid);
 	if (it != VIPList.end()) {
 		VIPList.erase(it);
+		vipListDirty = true;
 		return true;
 	}
 	return false;
@@ -2371,6 +2397,7 @@ bool Player::addVIP(uint32_t _guid, std::string& name, bool isOnline, bool inter
 	}
 
 	VIPList.insert(_guid);
+	vipListDirty = true;
 
 	if (client && !internal) {
 		client->sendVIP(_guid, name, isOnline);
@@ -3026,6 +3053,10 @@ void Player::postAddNotification(Thing* thing, const Cylinder* oldParent, int32_
 		updateItemsLight();
 		updateInventoryWeigth();
 		sendStats();
+
+		if (journaled) {
+			PlayerJournal::getInstance().addInventory(this);
+		}
 	}
 
 	if (const Item* item = thing->getItem()) {
@@ -3066,6 +3097,10 @@ void Player::postRemoveNotification(Thing* thing,
 		updateItemsLight();
 		updateInventoryWeigth();
 		sendStats();
+
+		if (journaled) {
+			PlayerJournal::getInstance().addInventory(this);
+		}
 	}
 
 	if (const Item* item = thing->getItem()) {
@@ -3871,6 +3906,7 @@ void Player::learnInstantSpell(const std::string& name)
 {
 	if (!hasLearnedInstantSpell(name)) {
 		learnedInstantSpellList.push_back(name);
+		spellsDirty = true;
 	}
 }
 
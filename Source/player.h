@@ -1137,6 +1137,17 @@ protected:
 	StorageMap storageMap;
 	LightInfo itemsLight;
 
+	// what the database holds since the last load or save, IOPlayer::savePlayer
+	// only rewrites the sections that changed
+	bool hasSaveSnapshot;
+	// fully loaded, its changes go to the PlayerJournal from here on
+	bool journaled;
+	std::string savedItems;
+	std::string savedDepotItems;
+	bool spellsDirty;
+	bool storageDirty;
+	bool vipListDirty;
+
 	// read/write storage data
 	uint32_t windowTextId;
 	Item* writeItem;
@@ -0,0 +1,178 @@
+#include "otpch.h"
+
+#include "playerdirectory.h"
+
+#include "database.h"
+#include "player.h"
+#include "querystats.h"
+#include "tools.h"
+
+bool PlayerDirectory::load()
+{
+	DBQueryOrigin origin("PlayerDirectory::load");
+	Database* db = Database::instance();
+	DBResult* result = db->storeQuery("SELECT `id`, `name`, `group_id` FROM `players`");
+
+	boost::unique_lock<boost::shared_mutex> lockClass(m_lock);
+	m_entries.clear();
+	m_guids.clear();
+	if (!result) {
+		// no characters yet
+		return true;
+	}
+
+	do {
+		internalUpdate(result->getDataInt("id"), result->getDataString("name"), result->getDataInt("group_id"));
+	} while (result->next());
+
+	db->freeResult(result);
+	return true;
+}
+
+bool PlayerDirectory::getGuidByName(uint32_t& guid, std::string& name) const
+{
+	boost::shared_lock<boost::shared_mutex> lockClass(m_lock);
+	GuidMap::const_iterator it = m_guids.find(asLowerCaseString(name));
+	if (it == m_guids.end()) {
+		return false;
+	}
+
+	guid = it->second;
+	name = m_entries.find(guid)->second.name;
+	return true;
+}
+
+bool PlayerDirectory::getNameByGuid(uint32_t guid, std::string& name) const
+{
+	boost::shared_lock<boost::shared_mutex> lockClass(m_lock);
+	EntryMap::const_iterator it = m_entries.find(guid);
+	if (it == m_entries.end()) {
+		return false;
+	}
+
+	name = it->second.name;
+	return true;
+}
+
+bool PlayerDirectory::getGroupId(uint32_t guid, uint32_t& groupId) const
+{
+	boost::shared_lock<boost::shared_mutex> lockClass(m_lock);
+	EntryMap::const_iterator it = m_entries.find(guid);
+	if (it == m_entries.end()) {
+		return false;
+	}
+
+	groupId = it->second.groupId;
+	return true;
+}
+
+void PlayerDirectory::update(uint32_t guid, const std::string& name, uint32_t groupId)
+{
+	boost::unique_lock<boost::shared_mutex> lockClass(m_lock);
+	internalUpdate(guid, name, groupId);
+}
+
+void PlayerDirectory::internalUpdate(uint32_t guid, const std::string& name, uint32_t groupId)
+{
+	Entry& entry = m_entries[guid];
+	if (entry.name != name) {
+		if (!entry.name.empty()) {
+			// renamed
+			eraseName(entry.name, guid);
+		}
+
+		std::string key = asLowerCaseString(name);
+		GuidMap::iterator it = m_guids.find(key);
+		if (it != m_guids.end() && it->second != guid) {
+			// the name went to another character, the old one must have been renamed
+			// too. Its entry stays while it is online, removeOnline drops it.
+			EntryMap::iterator old = m_entries.find(it->second);
+			if (old != m_entries.end() && !old->second.player) {
+				m_entries.erase(old);
+			}
+		}
+
+		m_guids[key] = guid;
+		entry.name = name;
+	}
+
+	entry.groupId = groupId;
+}
+
+void PlayerDirectory::eraseName(const std::string& name, uint32_t guid)
+{
+	GuidMap::iterator it = m_guids.find(asLowerCaseString(name));
+	if (it != m_guids.end() && it->second == guid) {
+		m_guids.erase(it);
+	}
+}
+
+void PlayerDirectory::remove(uint32_t guid)
+{
+	boost::unique_lock<boost::shared_mutex> lockClass(m_lock);
+	EntryMap::iterator it = m_entries.find(guid);
+	if (it != m_entries.end()) {
+		eraseName(it->second.name, guid);
+		m_entries.erase(it);
+	}
+}
+
+Player* PlayerDirectory::getOnlinePlayer(const std::string& name) const
+{
+	boost::shared_lock<boost::shared_mutex> lockClass(m_lock);
+	GuidMap::const_iterator it = m_guids.find(asLowerCaseString(name));
+	if (it == m_guids.end()) {
+		return nullptr;
+	}
+
+	return m_entries.find(it->second)->second.player;
+}
+
+bool PlayerDirectory::isOnline(const std::string& name) const
+{
+	return getOnlinePlayer(name) != nullptr;
+}
+
+void PlayerDirectory::addOnline(Player* player)
+{
+	boost::unique_lock<boost::shared_mutex> lockClass(m_lock);
+	EntryMap::iterator it = m_entries.find(player->getGUID());
+	if (it == m_entries.end()) {
+		internalUpdate(player->getGUID(), player->getName(), 0);
+		it = m_entries.find(player->getGUID());
+	} else if (asLowerCaseString(it->second.name) != asLowerCaseString(player->getName())) {
+		internalUpdate(player->getGUID(), player->getName(), it->second.groupId);
+	}
+
+	if (!it->second.player) {
+		it->second.player = player;
+	}
+}
+
+void PlayerDirectory::removeOnline(Player* player)
+{
+	boost::unique_lock<boost::shared_mutex> lockClass(m_lock);
+	EntryMap::iterator it = m_entries.find(player->getGUID());
+	if (it == m_entries.end() || it->second.player != player) {
+		return;
+	}
+
+	it->second.player = nullptr;
+
+	// with clones allowed another one may still be around
+	for (AutoList<Player>::listiterator pit = Player::listPlayer.list.begin();
+	     pit != Player::listPlayer.list.end(); ++pit) {
+		if (pit->second != player && pit->second->getGUID() == player->getGUID()) {
+			it->second.player = pit->second;
+			break;
+		}
+	}
+
+	if (!it->second.player) {
+		GuidMap::const_iterator git = m_guids.find(asLowerCaseString(it->second.name));
+		if (git == m_guids.end() || git->second != it->first) {
+			// its name went to another character while it was online
+			m_entries.erase(it);
+		}
+	}
+}
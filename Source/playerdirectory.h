@@ -0,0 +1,97 @@
+//////////////////////////////////////////////////////////////////////
+// OpenTibia - an opensource roleplaying game
+//////////////////////////////////////////////////////////////////////
+// In-memory index of player names and guids
+//////////////////////////////////////////////////////////////////////
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef __OTSERV_PLAYERDIRECTORY_H__
+#define __OTSERV_PLAYERDIRECTORY_H__
+
+#include "definitions.h"
+
+#include <boost/thread.hpp>
+#include <string>
+
+class Player;
+
+/** Every character of the players table by guid and by name, names are
+  * matched case-insensitive. Filled once at startup and kept current by
+  * the server, characters made or renamed outside of it are picked up by
+  * IOPlayer when a lookup misses. Also knows which of them are online.
+  * Changed by the dispatcher, the status protocol reads it from the
+  * network thread.
+  */
+class PlayerDirectory
+{
+public:
+	static PlayerDirectory& getInstance()
+	{
+		static PlayerDirectory instance;
+		return instance;
+	}
+
+	/** Reads all characters, replacing what was known */
+	bool load();
+
+	/** \param name looked up case-insensitive, set to the stored spelling */
+	bool getGuidByName(uint32_t& guid, std::string& name) const;
+	bool getNameByGuid(uint32_t guid, std::string& name) const;
+	bool getGroupId(uint32_t guid, uint32_t& groupId) const;
+
+	/** Adds a character or updates its name and group */
+	void update(uint32_t guid, const std::string& name, uint32_t groupId);
+	void remove(uint32_t guid);
+
+	/** Dispatcher only, the player may be gone by the time another thread
+	  * looks at it
+	  */
+	Player* getOnlinePlayer(const std::string& name) const;
+	bool isOnline(const std::string& name) const;
+	void addOnline(Player* player);
+	void removeOnline(Player* player);
+
+	size_t size() const
+	{
+		boost::shared_lock<boost::shared_mutex> lockClass(m_lock);
+		return m_entries.size();
+	}
+
+protected:
+	PlayerDirectory() {}
+
+	struct Entry {
+		Entry() : groupId(0), player(nullptr) {}
+
+		std::string name;
+		uint32_t groupId;
+		Player* player;
+	};
+
+	typedef std::unordered_map<uint32_t, Entry> EntryMap;
+	// lower case name to guid
+	typedef std::unordered_map<std::string, uint32_t> GuidMap;
+
+	void internalUpdate(uint32_t guid, const std::string& name, uint32_t groupId);
+	// drops the name only while it still belongs to guid
+	void eraseName(const std::string& name, uint32_t guid);
+
+	mutable boost::shared_mutex m_lock;
+	EntryMap m_entries;
+	GuidMap m_guids;
+};
+
+#endif
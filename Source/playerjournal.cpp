@@ -0,0 +1,505 @@
+#include "otpch.h"
+
+#include "playerjournal.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+
+#if defined __WINDOWS__
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "configmanager.h"
+#include "database.h"
+#include "game.h"
+#include "ioplayer.h"
+#include "player.h"
+#include "querystats.h"
+#include "scheduler.h"
+
+extern ConfigManager g_config;
+extern Game g_game;
+
+static const char JOURNAL_MAGIC[4] = { 'O', 'T', 'P', 'J' };
+static const uint8_t JOURNAL_VERSION = 1;
+static const size_t JOURNAL_HEADER_SIZE = sizeof(JOURNAL_MAGIC) + 1;
+// type, guid and payload length before the payload, checksum after it
+static const size_t RECORD_HEADER_SIZE = 1 + 4 + 4;
+
+static void appendValue(std::string& buffer, const void* value, size_t size)
+{
+	buffer.append(static_cast<const char*>(value), size);
+}
+
+template <typename T>
+static void appendValue(std::string& buffer, T value)
+{
+	appendValue(buffer, &value, sizeof(T));
+}
+
+template <typename T>
+static bool readValue(const std::string& data, size_t& pos, T& value)
+{
+	if (pos + sizeof(T) > data.size()) {
+		return false;
+	}
+
+	memcpy(&value, data.data() + pos, sizeof(T));
+	pos += sizeof(T);
+	return true;
+}
+
+static uint32_t adlerChecksum(const char* data, size_t length)
+{
+	uint32_t a = 1, b = 0;
+	for (size_t i = 0; i < length; ++i) {
+		a = (a + (uint8_t)data[i]) % 65521;
+		b = (b + a) % 65521;
+	}
+
+	return (b << 16) | a;
+}
+
+PlayerJournal::PlayerJournal() : m_enabled(false), m_batched(false), m_file(nullptr), m_fileSize(0)
+{
+}
+
+PlayerJournal::~PlayerJournal()
+{
+	if (m_file) {
+		fclose(m_file);
+	}
+}
+
+bool PlayerJournal::startup()
+{
+	m_fileName = g_config.getString(ConfigManager::PLAYER_JOURNAL_FILE);
+	if (m_fileName.empty()) {
+		return true;
+	}
+
+	// whatever is left in the file did not make it into the database
+	std::ifstream file(m_fileName.c_str(), std::ios::binary);
+	if (file.is_open()) {
+		std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		file.close();
+
+		if (data.size() > JOURNAL_HEADER_SIZE) {
+			std::cout << ":: Replaying player journal " << m_fileName << std::endl;
+		}
+
+		if (!replay(data)) {
+			return false;
+		}
+	}
+
+	if (!g_config.getBoolean(ConfigManager::PLAYER_JOURNAL)) {
+		std::remove(m_fileName.c_str());
+		return true;
+	}
+
+	if (!openFile()) {
+		std::cout << "[Warning - PlayerJournal::startup] Can not open " << m_fileName
+		          << ", player changes are not journaled." << std::endl;
+		return true;
+	}
+
+	m_enabled = true;
+	Scheduler::getScheduler().addEvent(createSchedulerTask(
+	g_config.getNumber(ConfigManager::PLAYER_JOURNAL_INTERVAL), boost::bind(&PlayerJournal::flushEvent, this)));
+	Scheduler::getScheduler().addEvent(createSchedulerTask(
+	g_config.getNumber(ConfigManager::PLAYER_JOURNAL_COMPACT_INTERVAL) * 60 * 1000,
+	boost::bind(&PlayerJournal::compactEvent, this)));
+	return true;
+}
+
+bool PlayerJournal::compact()
+{
+	if (!m_enabled) {
+		return true;
+	}
+
+	flush();
+
+	std::ifstream file(m_fileName.c_str(), std::ios::binary);
+	std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	file.close();
+
+	// on failure the records stay for the next try
+	if (!replay(data)) {
+		return false;
+	}
+
+	if (!openFile()) {
+		std::cout << "[Warning - PlayerJournal::compact] Can not reopen " << m_fileName
+		          << ", player changes are not journaled." << std::endl;
+		m_enabled = false;
+		return false;
+	}
+
+	return true;
+}
+
+void PlayerJournal::addExperience(Player* player)
+{
+	if (m_enabled) {
+		m_experienceChanged.insert(player->getID());
+	}
+}
+
+void PlayerJournal::addInventory(Player* player)
+{
+	if (m_enabled) {
+		m_inventoryChanged.insert(player->getID());
+	}
+}
+
+void PlayerJournal::addStorageValue(Player* player, uint32_t key, int32_t value)
+{
+	if (!m_enabled) {
+		return;
+	}
+
+	std::string payload;
+	appendValue(payload, key);
+	appendValue(payload, value);
+	addRecord(RECORD_STORAGE, player->getGUID(), payload);
+}
+
+void PlayerJournal::addSaved(Player* player)
+{
+	if (!m_enabled) {
+		return;
+	}
+
+	m_experienceChanged.erase(player->getID());
+	m_inventoryChanged.erase(player->getID());
+	addRecord(RECORD_SAVED, player->getGUID(), std::string());
+
+	// replaying older records over this save would undo it
+	if (!m_batched) {
+		flush();
+	}
+}
+
+void PlayerJournal::setBatched(bool batched)
+{
+	m_batched = batched;
+}
+
+void PlayerJournal::addPlayer(Player* player)
+{
+	if (!m_enabled) {
+		return;
+	}
+
+	writeExperience(player);
+	writeInventory(player);
+	for (StorageMap::const_iterator it = player->getStorageIteratorBegin();
+	     it != player->getStorageIteratorEnd(); ++it) {
+		addStorageValue(player, it->first, it->second);
+	}
+}
+
+void PlayerJournal::addRecord(RecordType_t type, uint32_t guid, const std::string& payload)
+{
+	size_t start = m_buffer.size();
+	appendValue(m_buffer, (uint8_t)type);
+	appendValue(m_buffer, guid);
+	appendValue(m_buffer, (uint32_t)payload.size());
+	m_buffer += payload;
+	appendValue(m_buffer, adlerChecksum(m_buffer.data() + start, m_buffer.size() - start));
+}
+
+void PlayerJournal::writeExperience(Player* player)
+{
+	std::string payload;
+	appendValue(payload, player->getLevel());
+	appendValue(payload, player->getExperience());
+	addRecord(RECORD_EXPERIENCE, player->getGUID(), payload);
+}
+
+void PlayerJournal::writeInventory(Player* player)
+{
+	addRecord(RECORD_INVENTORY, player->getGUID(), IOPlayer::instance()->getInventoryBlob(player));
+}
+
+void PlayerJournal::flush()
+{
+	for (std::set<uint32_t>::const_iterator it = m_experienceChanged.begin();
+	     it != m_experienceChanged.end(); ++it) {
+		if (Player* player = g_game.getPlayerByID(*it)) {
+			writeExperience(player);
+		}
+	}
+	m_experienceChanged.clear();
+
+	for (std::set<uint32_t>::const_iterator it = m_inventoryChanged.begin();
+	     it != m_inventoryChanged.end(); ++it) {
+		if (Player* player = g_game.getPlayerByID(*it)) {
+			writeInventory(player);
+		}
+	}
+	m_inventoryChanged.clear();
+
+	if (m_buffer.empty() || !m_file) {
+		return;
+	}
+
+	if (fwrite(m_buffer.data(), 1, m_buffer.size(), m_file) != m_buffer.size() || fflush(m_file) != 0) {
+		// the buffer is kept and written again by the next flush
+		std::cout << "[Warning - PlayerJournal::flush] Can not write to " << m_fileName << std::endl;
+		if (!truncateFile(m_fileSize)) {
+			std::cout << "[Warning - PlayerJournal::flush] Can not truncate " << m_fileName
+			          << ", player changes are kept in memory until the next compact." << std::endl;
+		}
+		return;
+	}
+
+#if defined __WINDOWS__
+	_commit(_fileno(m_file));
+#else
+	fsync(fileno(m_file));
+#endif
+	m_fileSize += m_buffer.size();
+	m_buffer.clear();
+}
+
+void PlayerJournal::flushEvent()
+{
+	if (!m_enabled) {
+		return;
+	}
+
+	flush();
+	Scheduler::getScheduler().addEvent(createSchedulerTask(
+	g_config.getNumber(ConfigManager::PLAYER_JOURNAL_INTERVAL), boost::bind(&PlayerJournal::flushEvent, this)));
+}
+
+void PlayerJournal::compactEvent()
+{
+	if (!m_enabled) {
+		return;
+	}
+
+	compact();
+	Scheduler::getScheduler().addEvent(createSchedulerTask(
+	g_config.getNumber(ConfigManager::PLAYER_JOURNAL_COMPACT_INTERVAL) * 60 * 1000,
+	boost::bind(&PlayerJournal::compactEvent, this)));
+}
+
+bool PlayerJournal::openFile()
+{
+	if (m_file) {
+		fclose(m_file);
+	}
+
+	m_file = fopen(m_fileName.c_str(), "wb");
+	if (!m_file) {
+		return false;
+	}
+
+	fwrite(JOURNAL_MAGIC, 1, sizeof(JOURNAL_MAGIC), m_file);
+	fwrite(&JOURNAL_VERSION, 1, 1, m_file);
+	fflush(m_file);
+	m_fileSize = JOURNAL_HEADER_SIZE;
+	return true;
+}
+
+bool PlayerJournal::truncateFile(long size)
+{
+	// closing drops whatever stdio still holds of the failed write
+	if (m_file) {
+		fclose(m_file);
+	}
+
+	m_file = fopen(m_fileName.c_str(), "r+b");
+	if (!m_file) {
+		return false;
+	}
+
+#if defined __WINDOWS__
+	bool truncated = (_chsize(_fileno(m_file), size) == 0);
+#else
+	bool truncated = (ftruncate(fileno(m_file), size) == 0);
+#endif
+	if (!truncated || fseek(m_file, size, SEEK_SET) != 0) {
+		// appending after a torn record would hide everything written later
+		fclose(m_file);
+		m_file = nullptr;
+		return false;
+	}
+
+	return true;
+}
+
+struct JournalEntry {
+	JournalEntry() : hasExperience(false), level(0), experience(0), hasInventory(false) {}
+
+	bool hasExperience;
+	uint32_t level;
+	int64_t experience;
+	bool hasInventory;
+	std::string inventory;
+	std::map<uint32_t, int32_t> storage;
+};
+
+bool PlayerJournal::replay(const std::string& data)
+{
+	if (data.size() < JOURNAL_HEADER_SIZE) {
+		return true;
+	}
+
+	if (memcmp(data.data(), JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) != 0 ||
+	    (uint8_t)data[sizeof(JOURNAL_MAGIC)] != JOURNAL_VERSION) {
+		std::string badName = m_fileName + ".bad";
+		std::cout << "[Warning - PlayerJournal::replay] " << m_fileName
+		          << " is not a player journal, moved to " << badName << std::endl;
+		std::rename(m_fileName.c_str(), badName.c_str());
+		return true;
+	}
+
+	// keep only the last state of every player since it was saved
+	typedef std::map<uint32_t, JournalEntry> EntryMap;
+	EntryMap entries;
+
+	size_t pos = JOURNAL_HEADER_SIZE;
+	while (pos < data.size()) {
+		size_t start = pos;
+		uint8_t type;
+		uint32_t guid, length, checksum;
+		if (!readValue(data, pos, type) || !readValue(data, pos, guid) ||
+		    !readValue(data, pos, length) || length > data.size() - pos) {
+			break;
+		}
+
+		std::string payload = data.substr(pos, length);
+		pos += length;
+		if (!readValue(data, pos, checksum) ||
+		    checksum != adlerChecksum(data.data() + start, RECORD_HEADER_SIZE + length)) {
+			pos = start;
+			break;
+		}
+
+		size_t payloadPos = 0;
+		switch (type) {
+		case RECORD_EXPERIENCE: {
+			JournalEntry& entry = entries[guid];
+			entry.hasExperience = readValue(payload, payloadPos, entry.level) &&
+			                      readValue(payload, payloadPos, entry.experience);
+			break;
+		}
+
+		case RECORD_INVENTORY: {
+			JournalEntry& entry = entries[guid];
+			entry.hasInventory = true;
+			entry.inventory.swap(payload);
+			break;
+		}
+
+		case RECORD_STORAGE: {
+			uint32_t key;
+			int32_t value;
+			if (readValue(payload, payloadPos, key) && readValue(payload, payloadPos, value)) {
+				entries[guid].storage[key] = value;
+			}
+			break;
+		}
+
+		case RECORD_SAVED:
+			entries.erase(guid);
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	if (pos < data.size()) {
+		// the server went down in the middle of a write
+		std::cout << "[Warning - PlayerJournal::replay] Dropped " << data.size() - pos
+		          << " bytes of an unfinished record." << std::endl;
+	}
+
+	if (entries.empty()) {
+		return true;
+	}
+
+	DBQueryOrigin origin("PlayerJournal::replay");
+	Database* db = Database::instance();
+	DBQuery lockDatabase;
+
+	DBTransaction transaction(db);
+	if (!transaction.begin()) {
+		return false;
+	}
+
+	for (EntryMap::const_iterator it = entries.begin(); it != entries.end(); ++it) {
+		const JournalEntry& entry = it->second;
+		if (entry.hasExperience) {
+			DBStatement* stmt = db->getStatement("UPDATE `players` SET `level` = ?, `experience` = ? "
+			                                     "WHERE `id` = ?");
+			if (!stmt) {
+				return false;
+			}
+
+			stmt->bindInt(entry.level);
+			stmt->bindInt(entry.experience);
+			stmt->bindInt(it->first);
+			if (!stmt->executeQuery()) {
+				return false;
+			}
+		}
+
+		if (entry.hasInventory && !IOPlayer::instance()->replaceInventory(db, it->first, entry.inventory)) {
+			return false;
+		}
+
+		for (std::map<uint32_t, int32_t>::const_iterator sit = entry.storage.begin();
+		     sit != entry.storage.end(); ++sit) {
+			DBStatement* stmt = db->getStatement("DELETE FROM `player_storage` WHERE `player_id` = ? "
+			                                     "AND `key` = ?");
+			if (!stmt) {
+				return false;
+			}
+
+			stmt->bindInt(it->first);
+			stmt->bindInt(sit->first);
+			if (!stmt->executeQuery()) {
+				return false;
+			}
+
+			if (!(stmt = db->getStatement("INSERT INTO `player_storage` (`player_id`, `key`, `value`) "
+			                              "VALUES (?, ?, ?)"))) {
+				return false;
+			}
+
+			stmt->bindInt(it->first);
+			stmt->bindInt(sit->first);
+			stmt->bindInt(sit->second);
+			if (!stmt->executeQuery()) {
+				return false;
+			}
+		}
+	}
+
+	if (!transaction.commit()) {
+		return false;
+	}
+
+	// players still online must not skip their next inventory save
+	for (AutoList<Player>::listiterator it = Player::listPlayer.list.begin();
+	     it != Player::listPlayer.list.end(); ++it) {
+		EntryMap::const_iterator eit = entries.find(it->second->getGUID());
+		if (eit != entries.end() && eit->second.hasInventory) {
+			IOPlayer::instance()->setInventorySnapshot(it->second, eit->second.inventory);
+		}
+	}
+
+	return true;
+}
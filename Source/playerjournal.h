@@ -0,0 +1,120 @@
+//////////////////////////////////////////////////////////////////////
+// OpenTibia - an opensource roleplaying game
+//////////////////////////////////////////////////////////////////////
+// Local journal of player changes made between saves
+//////////////////////////////////////////////////////////////////////
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef __OTSERV_PLAYERJOURNAL_H__
+#define __OTSERV_PLAYERJOURNAL_H__
+
+#include "definitions.h"
+
+#include <cstdio>
+#include <set>
+#include <string>
+
+class Player;
+
+/** Append-only file of what online players changed since their last save:
+  * level and experience, inventory and storage values. Changes are
+  * gathered on the dispatcher and written every PlayerJournalInterval ms,
+  * a successful save of a player marks its older records as done.
+  * compact() writes what is left to the database and empties the file,
+  * startup() does the same for whatever a crash left behind.
+  */
+class PlayerJournal
+{
+public:
+	~PlayerJournal();
+
+	static PlayerJournal& getInstance()
+	{
+		static PlayerJournal instance;
+		return instance;
+	}
+
+	/** Replays the journal left by the last run into the database, then
+	  * opens it for this run if PlayerJournal is enabled. Must run before
+	  * any player is loaded.
+	  * \return false if the journal could not be written to the database
+	  */
+	bool startup();
+
+	/** Writes the journal to the database and empties it */
+	bool compact();
+
+	/** Called by the player, only once it was fully loaded */
+	void addExperience(Player* player);
+	void addInventory(Player* player);
+	void addStorageValue(Player* player, uint32_t key, int32_t value);
+
+	/** Everything up to here is in the database for this player, the
+	  * mark is written right away unless batched
+	  */
+	void addSaved(Player* player);
+
+	/** While batched, saved marks wait for the next flush or compact(),
+	  * for the server save that compacts once everyone is saved
+	  */
+	void setBatched(bool batched);
+
+	/** Records the whole journaled state of a player, for when a save
+	  * that was already marked got rolled back
+	  */
+	void addPlayer(Player* player);
+
+protected:
+	PlayerJournal();
+
+	enum RecordType_t {
+		RECORD_EXPERIENCE = 1,
+		RECORD_INVENTORY = 2,
+		RECORD_STORAGE = 3,
+		RECORD_SAVED = 4
+	};
+
+	void addRecord(RecordType_t type, uint32_t guid, const std::string& payload);
+	void writeExperience(Player* player);
+	void writeInventory(Player* player);
+
+	void flush();
+	void flushEvent();
+	void compactEvent();
+
+	bool replay(const std::string& data);
+	// starts an empty journal, replacing the file
+	bool openFile();
+	// cuts off a failed write, so replay() still reaches the records after it
+	bool truncateFile(long size);
+
+	bool m_enabled;
+	bool m_batched;
+	std::string m_fileName;
+	FILE* m_file;
+	// end of the last complete write
+	long m_fileSize;
+
+	// records not yet on disk
+	std::string m_buffer;
+
+	// ids of players whose experience or inventory changed since the last flush,
+	// written as a whole when flushing so busy players cost one record each
+	std::set<uint32_t> m_experienceChanged;
+	std::set<uint32_t> m_inventoryChanged;
+};
+
+#endif
@@ -25,6 +25,7 @@
 
 #include <cmath>
 #include <cstdlib>
+#include <functional>
 #include <iostream>
 
 enum Direction {
@@ -125,6 +126,14 @@ public:
 	}
 };
 
+/** Hash for unordered containers keyed by Position */
+struct PositionHash {
+	std::size_t operator()(const Position& pos) const
+	{
+		return std::hash<uint64_t>()(((uint64_t)pos.z << 32) | ((uint64_t)pos.y << 16) | pos.x);
+	}
+};
+
 std::ostream& operator<<(std::ostream&, const Position&);
 std::ostream& operator<<(std::ostream&, const Direction&);
 
@@ -16,6 +16,7 @@
 #include "configmanager.h"
 #include "connection.h"
 #include "creatureevent.h"
+#include "databasetasks.h"
 #include "game.h"
 #include "house.h"
 #include "ioaccount.h"
@@ -40,8 +41,34 @@ Chat g_chat;
 
 #ifdef __ENABLE_SERVER_DIAGNOSTIC__
 uint32_t ProtocolGame::ProtocolGameCount = 0;
+LoginStats ProtocolGame::loginStats = {};
 #endif
 
+struct LoginRequest {
+	LoginRequest(const std::string& _name, bool _isSetGM)
+	    : name(_name), isSetGM(_isSetGM), lastMark(OTSYS_TIME())
+	{
+	}
+
+	// adds the time since the previous mark to a phase
+	void mark(LoginStats::phase_t phase)
+	{
+		int64_t now = OTSYS_TIME();
+		phaseTime[phase] += now - lastMark;
+		lastMark = now;
+	}
+
+	std::string name;
+	bool isSetGM;
+	PlayerLoadData data;
+	bool found = false;
+	bool banished = false;
+	bool nameLocked = false;
+
+	int64_t lastMark;
+	int64_t phaseTime[LoginStats::LAST] = {};
+};
+
 #ifdef __SERVER_PROTECTION__
 #error "You should not define __SERVER_PROTECTION__"
 #define ADD_TASK_INTERVAL 40
@@ -130,94 +157,11 @@ bool ProtocolGame::login(const std::string& name, bool isSetGM)
 	// dispatcher thread
 	Player* _player = g_game.getPlayerByName(name);
 	if (!_player || g_config.getBoolean(ConfigManager::ALLOW_CLONES)) {
-		player = new Player(name, this);
-		player->useThing2();
-		player->setID();
-
-		if (!IOPlayer::instance()->loadPlayer(player, name, true)) {
-#ifdef __DEBUG__
-			std::cout << "ProtocolGame::login - preloading loadPlayer failed - " << name
-			          << std::endl;
-#endif
-			disconnectClient(0x14, "Your character could not be loaded.");
-			return false;
-		}
-
-		if (g_bans.isBanished(player->getAccount()) && !player->hasFlag(PlayerFlag_CannotBeBanned)) {
-			disconnectClient(0x14, "Your account is banished!");
-			return false;
-		}
-
-		if (g_bans.isNameLocked(player->getName())) {
-			disconnectClient(0x14, "Your character has been name locked.");
-			return false;
-		}
-
-		if (isSetGM && !player->hasFlag(PlayerFlag_CanAlwaysLogin)) {
-			disconnectClient(0x14, "You may only login with a Gamemaster account.");
-			return false;
-		}
-
-		if (g_game.getGameState() == GAME_STATE_CLOSING && !player->hasFlag(PlayerFlag_CanAlwaysLogin)) {
-			disconnectClient(0x14,
-			                 "The game is just going down.\nPlease try again later.");
-			return false;
-		}
-
-		if (g_game.getGameState() == GAME_STATE_CLOSED && !player->hasFlag(PlayerFlag_CanAlwaysLogin)) {
-			disconnectClient(0x14, "Server is closed.");
-			return false;
-		}
-
-		if (g_config.getBoolean(ConfigManager::CHECK_ACCOUNTS) &&
-		    !player->hasFlag(PlayerFlag_CanAlwaysLogin) &&
-		    g_game.getPlayerByAccount(player->getAccount())) {
-			disconnectClient(0x14,
-			                 "You may only login with one character per account.");
-			return false;
-		}
-
-		if (!WaitingList::getInstance().clientLogin(*player)) {
-			int32_t currentSlot = WaitingList::getInstance().getClientSlot(*player);
-			int32_t retryTime = WaitingList::getTime(currentSlot);
-			std::stringstream ss;
-
-			ss << "Too many players online.\n"
-			   << "You are at place " << currentSlot << " on the waiting list.";
-
-			OutputMessage_ptr output =
-			OutputMessagePool::getInstance()->getOutputMessage(this, false);
-			if (output) {
-				TRACK_MESSAGE(output);
-				output->AddByte(0x16);
-				output->AddString(ss.str());
-				output->AddByte(retryTime);
-				OutputMessagePool::getInstance()->send(output);
-			}
-			getConnection()->closeConnection();
-			return false;
-		}
-
-		if (!IOPlayer::instance()->loadPlayer(player, name)) {
-#ifdef __DEBUG__
-			std::cout << "ProtocolGame::login - loadPlayer failed - " << name << std::endl;
-#endif
-			disconnectClient(0x14, "Your character could not be loaded.");
-			return false;
-		}
-
-		if (!g_game.placeCreature(player, player->getLoginPosition())) {
-			if (!g_game.placeCreature(player, player->getTemplePosition(), false, true)) {
-				disconnectClient(0x14, "Temple position is wrong. Contact the "
-				                       "administrator.");
-				return false;
-			}
-		}
-
-		player->lastip = player->getIP();
-		player->lastLoginSaved = std::max(time(nullptr), player->lastLoginSaved + 1);
-		m_acceptPackets = true;
-
+		// keep the protocol alive until the player is read and placed
+		addRef();
+		LoginRequest_ptr request(new LoginRequest(name, isSetGM));
+		DatabaseTasks::getInstance().addTask(
+		createTask(boost::bind(&ProtocolGame::preloadPlayer, this, request)));
 		return true;
 	} else {
 		if (eventConnect != 0 || g_config.getBoolean(ConfigManager::KICK_ON_LOGIN)) {
@@ -243,6 +187,162 @@ bool ProtocolGame::login(const std::string& name, bool isSetGM)
 	return false;
 }
 
+void ProtocolGame::preloadPlayer(LoginRequest_ptr request)
+{
+	// database worker
+	request->mark(LoginStats::QUEUE);
+	request->found = IOPlayer::instance()->loadPlayerData(request->data, request->name,
+	                                                         DatabaseTasks::getConnection());
+	if (request->found) {
+		request->banished = g_bans.isBanished(request->data.accountNumber);
+		request->nameLocked = g_bans.isNameLocked(request->data.guid);
+	}
+
+	request->mark(LoginStats::DATABASE);
+	Dispatcher::getDispatcher().addTask(
+	createTask(boost::bind(&ProtocolGame::onPlayerPreloaded, this, request)));
+}
+
+void ProtocolGame::onPlayerPreloaded(LoginRequest_ptr request)
+{
+	// dispatcher thread
+	request->mark(LoginStats::QUEUE);
+	if (!getConnection()) {
+		// the client went away while waiting
+		unRef();
+		return;
+	}
+
+	if (!request->found) {
+#ifdef __DEBUG__
+		std::cout << "ProtocolGame::login - preloading loadPlayer failed - " << request->name
+		          << std::endl;
+#endif
+		disconnectClient(0x14, "Your character could not be loaded.");
+		unRef();
+		return;
+	}
+
+	if (!g_config.getBoolean(ConfigManager::ALLOW_CLONES) && g_game.getPlayerByName(request->name)) {
+		// logged in from somewhere else meanwhile, take that one over instead
+		unRef();
+		login(request->name, request->isSetGM);
+		return;
+	}
+
+	player = new Player(request->name, this);
+	player->useThing2();
+	player->setID();
+	IOPlayer::instance()->applyPlayerData(player, request->data, true);
+
+	const char* error = nullptr;
+	if (request->banished && !player->hasFlag(PlayerFlag_CannotBeBanned)) {
+		error = "Your account is banished!";
+	} else if (request->nameLocked) {
+		error = "Your character has been name locked.";
+	} else if (request->isSetGM && !player->hasFlag(PlayerFlag_CanAlwaysLogin)) {
+		error = "You may only login with a Gamemaster account.";
+	} else if (g_game.getGameState() == GAME_STATE_CLOSING &&
+	           !player->hasFlag(PlayerFlag_CanAlwaysLogin)) {
+		error = "The game is just going down.\nPlease try again later.";
+	} else if (g_game.getGameState() == GAME_STATE_CLOSED &&
+	           !player->hasFlag(PlayerFlag_CanAlwaysLogin)) {
+		error = "Server is closed.";
+	}
+
+	if (error) {
+		disconnectClient(0x14, error);
+		unRef();
+		return;
+	}
+
+	request->mark(LoginStats::DISPATCHER);
+	DatabaseTasks::getInstance().addTask(
+	createTask(boost::bind(&ProtocolGame::loadPlayerDetails, this, request)));
+}
+
+void ProtocolGame::loadPlayerDetails(LoginRequest_ptr request)
+{
+	// database worker
+	request->mark(LoginStats::QUEUE);
+	IOPlayer::instance()->loadPlayerDetails(request->data, DatabaseTasks::getConnection());
+	request->mark(LoginStats::DATABASE);
+	Dispatcher::getDispatcher().addTask(
+	createTask(boost::bind(&ProtocolGame::onPlayerLoaded, this, request)));
+}
+
+void ProtocolGame::onPlayerLoaded(LoginRequest_ptr request)
+{
+	// dispatcher thread
+	request->mark(LoginStats::QUEUE);
+	unRef();
+	if (!getConnection()) {
+		return;
+	}
+
+	// these depend on who is online, so they are checked right before placing
+	if (!g_config.getBoolean(ConfigManager::ALLOW_CLONES) && g_game.getPlayerByName(request->name)) {
+		disconnectClient(0x14, "You are already logged in.");
+		return;
+	}
+
+	if (g_config.getBoolean(ConfigManager::CHECK_ACCOUNTS) &&
+	    !player->hasFlag(PlayerFlag_CanAlwaysLogin) &&
+	    g_game.getPlayerByAccount(player->getAccount())) {
+		disconnectClient(0x14, "You may only login with one character per account.");
+		return;
+	}
+
+	if (!WaitingList::getInstance().clientLogin(*player)) {
+		int32_t currentSlot = WaitingList::getInstance().getClientSlot(*player);
+		int32_t retryTime = WaitingList::getTime(currentSlot);
+		std::stringstream ss;
+
+		ss << "Too many players online.\n"
+		   << "You are at place " << currentSlot << " on the waiting list.";
+
+		OutputMessage_ptr output = OutputMessagePool::getInstance()->getOutputMessage(this, false);
+		if (output) {
+			TRACK_MESSAGE(output);
+			output->AddByte(0x16);
+			output->AddString(ss.str());
+			output->AddByte(retryTime);
+			OutputMessagePool::getInstance()->send(output);
+		}
+		disconnect();
+		return;
+	}
+
+	if (!IOPlayer::instance()->applyPlayerData(player, request->data)) {
+#ifdef __DEBUG__
+		std::cout << "ProtocolGame::login - loadPlayer failed - " << request->name << std::endl;
+#endif
+		disconnectClient(0x14, "Your character could not be loaded.");
+		return;
+	}
+
+	if (!g_game.placeCreature(player, player->getLoginPosition())) {
+		if (!g_game.placeCreature(player, player->getTemplePosition(), false, true)) {
+			disconnectClient(0x14, "Temple position is wrong. Contact the "
+			                       "administrator.");
+			return;
+		}
+	}
+
+	player->lastip = player->getIP();
+	player->lastLoginSaved = std::max(time(nullptr), player->lastLoginSaved + 1);
+	m_acceptPackets = true;
+
+#ifdef __ENABLE_SERVER_DIAGNOSTIC__
+	request->mark(LoginStats::DISPATCHER);
+	++loginStats.count;
+	for (int32_t i = 0; i < LoginStats::LAST; ++i) {
+		loginStats.total[i] += request->phaseTime[i];
+		loginStats.max[i] = std::max(loginStats.max[i], request->phaseTime[i]);
+	}
+#endif
+}
+
 bool ProtocolGame::connect(uint32_t playerId)
 {
 	unRef();
@@ -771,49 +871,11 @@ void ProtocolGame::GetFloorDescription(NetworkMessage_ptr msg, int x, int y, int
 
 void ProtocolGame::checkCreatureAsKnown(uint32_t id, bool& known, uint32_t& removedKnown)
 {
-	// loop through the known player and check if the given player is in
-	std::list<uint32_t>::iterator i;
-	for (i = knownCreatureList.begin(); i != knownCreatureList.end(); ++i) {
-		if ((*i) == id) {
-			// know... make the creature even more known...
-			knownCreatureList.erase(i);
-			knownCreatureList.push_back(id);
-
-			known = true;
-			return;
-		}
-	}
-
-	// ok, he is unknown...
-	known = false;
-
-	// ... but not in future
-	knownCreatureList.push_back(id);
-
-	// to many known creatures?
-	if (knownCreatureList.size() > 150) // 150 for 7.8x
-	{
-		// lets try to remove one from the end of the list
-		for (int n = 0; n < 150; n++) {
-			removedKnown = knownCreatureList.front();
-
-			Creature* c = g_game.getCreatureByID(removedKnown);
-			if ((!c) || (!canSee(c))) {
-				break;
-			}
-
-			// this creature we can't remove, still in sight, so back to the end
-			knownCreatureList.pop_front();
-			knownCreatureList.push_back(removedKnown);
-		}
-
-		// hopefully we found someone to remove :S, we got only 150 tries
-		// if not... lets kick some players with debug errors :)
-		knownCreatureList.pop_front();
-	} else {
-		// we can cache without problems :)
-		removedKnown = 0;
-	}
+	known = knownCreatures.touch(id, removedKnown, [this](uint32_t knownId) {
+		// creatures still in sight can't be removed from the client cache
+		const Creature* c = g_game.getCreatureByID(knownId);
+		return !c || !canSee(c);
+	});
 }
 
 bool ProtocolGame::canSee(const Creature* c) const
@@ -7,6 +7,7 @@
 #include "creature.h"
 #include "definitions.h"
 #include "enums.h"
+#include "KnownCreatures.h"
 #include "protocol.h"
 
 
@@ -25,12 +26,29 @@ class House;
 class Container;
 class Tile;
 class Connection;
+struct LoginRequest;
+typedef boost::shared_ptr<LoginRequest> LoginRequest_ptr;
+
+/** Time spent by completed logins in each phase, in milliseconds */
+struct LoginStats {
+	enum phase_t {
+		QUEUE,      // waiting for a database worker or for the dispatcher
+		DATABASE,   // reading the player on a database worker
+		DISPATCHER, // checks, building and placing the player
+		LAST
+	};
+
+	uint32_t count;
+	int64_t total[LAST];
+	int64_t max[LAST];
+};
 
 class ProtocolGame : public Protocol
 {
 public:
 #ifdef __ENABLE_SERVER_DIAGNOSTIC__
 	static uint32_t ProtocolGameCount;
+	static LoginStats loginStats;
 #endif
 
 	ProtocolGame(Connection* connection);
@@ -42,9 +60,16 @@ public:
 	void setPlayer(Player* p);
 
 private:
-	std::list<uint32_t> knownCreatureList;
+	KnownCreatures knownCreatures;
 
 	bool connect(uint32_t playerId);
+
+	// a new login reads the player on a database worker in two steps,
+	// the dispatcher checks the preloaded player in between
+	void preloadPlayer(LoginRequest_ptr request);
+	void onPlayerPreloaded(LoginRequest_ptr request);
+	void loadPlayerDetails(LoginRequest_ptr request);
+	void onPlayerLoaded(LoginRequest_ptr request);
 	void disconnectClient(uint8_t error, const char* message);
 	void disconnect();
 
@@ -0,0 +1,232 @@
+#include "otpch.h"
+
+#include "querystats.h"
+
+#include <algorithm>
+#include <cctype>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "configmanager.h"
+#include "scheduler.h"
+#include "tools.h"
+
+extern ConfigManager g_config;
+
+const uint32_t QueryStats::bucketLimits[QueryStats::BUCKET_COUNT - 1] = { 1,  2,   5,   10,  25,
+	                                                                      50, 100, 250, 500, 1000 };
+
+// name given by the innermost DBQueryOrigin of the thread
+static thread_local const char* t_origin = nullptr;
+
+DBQueryOrigin::DBQueryOrigin(const char* name)
+{
+	m_previous = t_origin;
+	t_origin = name;
+}
+
+DBQueryOrigin::~DBQueryOrigin()
+{
+	t_origin = m_previous;
+}
+
+const char* DBQueryOrigin::current()
+{
+	return t_origin ? t_origin : "unknown";
+}
+
+DBQueryTimer::~DBQueryTimer()
+{
+	uint64_t micros = std::chrono::duration_cast<std::chrono::microseconds>(
+	                  std::chrono::steady_clock::now() - m_start)
+	                  .count();
+	QueryStats::getInstance().record(m_query, micros);
+}
+
+QueryStats::QueryStats()
+{
+	m_since = std::time(nullptr);
+}
+
+void QueryStats::startup()
+{
+	if (g_config.getNumber(ConfigManager::QUERYSTATS_DUMP_INTERVAL) > 0) {
+		Scheduler::getScheduler().addEvent(createSchedulerTask(
+		g_config.getNumber(ConfigManager::QUERYSTATS_DUMP_INTERVAL) * 60 * 1000,
+		boost::bind(&QueryStats::dump, this)));
+	}
+}
+
+void QueryStats::record(const char* query, uint64_t micros)
+{
+	std::string shape = normalize(query);
+
+	uint32_t bucket = 0;
+	while (bucket < BUCKET_COUNT - 1 && micros >= bucketLimits[bucket] * 1000) {
+		++bucket;
+	}
+
+	m_lock.lock();
+	Shape& stats = m_shapes[shape];
+	++stats.count;
+	stats.totalMicros += micros;
+	stats.maxMicros = std::max(stats.maxMicros, micros);
+	++stats.buckets[bucket];
+	m_lock.unlock();
+
+	int32_t slowQueryTime = g_config.getNumber(ConfigManager::SLOW_QUERY_TIME);
+	if (slowQueryTime > 0 && micros >= (uint64_t)slowQueryTime * 1000) {
+		std::string text(query);
+		if (text.length() > 300) {
+			text.resize(300);
+			text += "...";
+		}
+
+		char buffer[32];
+		formatDate(std::time(nullptr), buffer);
+		std::cout << buffer << " [Slow query] " << micros / 1000 << " ms in "
+		          << DBQueryOrigin::current() << ": " << text << std::endl;
+	}
+}
+
+void QueryStats::write(std::ostream& os, uint32_t limit, bool histogram)
+{
+	typedef std::pair<std::string, Shape> ShapeEntry;
+	std::vector<ShapeEntry> shapes;
+
+	m_lock.lock();
+	shapes.assign(m_shapes.begin(), m_shapes.end());
+	time_t since = m_since;
+	m_lock.unlock();
+
+	std::sort(shapes.begin(), shapes.end(), [](const ShapeEntry& a, const ShapeEntry& b) {
+		return a.second.totalMicros > b.second.totalMicros;
+	});
+
+	if (limit > 0 && shapes.size() > limit) {
+		shapes.resize(limit);
+	}
+
+	char buffer[32];
+	formatDate(since, buffer);
+	os << "Queries since " << buffer << ", by total time:\n";
+
+	os << std::fixed << std::setprecision(2);
+	for (std::vector<ShapeEntry>::const_iterator it = shapes.begin(); it != shapes.end(); ++it) {
+		const Shape& stats = it->second;
+		os << stats.count << "x, total " << stats.totalMicros / 1000 << " ms, avg "
+		   << (double)stats.totalMicros / stats.count / 1000 << " ms, max "
+		   << (double)stats.maxMicros / 1000 << " ms: " << it->first << "\n";
+
+		if (histogram) {
+			os << "\t";
+			for (uint32_t i = 0; i < BUCKET_COUNT; ++i) {
+				if (stats.buckets[i] == 0) {
+					continue;
+				}
+
+				if (i < BUCKET_COUNT - 1) {
+					os << "<" << bucketLimits[i];
+				} else {
+					os << ">=" << bucketLimits[i - 1];
+				}
+				os << " ms: " << stats.buckets[i] << "  ";
+			}
+			os << "\n";
+		}
+	}
+}
+
+void QueryStats::reset()
+{
+	boost::lock_guard<boost::mutex> lockClass(m_lock);
+	m_shapes.clear();
+	m_since = std::time(nullptr);
+}
+
+void QueryStats::dump()
+{
+	std::ofstream file(g_config.getString(ConfigManager::QUERYSTATS_FILE).c_str(), std::ios::trunc);
+	if (file.is_open()) {
+		write(file, 0, true);
+	} else {
+		std::cout << "[Warning - QueryStats::dump] Can not open "
+		          << g_config.getString(ConfigManager::QUERYSTATS_FILE) << std::endl;
+	}
+
+	startup();
+}
+
+static inline bool isIdentifierChar(char ch)
+{
+	return isalnum((unsigned char)ch) || ch == '_' || ch == '`' || ch == '"';
+}
+
+static void foldAll(std::string& shape, const std::string& repeated, const std::string& single)
+{
+	std::string::size_type pos;
+	while ((pos = shape.find(repeated)) != std::string::npos) {
+		shape.replace(pos, repeated.length(), single);
+	}
+}
+
+std::string QueryStats::normalize(const char* query)
+{
+	std::string shape;
+	shape.reserve(128);
+
+	const char* p = query;
+	char last = ' ';
+	while (*p && shape.length() < 512) {
+		char ch = *p;
+		if (ch == '\'' || ((ch == 'x' || ch == 'X') && p[1] == '\'' && !isIdentifierChar(last))) {
+			// string or blob literal, quotes are escaped by doubling or a backslash
+			p += (ch == '\'' ? 1 : 2);
+			while (*p) {
+				if (*p == '\\' && p[1]) {
+					p += 2;
+				} else if (*p == '\'' && p[1] == '\'') {
+					p += 2;
+				} else if (*p == '\'') {
+					++p;
+					break;
+				} else {
+					++p;
+				}
+			}
+			shape += '?';
+		} else if ((isdigit((unsigned char)ch) || (ch == '-' && isdigit((unsigned char)p[1]) && last != ')')) &&
+		           !isIdentifierChar(last)) {
+			++p;
+			while (isdigit((unsigned char)*p) || *p == '.') {
+				++p;
+			}
+			shape += '?';
+		} else if (isspace((unsigned char)ch)) {
+			++p;
+			while (isspace((unsigned char)*p)) {
+				++p;
+			}
+
+			// spacing around lists depends on who built the query
+			if (last != ',' && last != '(' && *p != ',' && *p != ')' && *p) {
+				shape += ' ';
+				last = ' ';
+			}
+			continue;
+		} else {
+			shape += ch;
+			++p;
+		}
+
+		last = shape.empty() ? ' ' : shape[shape.length() - 1];
+	}
+
+	// IN lists and multi-row inserts differ only in length
+	foldAll(shape, "?,?", "?");
+	foldAll(shape, "(?),(?)", "(?)");
+	return shape;
+}
@@ -0,0 +1,113 @@
+//////////////////////////////////////////////////////////////////////
+// OpenTibia - an opensource roleplaying game
+//////////////////////////////////////////////////////////////////////
+// Latency statistics and slow query log for the database drivers
+//////////////////////////////////////////////////////////////////////
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef __OTSERV_QUERYSTATS_H__
+#define __OTSERV_QUERYSTATS_H__
+
+#include "definitions.h"
+
+#include <algorithm>
+#include <boost/thread.hpp>
+#include <chrono>
+#include <map>
+#include <ostream>
+#include <string>
+
+/** Collects how long the queries of every shape take, a shape is the
+  * query with its literals replaced by '?'. Drivers report through
+  * DBQueryTimer from any thread.
+  */
+class QueryStats
+{
+public:
+	/** Upper bounds of the histogram buckets in ms, the last bucket has none */
+	static const uint32_t BUCKET_COUNT = 11;
+	static const uint32_t bucketLimits[BUCKET_COUNT - 1];
+
+	struct Shape {
+		Shape() : count(0), totalMicros(0), maxMicros(0)
+		{
+			std::fill(buckets, buckets + BUCKET_COUNT, 0);
+		}
+
+		uint64_t count;
+		uint64_t totalMicros;
+		uint64_t maxMicros;
+		uint64_t buckets[BUCKET_COUNT];
+	};
+
+	static QueryStats& getInstance()
+	{
+		static QueryStats instance;
+		return instance;
+	}
+
+	/** Starts the periodic dump to QueryStatsFile */
+	void startup();
+
+	void record(const char* query, uint64_t micros);
+
+	/** Writes the shapes that took the most time in total
+	  * \param limit how many shapes, 0 for all of them
+	  * \param histogram include the bucket counts
+	  */
+	void write(std::ostream& os, uint32_t limit, bool histogram);
+	void reset();
+
+	/** Replaces numbers, strings and blobs by '?' and folds value lists */
+	static std::string normalize(const char* query);
+
+protected:
+	QueryStats();
+	void dump();
+
+	boost::mutex m_lock;
+	std::map<std::string, Shape> m_shapes;
+	time_t m_since;
+};
+
+/** Names the code whose queries run inside its scope, shown by the slow
+  * query log. Only string literals, the name is kept as a pointer.
+  */
+class DBQueryOrigin
+{
+public:
+	DBQueryOrigin(const char* name);
+	~DBQueryOrigin();
+
+	static const char* current();
+
+private:
+	const char* m_previous;
+};
+
+/** Times one query until it goes out of scope */
+class DBQueryTimer
+{
+public:
+	DBQueryTimer(const char* query) : m_query(query), m_start(std::chrono::steady_clock::now()) {}
+	~DBQueryTimer();
+
+private:
+	const char* m_query;
+	std::chrono::steady_clock::time_point m_start;
+};
+
+#endif
@@ -0,0 +1,207 @@
+#include "otpch.h"
+
+#include "scriptprofiler.h"
+
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include "configmanager.h"
+#include "tools.h"
+
+extern ConfigManager g_config;
+
+// collapsed stacks use ';' between frames
+static std::string frameName(const std::string& name)
+{
+	std::string frame = name;
+	std::replace(frame.begin(), frame.end(), ';', ':');
+	return frame;
+}
+
+ScriptProfiler::ScriptProfiler() : m_enabled(false)
+{
+	m_since = std::time(nullptr);
+}
+
+void ScriptProfiler::setEnabled(bool enabled)
+{
+	m_enabled = enabled;
+}
+
+void ScriptProfiler::enter(lua_State* L, const std::string& interfaceName, const std::string& script)
+{
+	Frame frame;
+	frame.L = L;
+	frame.interfaceName = interfaceName;
+	frame.script = script;
+	if (!m_frames.empty()) {
+		frame.stack = m_frames.back().stack + ";";
+	}
+	frame.stack += frameName(interfaceName) + ";" + frameName(script);
+	frame.childMicros = 0;
+
+	int32_t sampleInterval = g_config.getNumber(ConfigManager::SCRIPT_PROFILER_SAMPLE_INTERVAL);
+	if (sampleInterval > 0) {
+		lua_sethook(L, &ScriptProfiler::sampleHook, LUA_MASKCOUNT, sampleInterval);
+	}
+
+	m_frames.push_back(frame);
+	m_frames.back().start = std::chrono::steady_clock::now();
+}
+
+void ScriptProfiler::leave()
+{
+	if (m_frames.empty()) {
+		return;
+	}
+
+	const Frame& frame = m_frames.back();
+	uint64_t micros = std::chrono::duration_cast<std::chrono::microseconds>(
+	                  std::chrono::steady_clock::now() - frame.start)
+	                  .count();
+	uint64_t selfMicros = micros - std::min(micros, frame.childMicros);
+
+	Totals& interfaceTotals = m_interfaces[frame.interfaceName];
+	++interfaceTotals.calls;
+	interfaceTotals.totalMicros += micros;
+	interfaceTotals.selfMicros += selfMicros;
+
+	Totals& scriptTotals = m_scripts[frame.interfaceName + ";" + frame.script];
+	++scriptTotals.calls;
+	scriptTotals.totalMicros += micros;
+	scriptTotals.selfMicros += selfMicros;
+
+	m_stackMicros[frame.stack] += selfMicros;
+
+	lua_State* L = frame.L;
+	m_frames.pop_back();
+
+	bool stateInUse = false;
+	for (std::vector<Frame>::const_iterator it = m_frames.begin(); it != m_frames.end(); ++it) {
+		if (it->L == L) {
+			stateInUse = true;
+			break;
+		}
+	}
+
+	if (!stateInUse) {
+		lua_sethook(L, nullptr, 0, 0);
+	}
+
+	if (!m_frames.empty()) {
+		m_frames.back().childMicros += micros;
+	}
+}
+
+void ScriptProfiler::sampleHook(lua_State* L, lua_Debug*)
+{
+	ScriptProfiler& profiler = getInstance();
+	if (profiler.m_frames.empty()) {
+		return;
+	}
+
+	// innermost function first
+	std::vector<std::string> functions;
+	lua_Debug ar;
+	for (int32_t level = 0; level < 32 && lua_getstack(L, level, &ar); ++level) {
+		if (!lua_getinfo(L, "Sn", &ar)) {
+			break;
+		}
+
+		std::ostringstream function;
+		if (ar.name) {
+			function << ar.name;
+		} else if (ar.what && strcmp(ar.what, "main") == 0) {
+			function << "main";
+		} else {
+			function << "?";
+		}
+		function << " (" << ar.short_src << ":" << ar.linedefined << ")";
+		functions.push_back(frameName(function.str()));
+	}
+
+	std::string stack = profiler.m_frames.back().stack;
+	for (std::vector<std::string>::reverse_iterator it = functions.rbegin(); it != functions.rend(); ++it) {
+		stack += ";" + *it;
+	}
+	++profiler.m_samples[stack];
+}
+
+void ScriptProfiler::write(std::ostream& os, uint32_t limit)
+{
+	char buffer[32];
+	formatDate(m_since, buffer);
+	os << "Script time since " << buffer << (m_enabled ? "" : " (stopped)") << ":\n";
+
+	os << std::fixed << std::setprecision(2);
+	for (std::map<std::string, Totals>::const_iterator it = m_interfaces.begin(); it != m_interfaces.end(); ++it) {
+		os << it->first << ": " << it->second.calls << " calls, " << (double)it->second.selfMicros / 1000
+		   << " ms\n";
+	}
+
+	typedef std::pair<std::string, Totals> ScriptEntry;
+	std::vector<ScriptEntry> scripts(m_scripts.begin(), m_scripts.end());
+	std::sort(scripts.begin(), scripts.end(), [](const ScriptEntry& a, const ScriptEntry& b) {
+		return a.second.selfMicros > b.second.selfMicros;
+	});
+
+	if (limit > 0 && scripts.size() > limit) {
+		scripts.resize(limit);
+	}
+
+	os << "Scripts by own time:\n";
+	for (std::vector<ScriptEntry>::const_iterator it = scripts.begin(); it != scripts.end(); ++it) {
+		const Totals& totals = it->second;
+		std::string name = it->first;
+		std::replace(name.begin(), name.end(), ';', ' ');
+		os << totals.calls << "x, own " << (double)totals.selfMicros / 1000 << " ms, total "
+		   << (double)totals.totalMicros / 1000 << " ms, avg " << (double)totals.totalMicros / totals.calls / 1000
+		   << " ms: " << name << "\n";
+	}
+}
+
+void ScriptProfiler::reset()
+{
+	m_interfaces.clear();
+	m_scripts.clear();
+	m_stackMicros.clear();
+	m_samples.clear();
+	m_since = std::time(nullptr);
+}
+
+bool ScriptProfiler::dump()
+{
+	const std::string& fileName = g_config.getString(ConfigManager::SCRIPT_PROFILER_FILE);
+
+	std::ofstream summary((fileName + ".txt").c_str(), std::ios::trunc);
+	std::ofstream folded((fileName + ".folded").c_str(), std::ios::trunc);
+	if (!summary.is_open() || !folded.is_open()) {
+		std::cout << "[Warning - ScriptProfiler::dump] Can not open " << fileName << ".txt or .folded"
+		          << std::endl;
+		return false;
+	}
+
+	write(summary, 0);
+	for (std::map<std::string, uint64_t>::const_iterator it = m_stackMicros.begin(); it != m_stackMicros.end(); ++it) {
+		folded << it->first << " " << it->second << "\n";
+	}
+
+	if (!m_samples.empty()) {
+		std::ofstream samples((fileName + ".samples.folded").c_str(), std::ios::trunc);
+		if (!samples.is_open()) {
+			std::cout << "[Warning - ScriptProfiler::dump] Can not open " << fileName << ".samples.folded"
+			          << std::endl;
+			return false;
+		}
+
+		for (std::map<std::string, uint64_t>::const_iterator it = m_samples.begin(); it != m_samples.end(); ++it) {
+			samples << it->first << " " << it->second << "\n";
+		}
+	}
+	return true;
+}
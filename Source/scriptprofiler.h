@@ -0,0 +1,108 @@
+//////////////////////////////////////////////////////////////////////
+// OpenTibia - an opensource roleplaying game
+//////////////////////////////////////////////////////////////////////
+// Time spent in each Lua script, for finding the expensive ones
+//////////////////////////////////////////////////////////////////////
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef __OTSERV_SCRIPTPROFILER_H__
+#define __OTSERV_SCRIPTPROFILER_H__
+
+#include "definitions.h"
+
+#include <chrono>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <lua.h>
+}
+
+/** Wall time of every script event LuaScriptInterface::callFunction runs,
+  * by interface and by script. Events called from inside others are kept
+  * as stacks, dump() writes them collapsed for flame graph tools. With
+  * ScriptProfilerSampleInterval the Lua stack is also sampled every that
+  * many instructions. Dispatcher thread only.
+  */
+class ScriptProfiler
+{
+public:
+	static ScriptProfiler& getInstance()
+	{
+		static ScriptProfiler instance;
+		return instance;
+	}
+
+	bool isEnabled() const
+	{
+		return m_enabled;
+	}
+	void setEnabled(bool enabled);
+
+	/** Around the call of an event
+	  * \param script the file and function getFileById gives
+	  */
+	void enter(lua_State* L, const std::string& interfaceName, const std::string& script);
+	void leave();
+
+	/** Interfaces and the scripts that took the most time themselves
+	  * \param limit how many scripts, 0 for all of them
+	  */
+	void write(std::ostream& os, uint32_t limit);
+	void reset();
+
+	/** Writes ScriptProfilerFile .txt, .folded (self time in us) and
+	  * .samples.folded (Lua stack samples, if any were taken)
+	  */
+	bool dump();
+
+protected:
+	ScriptProfiler();
+
+	static void sampleHook(lua_State* L, lua_Debug* ar);
+
+	struct Frame {
+		lua_State* L;
+		std::string interfaceName;
+		std::string script;
+		// frames of the enclosing events and this one, ';' separated
+		std::string stack;
+		std::chrono::steady_clock::time_point start;
+		uint64_t childMicros;
+	};
+
+	struct Totals {
+		Totals() : calls(0), totalMicros(0), selfMicros(0) {}
+
+		uint64_t calls;
+		uint64_t totalMicros;
+		uint64_t selfMicros;
+	};
+
+	bool m_enabled;
+	time_t m_since;
+	std::vector<Frame> m_frames;
+
+	std::map<std::string, Totals> m_interfaces;
+	// by interface name and script, ';' separated
+	std::map<std::string, Totals> m_scripts;
+	std::map<std::string, uint64_t> m_stackMicros;
+	std::map<std::string, uint64_t> m_samples;
+};
+
+#endif
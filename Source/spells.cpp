@@ -114,6 +114,67 @@ void Spells::clear()
 		delete it2->second;
 	}
 	instants.clear();
+	instantWords.clear();
+}
+
+void SpellWordTrie::clear()
+{
+	m_nodes.clear();
+	m_nodes.push_back(Node());
+}
+
+void SpellWordTrie::add(const std::string& words, InstantSpell* spell)
+{
+	uint32_t index = 0;
+	for (std::string::const_iterator it = words.begin(); it != words.end(); ++it) {
+		char ch = tolower((unsigned char)*it);
+
+		uint32_t next = 0;
+		for (size_t i = 0; i < m_nodes[index].children.size(); ++i) {
+			if (m_nodes[index].children[i].first == ch) {
+				next = m_nodes[index].children[i].second;
+				break;
+			}
+		}
+
+		if (next == 0) {
+			next = (uint32_t)m_nodes.size();
+			m_nodes[index].children.push_back(std::make_pair(ch, next));
+			m_nodes.push_back(Node());
+		}
+		index = next;
+	}
+
+	m_nodes[index].spell = spell;
+}
+
+InstantSpell* SpellWordTrie::findLongestPrefix(const std::string& text) const
+{
+	InstantSpell* result = nullptr;
+	uint32_t index = 0;
+	for (std::string::const_iterator it = text.begin(); it != text.end(); ++it) {
+		char ch = tolower((unsigned char)*it);
+
+		const Node& node = m_nodes[index];
+		index = 0;
+		for (size_t i = 0; i < node.children.size(); ++i) {
+			if (node.children[i].first == ch) {
+				index = node.children[i].second;
+				break;
+			}
+		}
+
+		if (index == 0) {
+			// no spell continues with this character
+			break;
+		}
+
+		if (m_nodes[index].spell) {
+			result = m_nodes[index].spell;
+		}
+	}
+
+	return result;
 }
 
 LuaScriptInterface& Spells::getScriptInterface()
@@ -149,6 +210,7 @@ bool Spells::registerEvent(Event* event, xmlNodePtr p)
 
 	if (instant) {
 		instants[instant->getWords()] = instant;
+		instantWords.add(instant->getWords(), instant);
 	} else if (rune) {
 		runes[rune->getRuneItemId()] = rune;
 	} else {
@@ -196,19 +258,7 @@ RuneSpell* Spells::getRuneSpellByName(const std::string& name)
 
 InstantSpell* Spells::getInstantSpell(const std::string words)
 {
-	InstantSpell* result = nullptr;
-	for (InstantsMap::iterator it = instants.begin(); it != instants.end(); ++it) {
-		InstantSpell* instantSpell = it->second;
-		size_t spellLen = instantSpell->getWords().length();
-
-		if (asLowerCaseString(words).compare(0, spellLen,
-		                                     asLowerCaseString(instantSpell->getWords())) == 0) {
-			if (!result || spellLen > result->getWords().length()) {
-				result = instantSpell;
-			}
-		}
-	}
-
+	InstantSpell* result = instantWords.findLongestPrefix(words);
 	if (result) {
 		if (words.length() > result->getWords().length()) {
 			size_t spellLen = result->getWords().length();
@@ -17,6 +17,34 @@ class Spell;
 typedef std::map<uint32_t, RuneSpell*> RunesMap;
 typedef std::map<std::string, InstantSpell*> InstantsMap;
 
+/** Words of the instant spells folded to lower case, finds the longest
+  * words a text starts with without copying it
+  */
+class SpellWordTrie
+{
+public:
+	SpellWordTrie()
+	{
+		clear();
+	}
+
+	void clear();
+	/** Words added again replace the spell they had */
+	void add(const std::string& words, InstantSpell* spell);
+	InstantSpell* findLongestPrefix(const std::string& text) const;
+
+protected:
+	struct Node {
+		Node() : spell(nullptr) {}
+
+		std::vector<std::pair<char, uint32_t>> children;
+		InstantSpell* spell;
+	};
+
+	// the root is the first one
+	std::vector<Node> m_nodes;
+};
+
 class Spells : public BaseEvents
 {
 public:
@@ -49,6 +77,7 @@ protected:
 
 	RunesMap runes;
 	InstantsMap instants;
+	SpellWordTrie instantWords;
 
 	friend class CombatSpell;
 	LuaScriptInterface m_scriptInterface;
@@ -24,6 +24,7 @@
 #include "game.h"
 #include "networkmessage.h"
 #include "outputmessage.h"
+#include "playerdirectory.h"
 #include "status.h"
 #include "tools.h"
 #include <libxml/parser.h>
@@ -76,7 +77,7 @@ void ProtocolStatus::onRecvFirstMessage(NetworkMessage& msg)
 			if (output) {
 				TRACK_MESSAGE(output);
 				Status* status = Status::instance();
-				std::string str = status->getStatusString();
+				const std::string& str = status->getStatusString();
 				output->AddBytes(str.c_str(), str.size());
 				setRawMessages(
 				true); // we dont want the size header, nor encryption
@@ -119,6 +120,14 @@ Status::Status()
 	m_playersmax = 0;
 	m_playerspeak = 0;
 	m_start = OTSYS_TIME();
+
+	m_statusTime = 0;
+	m_statusPlayers = 0;
+	m_infoTime = 0;
+	m_infoPlayers = 0;
+	for (int i = 0; i < INFO_BLOCKS; ++i) {
+		m_infoValid[i] = false;
+	}
 }
 
 void Status::addPlayer()
@@ -134,7 +143,28 @@ void Status::removePlayer()
 	m_playersonline--;
 }
 
-std::string Status::getStatusString() const
+bool Status::isCacheStale(int64_t renderTime, int renderPlayers) const
+{
+	if (OTSYS_TIME() >= renderTime + g_config.getNumber(ConfigManager::STATUS_CACHE_TIME)) {
+		return true;
+	}
+
+	return std::abs(m_playersonline - renderPlayers) >=
+	       g_config.getNumber(ConfigManager::STATUS_CACHE_PLAYERS);
+}
+
+const std::string& Status::getStatusString()
+{
+	if (m_statusString.empty() || isCacheStale(m_statusTime, m_statusPlayers)) {
+		m_statusString = buildStatusString();
+		m_statusTime = OTSYS_TIME();
+		m_statusPlayers = m_playersonline;
+	}
+
+	return m_statusString;
+}
+
+std::string Status::buildStatusString() const
 {
 	std::string xml;
 
@@ -230,34 +260,63 @@ std::string Status::getStatusString() const
 	return xml;
 }
 
-void Status::getInfo(uint32_t requestedInfo, OutputMessage_ptr output, NetworkMessage& msg) const
+void Status::getInfo(uint32_t requestedInfo, OutputMessage_ptr output, NetworkMessage& msg)
 {
-	// the client selects which information may be
-	// sent back, so we'll save some bandwidth and
-	// make many
-	std::stringstream ss;
-	uint64_t running = getUptime();
-	// since we haven't all the things on the right place like map's
-	// creator/info and other things, i'll put the info chunked into
-	// operators, so the httpd server will only receive the existing
-	// properties of the server, such serverinfo, playersinfo and so
+	if (isCacheStale(m_infoTime, m_infoPlayers)) {
+		for (int i = 0; i < INFO_BLOCKS; ++i) {
+			m_infoValid[i] = false;
+		}
+		m_infoTime = OTSYS_TIME();
+		m_infoPlayers = m_playersonline;
+	}
+
+	// blocks go out in bit order, each one is rendered once and then copied
+	for (int i = 0; i < INFO_BLOCKS; ++i) {
+		uint32_t block = 1 << i;
+		if (!(requestedInfo & block)) {
+			continue;
+		}
 
-	if (requestedInfo & REQUEST_BASIC_SERVER_INFO) {
+		if (block == REQUEST_PLAYER_STATUS_INFO) {
+			// depends on the name that was asked for
+			addInfo(block, output, msg);
+		} else if (!m_infoValid[i]) {
+			int32_t start = output->getReadPos();
+			addInfo(block, output, msg);
+			m_infoBlocks[i].assign(output->getBuffer() + start, output->getReadPos() - start);
+			m_infoValid[i] = true;
+		} else {
+			// AddBytes takes at most 8192 bytes at once
+			const std::string& bytes = m_infoBlocks[i];
+			for (size_t pos = 0; pos < bytes.size(); pos += 8192) {
+				output->AddBytes(bytes.data() + pos, std::min<size_t>(bytes.size() - pos, 8192));
+			}
+		}
+	}
+}
+
+void Status::addInfo(uint32_t block, OutputMessage_ptr output, NetworkMessage& msg) const
+{
+	switch (block) {
+	case REQUEST_BASIC_SERVER_INFO: {
 		output->AddByte(0x10); // server info
 		output->AddString(g_config.getString(ConfigManager::SERVER_NAME).c_str());
 		output->AddString(g_config.getString(ConfigManager::IP).c_str());
+		std::stringstream ss;
 		ss << g_config.getNumber(ConfigManager::PORT);
 		output->AddString(ss.str().c_str());
-		ss.str("");
+		break;
 	}
 
-	if (requestedInfo & REQUEST_OWNER_SERVER_INFO) {
+	case REQUEST_OWNER_SERVER_INFO: {
 		output->AddByte(0x11); // server info - owner info
 		output->AddString(g_config.getString(ConfigManager::OWNER_NAME).c_str());
 		output->AddString(g_config.getString(ConfigManager::OWNER_EMAIL).c_str());
+		break;
 	}
 
-	if (requestedInfo & REQUEST_MISC_SERVER_INFO) {
+	case REQUEST_MISC_SERVER_INFO: {
+		uint64_t running = getUptime();
 		output->AddByte(0x12); // server info - misc
 		output->AddString(g_config.getString(ConfigManager::MOTD).c_str());
 		output->AddString(g_config.getString(ConfigManager::LOCATION).c_str());
@@ -266,16 +325,18 @@ void Status::getInfo(uint32_t requestedInfo, OutputMessage_ptr output, NetworkMe
 		(uint32_t)(running >> 32)); // this method prevents a big number parsing
 		output->AddU32((uint32_t)(running)); // since servers can be online for months ;)
 		output->AddString(OTSERV_VERSION);
+		break;
 	}
 
-	if (requestedInfo & REQUEST_PLAYERS_INFO) {
+	case REQUEST_PLAYERS_INFO: {
 		output->AddByte(0x20); // players info
 		output->AddU32(m_playersonline);
 		output->AddU32(m_playersmax);
 		output->AddU32(m_playerspeak);
+		break;
 	}
 
-	if (requestedInfo & REQUEST_MAP_INFO) {
+	case REQUEST_MAP_INFO: {
 		output->AddByte(0x30); // map info
 		output->AddString(m_mapname.c_str());
 		output->AddString(m_mapauthor.c_str());
@@ -283,9 +344,10 @@ void Status::getInfo(uint32_t requestedInfo, OutputMessage_ptr output, NetworkMe
 		g_game.getMapDimensions(mapWidth, mapHeight);
 		output->AddU16(mapWidth);
 		output->AddU16(mapHeight);
+		break;
 	}
 
-	if (requestedInfo & REQUEST_EXT_PLAYERS_INFO) {
+	case REQUEST_EXT_PLAYERS_INFO: {
 		output->AddByte(0x21); // players info - online players list
 		output->AddU32(m_playersonline);
 		for (AutoList<Player>::listiterator it = Player::listPlayer.list.begin();
@@ -294,26 +356,32 @@ void Status::getInfo(uint32_t requestedInfo, OutputMessage_ptr output, NetworkMe
 			output->AddString(it->second->getName());
 			output->AddU32(it->second->getLevel());
 		}
+		break;
 	}
 
-	if (requestedInfo & REQUEST_PLAYER_STATUS_INFO) {
+	case REQUEST_PLAYER_STATUS_INFO: {
 		output->AddByte(0x22); // players info - online status info of a player
 		const std::string name = msg.GetString();
-		if (g_game.getPlayerByName(name) != nullptr) {
+		// network thread, the player itself must not be touched here
+		if (PlayerDirectory::getInstance().isOnline(name)) {
 			output->AddByte(0x01);
 		} else {
 			output->AddByte(0x00);
 		}
+		break;
 	}
 
-	if (requestedInfo & REQUEST_SERVER_SOFTWARE_INFORMATION) {
+	case REQUEST_SERVER_SOFTWARE_INFORMATION: {
 		output->AddByte(0x23); // server software info
 		output->AddString(OTSERV_NAME);
 		output->AddString(OTSERV_VERSION);
 		output->AddString(OTSERV_CLIENT_VERSION);
+		break;
 	}
 
-	return;
+	default:
+		break;
+	}
 }
 
 bool Status::hasSlot() const
@@ -72,8 +72,11 @@ public:
 	void removePlayer();
 	bool hasSlot() const;
 
-	std::string getStatusString() const;
-	void getInfo(uint32_t requestedInfo, OutputMessage_ptr output, NetworkMessage& msg) const;
+	// Both answers are served from a copy rendered at most StatusCacheTime
+	// ago, or before the online count moved by StatusCachePlayers.
+	// Only called from the network thread.
+	const std::string& getStatusString();
+	void getInfo(uint32_t requestedInfo, OutputMessage_ptr output, NetworkMessage& msg);
 
 	uint32_t getPlayersOnline() const
 	{
@@ -94,7 +97,22 @@ public:
 protected:
 	Status();
 
+	enum { INFO_BLOCKS = 8 };
+
+	bool isCacheStale(int64_t renderTime, int renderPlayers) const;
+	std::string buildStatusString() const;
+	void addInfo(uint32_t block, OutputMessage_ptr output, NetworkMessage& msg) const;
+
 private:
+	std::string m_statusString;
+	int64_t m_statusTime;
+	int m_statusPlayers;
+
+	std::string m_infoBlocks[INFO_BLOCKS];
+	bool m_infoValid[INFO_BLOCKS];
+	int64_t m_infoTime;
+	int m_infoPlayers;
+
 	uint64_t m_start;
 	int m_playersmax, m_playersonline, m_playerspeak;
 	std::string m_mapname, m_mapauthor;
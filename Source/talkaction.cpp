@@ -32,7 +32,8 @@
 
 extern Game g_game;
 
-TalkActions::TalkActions() : m_scriptInterface("TalkAction Interface")
+TalkActions::TalkActions()
+: maxQuotationLength(0), maxFirstWordLength(0), m_scriptInterface("TalkAction Interface")
 {
 	m_scriptInterface.initState();
 }
@@ -51,6 +52,11 @@ void TalkActions::clear()
 		it = wordsMap.begin();
 	}
 
+	quotationIndex.clear();
+	firstWordIndex.clear();
+	maxQuotationLength = 0;
+	maxFirstWordLength = 0;
+
 	m_scriptInterface.reInitState();
 }
 
@@ -80,89 +86,141 @@ bool TalkActions::registerEvent(Event* event, xmlNodePtr p)
 		return false;
 	}
 
+	IndexedTalkAction entry;
+	entry.order = (uint32_t)wordsMap.size();
+	entry.talkAction = talkAction;
 	wordsMap.push_back(std::make_pair(talkAction->getWords(), talkAction));
+
+	const std::string& words = wordsMap.back().first;
+	uint32_t hash = hashWords(words.data(), words.length());
+	if (talkAction->getFilterType() == TALKACTION_MATCH_QUOTATION) {
+		quotationIndex[hash].push_back(entry);
+		maxQuotationLength = std::max(maxQuotationLength, words.length());
+	} else if (talkAction->getFilterType() == TALKACTION_MATCH_FIRST_WORD) {
+		firstWordIndex[hash].push_back(entry);
+		maxFirstWordLength = std::max(maxFirstWordLength, words.length());
+	}
+	return true;
+}
+
+uint32_t TalkActions::hashWords(const char* words, size_t length)
+{
+	// FNV-1a of the lower case text
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < length; ++i) {
+		hash ^= (uint8_t)tolower((unsigned char)words[i]);
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+bool TalkActions::matchWords(const TalkAction* talkAction, const char* words, size_t length)
+{
+	const std::string& commandString = talkAction->getWords();
+	if (commandString.length() != length) {
+		return false;
+	}
+
+	if (commandString.compare(0, length, words, length) == 0) {
+		return true;
+	}
+
+	if (talkAction->isCaseSensitive()) {
+		return false;
+	}
+
+	for (size_t i = 0; i < length; ++i) {
+		if (tolower((unsigned char)commandString[i]) != tolower((unsigned char)words[i])) {
+			return false;
+		}
+	}
 	return true;
 }
 
+void TalkActions::findTalkAction(const TalkActionIndex& index, const char* words, size_t length,
+                                 const IndexedTalkAction*& found)
+{
+	TalkActionIndex::const_iterator it = index.find(hashWords(words, length));
+	if (it == index.end()) {
+		return;
+	}
+
+	for (std::vector<IndexedTalkAction>::const_iterator eit = it->second.begin(); eit != it->second.end(); ++eit) {
+		if ((!found || eit->order < found->order) && matchWords(eit->talkAction, words, length)) {
+			found = &(*eit);
+		}
+	}
+}
+
 TalkActionResult_t TalkActions::onPlayerSpeak(Player* player, SpeakClasses type, const std::string& words)
 {
 	if (type != SPEAK_SAY) {
 		return TALKACTION_CONTINUE;
 	}
 
-	std::string str_words_quote;
-	std::string str_param_quote;
-	std::string str_words_first_word;
-	std::string str_param_first_word;
+	// both filters only look at the text before the first quote or space,
+	// nothing is copied unless a talkaction matches
+	size_t quoteLoc = words.find('"', 0);
+	size_t quoteEnd = (quoteLoc != std::string::npos ? quoteLoc : words.size());
+	size_t quoteStart = 0;
+	while (quoteStart < quoteEnd && words[quoteStart] == ' ') {
+		++quoteStart;
+	}
 
-	// With quotation filtering
-	size_t loc = words.find('"', 0);
-	if (loc != std::string::npos && loc >= 0) {
-		str_words_quote = std::string(words, 0, loc);
-		str_param_quote = std::string(words, (loc + 1), words.size() - loc - 1);
-	} else {
-		str_words_quote = words;
-		str_param_quote = std::string("");
+	size_t spaceLoc = words.find(' ', 0);
+	size_t firstWordEnd = (spaceLoc != std::string::npos ? spaceLoc : words.size());
+
+	const IndexedTalkAction* found = nullptr;
+	if (quoteEnd - quoteStart <= maxQuotationLength) {
+		findTalkAction(quotationIndex, words.data() + quoteStart, quoteEnd - quoteStart, found);
+	}
+	if (firstWordEnd <= maxFirstWordLength) {
+		findTalkAction(firstWordIndex, words.data(), firstWordEnd, found);
 	}
 
-	trim_left(str_words_quote, " ");
-	trim_right(str_param_quote, " ");
+	if (!found) {
+		return TALKACTION_CONTINUE;
+	}
 
-	// With whitespace filtering
-	loc = words.find(' ', 0);
-	if (loc != std::string::npos && loc >= 0) {
-		str_words_first_word = std::string(words, 0, loc);
-		str_param_first_word = std::string(words, (loc + 1), words.size() - loc - 1);
+	TalkAction* talkAction = found->talkAction;
+	std::string cmdstring;
+	std::string paramstring;
+	if (talkAction->getFilterType() == TALKACTION_MATCH_QUOTATION) {
+		cmdstring = words.substr(quoteStart, quoteEnd - quoteStart);
+		if (quoteLoc != std::string::npos) {
+			paramstring = words.substr(quoteLoc + 1);
+			trim_right(paramstring, " ");
+		}
 	} else {
-		str_words_first_word = words;
-		str_param_first_word = std::string("");
-	}
-
-	TalkActionList::iterator it;
-	for (it = wordsMap.begin(); it != wordsMap.end(); ++it) {
-		std::string cmdstring;
-		std::string paramstring;
-		if (it->second->getFilterType() == TALKACTION_MATCH_QUOTATION) {
-			cmdstring = str_words_quote;
-			paramstring = str_param_quote;
-		} else if (it->second->getFilterType() == TALKACTION_MATCH_FIRST_WORD) {
-			cmdstring = str_words_first_word;
-			paramstring = str_param_first_word;
-		} else {
-			continue;
+		cmdstring = words.substr(0, firstWordEnd);
+		if (spaceLoc != std::string::npos) {
+			paramstring = words.substr(spaceLoc + 1);
 		}
-		if (cmdstring == it->first ||
-		    (!it->second->isCaseSensitive() && boost::algorithm::iequals(it->first, cmdstring))) {
-			bool ret = true;
-			if (player->getAccessLevel() < it->second->getAccessLevel()) {
-				if (player->getAccessLevel() > 0) {
-					player->sendTextMessage(
-					MSG_STATUS_SMALL, "You can not execute this command.");
-					ret = false;
-				}
-			} else {
-				TalkAction* talkAction = it->second;
-
-				if (talkAction->isScripted()) {
-					ret = talkAction->executeSay(player, cmdstring, paramstring);
-				} else {
-					TalkActionFunction* func = talkAction->getFunction();
-					if (func) {
-						func(player, cmdstring, paramstring);
-						ret = false;
-					}
-				}
-			}
+	}
 
-			if (ret) {
-				return TALKACTION_CONTINUE;
-			} else {
-				return TALKACTION_BREAK;
+	bool ret = true;
+	if (player->getAccessLevel() < talkAction->getAccessLevel()) {
+		if (player->getAccessLevel() > 0) {
+			player->sendTextMessage(MSG_STATUS_SMALL, "You can not execute this command.");
+			ret = false;
+		}
+	} else {
+		if (talkAction->isScripted()) {
+			ret = talkAction->executeSay(player, cmdstring, paramstring);
+		} else {
+			TalkActionFunction* func = talkAction->getFunction();
+			if (func) {
+				func(player, cmdstring, paramstring);
+				ret = false;
 			}
 		}
 	}
 
-	return TALKACTION_CONTINUE;
+	if (ret) {
+		return TALKACTION_CONTINUE;
+	} else {
+		return TALKACTION_BREAK;
+	}
 }
 
 
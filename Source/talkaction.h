@@ -29,6 +29,7 @@
 
 #include <list>
 #include <string>
+#include <vector>
 
 enum TalkActionResult_t {
 	// TALKACTION_NOTFOUND,
@@ -62,6 +63,25 @@ protected:
 	typedef std::list<std::pair<std::string, TalkAction*>> TalkActionList;
 	TalkActionList wordsMap;
 
+	struct IndexedTalkAction {
+		// position in wordsMap, the first registered one wins
+		uint32_t order;
+		TalkAction* talkAction;
+	};
+
+	// by hash of the lower case words, one index per filter type
+	typedef std::unordered_map<uint32_t, std::vector<IndexedTalkAction>> TalkActionIndex;
+	TalkActionIndex quotationIndex;
+	TalkActionIndex firstWordIndex;
+	// longer text can not match, saves hashing whole chat lines
+	size_t maxQuotationLength;
+	size_t maxFirstWordLength;
+
+	static uint32_t hashWords(const char* words, size_t length);
+	static bool matchWords(const TalkAction* talkAction, const char* words, size_t length);
+	static void findTalkAction(const TalkActionIndex& index, const char* words, size_t length,
+	                           const IndexedTalkAction*& found);
+
 	LuaScriptInterface m_scriptInterface;
 };
 
@@ -0,0 +1,232 @@
+#!/bin/sh
+# Runs the database pool against a local MySQL or MariaDB server and checks
+# that worker threads check out their own connections, that a thread gives
+# up waiting after SQL_PoolWait and shares the game thread's connection, and
+# that idle connections outlive wait_timeout and come back after being killed.
+#
+# Usage: Tools/pooltest/pooltest.sh <otserv> <stressclient>
+#
+# otserv must be built with MySQL support. The scratch database, the copy of
+# data/ and the logs are kept in $WORK. Environment:
+#   MYSQL    client command with a user allowed to create databases, to see
+#            every connection and to set global variables (mysql -uroot)
+#   SQL_USER, SQL_PASS  what the server logs in with (root, empty)
+#   DB       scratch database, dropped and created again (otserv_pooltest)
+#   WORK     working directory (/tmp/otserv-pooltest)
+
+set -u
+
+OTSERV=${1:?usage: $0 <otserv> <stressclient>}
+STRESS=${2:?usage: $0 <otserv> <stressclient>}
+MYSQL=${MYSQL:-mysql -uroot}
+SQL_USER=${SQL_USER:-root}
+SQL_PASS=${SQL_PASS:-}
+DB=${DB:-otserv_pooltest}
+WORK=${WORK:-/tmp/otserv-pooltest}
+ROOT=$(cd "$(dirname "$0")/../.." && pwd)
+
+BOTS=50
+FIRST_ACCOUNT=900000
+WAIT_TIMEOUT=8
+
+failures=0
+server=
+
+pass()
+{
+	echo "PASS: $*"
+}
+
+fail()
+{
+	echo "FAIL: $*"
+	failures=$((failures + 1))
+}
+
+sql()
+{
+	$MYSQL -N -B -e "$1"
+}
+
+# ids of the connections the server holds, one per line
+connections()
+{
+	sql "SELECT id FROM information_schema.processlist WHERE db = '$DB' ORDER BY id"
+}
+
+# lines of stdin that are not lines of $1
+without()
+{
+	awk -v skip="$1" 'BEGIN { n = split(skip, lines, "\n"); for (i = 1; i <= n; ++i) seen[lines[i]] = 1 } !($0 in seen)'
+}
+
+start_server()
+{
+	# later assignments in config.lua win
+	cp "$ROOT/config.lua" "$WORK/config.lua"
+	cat >> "$WORK/config.lua" <<EOF
+SQL_Type = "mysql"
+SQL_Host = "127.0.0.1"
+SQL_User = "$SQL_USER"
+SQL_Pass = "$SQL_PASS"
+SQL_DB = "$DB"
+LoginTries = 0
+MaxPlayers = 1000
+$1
+EOF
+	(cd "$WORK" && exec "$OTSERV") > "$WORK/$2.log" 2>&1 &
+	server=$!
+
+	tries=0
+	until grep -q "Starting Server" "$WORK/$2.log"; do
+		tries=$((tries + 1))
+		if [ $tries -gt 120 ] || ! kill -0 $server 2>/dev/null; then
+			echo "The server did not start, see $WORK/$2.log"
+			stop_server
+			exit 1
+		fi
+		sleep 1
+	done
+	sleep 2
+}
+
+stop_server()
+{
+	if [ -n "$server" ]; then
+		kill $server 2>/dev/null
+		wait $server 2>/dev/null
+		server=
+	fi
+}
+
+# runs the bots, prints the login failures of the totals
+run_bots()
+{
+	"$STRESS" --bots $BOTS --first-account $FIRST_ACCOUNT --password pooltest --ramp $BOTS \
+		--duration "$1" --report 3600 > "$WORK/bots.log" 2>&1
+	tail -n 1 "$WORK/bots.log" | sed -n 's/.*login failures \([0-9]*\).*/\1/p'
+}
+
+logins()
+{
+	tail -n 1 "$WORK/bots.log" | sed -n 's/.*logins \([0-9]*\),.*/\1/p'
+}
+
+trap 'stop_server' EXIT INT TERM
+
+mkdir -p "$WORK"
+rm -rf "$WORK/data"
+cp -R "$ROOT/data" "$WORK/data"
+
+echo "Creating $DB"
+sql "DROP DATABASE IF EXISTS \`$DB\`; CREATE DATABASE \`$DB\`" || exit 1
+$MYSQL "$DB" < "$ROOT/SQL/schema.mysql" || exit 1
+# the stress client prints SQLite, its double quoted names need ANSI_QUOTES
+"$STRESS" --make-accounts --bots $BOTS --first-account $FIRST_ACCOUNT --password pooltest |
+	sed 's/^INSERT OR REPLACE/REPLACE/' |
+	$MYSQL --init-command="SET SESSION sql_mode = 'ANSI_QUOTES'" "$DB" || exit 1
+
+# 1. Checkout per thread: four workers, a pool of four, the server never
+# holds more than the pool and the game thread's own connection
+echo "Checkout per thread"
+start_server "DatabaseWorkers = 4
+SQL_PoolSize = 4
+SQL_PoolWait = 1000
+SQL_PoolKeepAlive = 0" checkout
+most=0
+(
+	while kill -0 $server 2>/dev/null; do
+		connections | wc -l
+		sleep 0.2
+	done
+) > "$WORK/checkout.counts" &
+sampler=$!
+failed=$(run_bots 20)
+stop_server
+wait $sampler 2>/dev/null
+most=$(sort -n "$WORK/checkout.counts" | tail -n 1)
+
+if [ "${failed:-x}" = 0 ] && [ "$(logins)" -ge $BOTS ]; then
+	pass "all $BOTS bots logged in"
+else
+	fail "login failures: ${failed:-none reported}, see $WORK/bots.log"
+fi
+if [ "${most:-0}" -ge 2 ] && [ "$most" -le 5 ]; then
+	pass "at most $most connections open, the workers used their own"
+else
+	fail "$most connections open, expected 2 to 5"
+fi
+
+# 2. Bounded wait: four workers share a pool of one, the ones that wait
+# longer than SQL_PoolWait fall back to the game thread's connection and the
+# logins still go through
+echo "Bounded wait"
+start_server "DatabaseWorkers = 4
+SQL_PoolSize = 1
+SQL_PoolWait = 1
+SQL_PoolKeepAlive = 0" wait
+failed=$(run_bots 20)
+stop_server
+
+if grep -q "connections stayed busy for 1 ms" "$WORK/wait.log"; then
+	pass "workers gave up waiting for the pool"
+else
+	fail "no worker gave up waiting, see $WORK/wait.log"
+fi
+if [ "${failed:-x}" = 0 ] && [ "$(logins)" -ge $BOTS ]; then
+	pass "all $BOTS bots logged in on the fallback connection"
+else
+	fail "login failures: ${failed:-none reported}, see $WORK/bots.log"
+fi
+
+# 3. Keepalive: with wait_timeout shorter than the idle time the pings keep
+# the pooled connections open, a killed one is reconnected by the next ping.
+# The game thread's own connection is not pooled, it reconnects on its next
+# query, so it is left out.
+echo "Keepalive"
+old_timeout=$(sql "SELECT @@GLOBAL.wait_timeout")
+# only connections opened after this get the short timeout
+sql "SET GLOBAL wait_timeout = $WAIT_TIMEOUT" || exit 1
+start_server "DatabaseWorkers = 2
+SQL_PoolSize = 2
+SQL_PoolWait = 1000
+SQL_PoolKeepAlive = 2" keepalive
+game=$(connections)
+run_bots 5 > /dev/null
+pooled=$(connections | without "$game")
+sleep $((WAIT_TIMEOUT * 3))
+after=$(connections)
+
+if [ -n "$pooled" ] && [ -z "$(echo "$pooled" | without "$after")" ]; then
+	pass "pooled connections outlived wait_timeout"
+else
+	fail "pooled connections: $(echo $pooled), after $((WAIT_TIMEOUT * 3)) s idle: $(echo $after)"
+fi
+
+for id in $pooled; do
+	sql "KILL $id"
+done
+# a ping every SQL_PoolKeepAlive seconds, for connections idle that long
+sleep 8
+revived=$(connections | without "$game" | without "$pooled")
+if [ "$(echo "$revived" | grep -c .)" -ge "$(echo "$pooled" | grep -c .)" ]; then
+	pass "killed connections reconnected without any client activity"
+else
+	fail "pooled connections after the kill: $(echo $revived)"
+fi
+
+failed=$(run_bots 5)
+stop_server
+sql "SET GLOBAL wait_timeout = $old_timeout"
+
+if [ "${failed:-x}" = 0 ] && [ "$(logins)" -ge $BOTS ]; then
+	pass "all $BOTS bots logged in after the reconnect"
+else
+	fail "login failures: ${failed:-none reported}, see $WORK/bots.log"
+fi
+
+if [ $failures -gt 0 ]; then
+	echo "$failures checks failed"
+	exit 1
+fi
+echo "All checks passed"
@@ -0,0 +1,832 @@
+//////////////////////////////////////////////////////////////////////
+// OpenTibia - an opensource roleplaying game
+//////////////////////////////////////////////////////////////////////
+// Headless 7.4 client that logs in many scripted bots against a local
+// server and reports how long the server takes to answer their actions.
+//////////////////////////////////////////////////////////////////////
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <boost/bind.hpp>
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/shared_ptr.hpp>
+
+typedef std::chrono::steady_clock Clock;
+
+enum ActionType { ACTION_WALK, ACTION_SAY, ACTION_ATTACK, ACTION_USE, ACTION_LAST };
+
+static const char* actionNames[ACTION_LAST] = {"walk", "say", "attack", "use"};
+
+struct Options {
+	std::string host = "127.0.0.1";
+	uint16_t port = 7171;
+	uint16_t version = 740;
+	uint32_t bots = 100;
+	uint32_t firstAccount = 100000;
+	std::string password = "stress";
+	uint32_t ramp = 50;         // logins started per second
+	uint32_t duration = 60;     // seconds
+	uint32_t interval = 1000;   // ms between actions of a bot
+	uint32_t report = 10;       // seconds between reports
+	uint32_t weights[ACTION_LAST] = {60, 20, 10, 10};
+	uint16_t useSprite = 1988;  // backpack
+};
+
+static Options g_options;
+static boost::asio::io_service g_ioService;
+static std::mt19937 g_random(std::random_device{}());
+
+static uint32_t randomRange(uint32_t min, uint32_t max)
+{
+	return std::uniform_int_distribution<uint32_t>(min, max)(g_random);
+}
+
+//////////////////////////////////////////////////////////////////////
+// Outgoing packets, little endian with a two byte length header
+
+class PacketWriter
+{
+public:
+	void begin()
+	{
+		m_start = m_data.size();
+		m_data.resize(m_start + 2);
+	}
+	void end()
+	{
+		const size_t size = m_data.size() - m_start - 2;
+		m_data[m_start] = size & 0xFF;
+		m_data[m_start + 1] = (size >> 8) & 0xFF;
+	}
+
+	void addByte(uint8_t value)
+	{
+		m_data.push_back(value);
+	}
+	void addU16(uint16_t value)
+	{
+		addByte(value & 0xFF);
+		addByte(value >> 8);
+	}
+	void addU32(uint32_t value)
+	{
+		addU16(value & 0xFFFF);
+		addU16(value >> 16);
+	}
+	void addString(const std::string& value)
+	{
+		addU16(value.size());
+		m_data.insert(m_data.end(), value.begin(), value.end());
+	}
+	void addPosition(uint16_t x, uint16_t y, uint8_t z)
+	{
+		addU16(x);
+		addU16(y);
+		addByte(z);
+	}
+
+	bool empty() const
+	{
+		return m_data.empty();
+	}
+	std::vector<uint8_t>& data()
+	{
+		return m_data;
+	}
+
+private:
+	std::vector<uint8_t> m_data;
+	size_t m_start = 0;
+};
+
+class PacketReader
+{
+public:
+	PacketReader(const uint8_t* data, size_t size) : m_data(data), m_size(size)
+	{
+	}
+
+	bool overrun() const
+	{
+		return m_overrun;
+	}
+	size_t left() const
+	{
+		return m_overrun ? 0 : m_size - m_pos;
+	}
+
+	uint8_t getByte()
+	{
+		if (!expect(1)) {
+			return 0;
+		}
+		return m_data[m_pos++];
+	}
+	uint16_t getU16()
+	{
+		if (!expect(2)) {
+			return 0;
+		}
+		uint16_t v = m_data[m_pos] | m_data[m_pos + 1] << 8;
+		m_pos += 2;
+		return v;
+	}
+	uint32_t getU32()
+	{
+		uint32_t v = getU16();
+		return v | (uint32_t)getU16() << 16;
+	}
+	std::string getString()
+	{
+		uint16_t size = getU16();
+		if (!expect(size)) {
+			return std::string();
+		}
+		std::string v((const char*)m_data + m_pos, size);
+		m_pos += size;
+		return v;
+	}
+
+private:
+	bool expect(size_t size)
+	{
+		if (m_overrun || size > m_size - m_pos) {
+			m_overrun = true;
+			return false;
+		}
+		return true;
+	}
+
+	const uint8_t* m_data;
+	size_t m_size;
+	size_t m_pos = 0;
+	bool m_overrun = false;
+};
+
+//////////////////////////////////////////////////////////////////////
+// Latency samples per action, collected per report interval
+
+class Stats
+{
+public:
+	void addSample(ActionType type, uint32_t usec)
+	{
+		m_interval[type].push_back(usec);
+		m_total[type].push_back(usec);
+	}
+
+	uint32_t logins = 0;
+	uint32_t loginFailures = 0;
+	uint32_t disconnects = 0;
+	uint32_t lostEchoes = 0;
+	uint32_t online = 0;
+
+	void report(double elapsed, bool final)
+	{
+		std::cout << std::fixed << std::setprecision(1);
+		std::cout << "[" << elapsed << "s] online " << online << ", logins " << logins << ", login failures "
+		          << loginFailures << ", disconnects " << disconnects << ", lost echoes " << lostEchoes
+		          << std::endl;
+
+		std::vector<uint32_t>* samples = final ? m_total : m_interval;
+		for (int i = 0; i < ACTION_LAST; ++i) {
+			std::vector<uint32_t>& s = samples[i];
+			if (s.empty()) {
+				continue;
+			}
+
+			std::sort(s.begin(), s.end());
+			std::cout << "\t" << std::left << std::setw(7) << actionNames[i] << std::right << " n "
+			          << std::setw(8) << s.size() << "  p50 " << std::setw(7) << percentile(s, 50)
+			          << "  p90 " << std::setw(7) << percentile(s, 90) << "  p99 " << std::setw(7)
+			          << percentile(s, 99) << "  max " << std::setw(7) << s.back() / 1000.0 << " ms"
+			          << std::endl;
+		}
+
+		for (int i = 0; i < ACTION_LAST; ++i) {
+			m_interval[i].clear();
+		}
+	}
+
+private:
+	static double percentile(const std::vector<uint32_t>& sorted, uint32_t p)
+	{
+		return sorted[(sorted.size() - 1) * p / 100] / 1000.0;
+	}
+
+	std::vector<uint32_t> m_interval[ACTION_LAST];
+	std::vector<uint32_t> m_total[ACTION_LAST];
+};
+
+static Stats g_stats;
+static std::vector<uint32_t> g_onlineIds;
+
+//////////////////////////////////////////////////////////////////////
+// A single scripted client: login server, then game server, then a
+// loop of random actions. Every action is followed by a say packet
+// carrying a unique token; the server handles a player's packets in
+// order, so the time until the token is echoed back is the latency of
+// the action.
+
+class Bot : public boost::enable_shared_from_this<Bot>
+{
+public:
+	Bot(uint32_t index)
+	    : m_index(index),
+	      m_account(g_options.firstAccount + index),
+	      m_socket(g_ioService),
+	      m_timer(g_ioService)
+	{
+		std::ostringstream ss;
+		ss << "Bot " << index;
+		m_name = ss.str();
+	}
+
+	void start()
+	{
+		m_state = STATE_LOGIN;
+		connect(g_options.host, g_options.port);
+	}
+
+	void stop()
+	{
+		if (m_state == STATE_GAME) {
+			PacketWriter packet;
+			packet.begin();
+			packet.addByte(0x14); // logout
+			packet.end();
+			boost::system::error_code error;
+			boost::asio::write(m_socket, boost::asio::buffer(packet.data()), error);
+		}
+		close(false);
+	}
+
+private:
+	enum State { STATE_IDLE, STATE_LOGIN, STATE_GAME, STATE_CLOSED };
+
+	void connect(const std::string& host, uint16_t port)
+	{
+		boost::system::error_code error;
+		boost::asio::ip::tcp::endpoint endpoint(boost::asio::ip::address::from_string(host, error), port);
+		if (error) {
+			std::cout << m_name << ": invalid address " << host << std::endl;
+			fail();
+			return;
+		}
+
+		m_input.clear();
+		m_socket.async_connect(endpoint, boost::bind(&Bot::onConnect, shared_from_this(),
+		                                             boost::asio::placeholders::error));
+	}
+
+	void onConnect(const boost::system::error_code& error)
+	{
+		if (error) {
+			fail();
+			return;
+		}
+
+		PacketWriter packet;
+		packet.begin();
+		if (m_state == STATE_LOGIN) {
+			packet.addByte(0x01);
+			packet.addU16(0x02); // os
+			packet.addU16(g_options.version);
+			for (int i = 0; i < 12; ++i) {
+				packet.addByte(0); // dat, spr and pic signatures
+			}
+			packet.addU32(m_account);
+			packet.addString(g_options.password);
+		} else {
+			packet.addByte(0x0A);
+			packet.addU16(0x02); // os
+			packet.addU16(g_options.version);
+			packet.addByte(0); // gamemaster flag
+			packet.addU32(m_account);
+			packet.addString(m_name);
+			packet.addString(g_options.password);
+		}
+		packet.end();
+		send(packet);
+		read();
+	}
+
+	void send(PacketWriter& packet)
+	{
+		boost::shared_ptr<std::vector<uint8_t>> data(new std::vector<uint8_t>());
+		data->swap(packet.data());
+		boost::asio::async_write(m_socket, boost::asio::buffer(*data),
+		                         boost::bind(&Bot::onWrite, shared_from_this(), data,
+		                                     boost::asio::placeholders::error));
+	}
+
+	void onWrite(boost::shared_ptr<std::vector<uint8_t>>, const boost::system::error_code& error)
+	{
+		if (error && m_state != STATE_CLOSED) {
+			close(true);
+		}
+	}
+
+	void read()
+	{
+		m_socket.async_read_some(boost::asio::buffer(m_readBuffer),
+		                         boost::bind(&Bot::onRead, shared_from_this(),
+		                                     boost::asio::placeholders::error,
+		                                     boost::asio::placeholders::bytes_transferred));
+	}
+
+	void onRead(const boost::system::error_code& error, size_t bytes)
+	{
+		if (m_state == STATE_CLOSED) {
+			return;
+		}
+
+		if (!error) {
+			m_input.insert(m_input.end(), m_readBuffer, m_readBuffer + bytes);
+		}
+
+		size_t pos = 0;
+		while (m_input.size() - pos >= 2) {
+			const size_t size = m_input[pos] | m_input[pos + 1] << 8;
+			if (m_input.size() - pos - 2 < size) {
+				break;
+			}
+
+			if (!onPacket(&m_input[pos + 2], size)) {
+				return;
+			}
+			pos += size + 2;
+		}
+		m_input.erase(m_input.begin(), m_input.begin() + pos);
+
+		if (error) {
+			// the login server closes the connection after the character list
+			if (m_state == STATE_LOGIN) {
+				fail();
+			} else {
+				close(true);
+			}
+			return;
+		}
+		read();
+	}
+
+	bool onPacket(const uint8_t* data, size_t size)
+	{
+		if (m_state == STATE_LOGIN) {
+			return onLoginPacket(PacketReader(data, size));
+		}
+
+		if (!m_playerId) {
+			return onFirstGamePacket(PacketReader(data, size));
+		}
+
+		if (m_echoPending) {
+			const uint8_t* end = data + size;
+			if (std::search(data, end, m_token.begin(), m_token.end()) != end) {
+				m_echoPending = false;
+				const auto usec =
+				std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - m_sentAt);
+				g_stats.addSample(m_pendingAction, usec.count());
+			}
+		}
+		return true;
+	}
+
+	bool onLoginPacket(PacketReader msg)
+	{
+		uint16_t gamePort = 0;
+		uint32_t gameIp = 0;
+		while (msg.left() > 0) {
+			switch (msg.getByte()) {
+			case 0x0A: // error
+				std::cout << m_name << ": " << msg.getString() << std::endl;
+				fail();
+				return false;
+			case 0x14: // motd
+				msg.getString();
+				break;
+			case 0x64: { // character list
+				uint8_t count = msg.getByte();
+				for (uint8_t i = 0; i < count; ++i) {
+					std::string name = msg.getString();
+					msg.getString(); // world
+					uint32_t ip = msg.getU32();
+					uint16_t port = msg.getU16();
+					if (name == m_name) {
+						gameIp = ip;
+						gamePort = port;
+					}
+				}
+				msg.getU16(); // premium days
+				break;
+			}
+			default:
+				fail();
+				return false;
+			}
+		}
+
+		if (msg.overrun() || !gamePort) {
+			std::cout << m_name << ": character not found on account " << m_account << std::endl;
+			fail();
+			return false;
+		}
+
+		// ip is in network byte order
+		std::ostringstream host;
+		host << (gameIp & 0xFF) << "." << ((gameIp >> 8) & 0xFF) << "." << ((gameIp >> 16) & 0xFF) << "."
+		     << (gameIp >> 24);
+
+		boost::system::error_code error;
+		m_socket.close(error);
+		m_state = STATE_GAME;
+		connect(host.str(), gamePort);
+		return false;
+	}
+
+	bool onFirstGamePacket(PacketReader msg)
+	{
+		switch (msg.getByte()) {
+		case 0x0A: // self appear
+			m_playerId = msg.getU32();
+			break;
+		case 0x14: // error
+			std::cout << m_name << ": " << msg.getString() << std::endl;
+			fail();
+			return false;
+		case 0x16: { // waiting list
+			msg.getString();
+			uint8_t retry = msg.getByte();
+			boost::system::error_code error;
+			m_socket.close(error);
+			m_timer.expires_from_now(boost::posix_time::seconds(std::max<int>(retry, 1)));
+			m_timer.async_wait(boost::bind(&Bot::onRetry, shared_from_this(), boost::asio::placeholders::error));
+			return false;
+		}
+		default:
+			fail();
+			return false;
+		}
+
+		g_stats.logins++;
+		g_stats.online++;
+		g_onlineIds.push_back(m_playerId);
+		m_lastPing = Clock::now();
+		scheduleAction();
+		return true;
+	}
+
+	void onRetry(const boost::system::error_code& error)
+	{
+		if (!error && m_state == STATE_GAME) {
+			start();
+		}
+	}
+
+	void scheduleAction()
+	{
+		const uint32_t interval = g_options.interval;
+		m_timer.expires_from_now(boost::posix_time::milliseconds(randomRange(interval / 2, interval + interval / 2)));
+		m_timer.async_wait(boost::bind(&Bot::onAction, shared_from_this(), boost::asio::placeholders::error));
+	}
+
+	void onAction(const boost::system::error_code& error)
+	{
+		if (error || m_state != STATE_GAME) {
+			return;
+		}
+
+		PacketWriter packet;
+		const Clock::time_point now = Clock::now();
+
+		// the server kicks clients that stop answering its pings
+		if (now - m_lastPing >= std::chrono::seconds(5)) {
+			m_lastPing = now;
+			packet.begin();
+			packet.addByte(0x1E);
+			packet.end();
+		}
+
+		if (m_echoPending) {
+			// keep a single action in flight, give up on it after a while
+			if (now - m_sentAt < std::chrono::seconds(10)) {
+				if (!packet.empty()) {
+					send(packet);
+				}
+				scheduleAction();
+				return;
+			}
+
+			g_stats.lostEchoes++;
+			m_echoPending = false;
+		}
+
+		std::ostringstream token;
+		token << "#" << m_index << ":" << ++m_sequence << "#";
+		m_token = token.str();
+
+		m_pendingAction = pickAction();
+		packet.begin();
+		switch (m_pendingAction) {
+		case ACTION_WALK:
+			packet.addByte(0x65 + randomRange(0, 3)); // north, east, south, west
+			break;
+		case ACTION_ATTACK: {
+			uint32_t target = 0;
+			if (randomRange(0, 3) != 0) {
+				target = g_onlineIds[randomRange(0, g_onlineIds.size() - 1)];
+			}
+			packet.addByte(0xA1);
+			packet.addU32(target != m_playerId ? target : 0);
+			break;
+		}
+		case ACTION_USE:
+			packet.addByte(0x82);
+			packet.addPosition(0xFFFF, 3, 0); // backpack slot
+			packet.addU16(g_options.useSprite);
+			packet.addByte(0); // stackpos
+			packet.addByte(0); // container index
+			break;
+		case ACTION_SAY:
+		default:
+			break;
+		}
+
+		if (m_pendingAction != ACTION_SAY) {
+			packet.end();
+			packet.begin();
+		}
+		packet.addByte(0x96);
+		packet.addByte(0x01); // SPEAK_SAY
+		packet.addString(m_token);
+		packet.end();
+
+		m_echoPending = true;
+		m_sentAt = Clock::now();
+		send(packet);
+		scheduleAction();
+	}
+
+	ActionType pickAction() const
+	{
+		uint32_t total = 0;
+		for (uint32_t weight : g_options.weights) {
+			total += weight;
+		}
+
+		uint32_t roll = randomRange(1, std::max<uint32_t>(total, 1));
+		for (int i = 0; i < ACTION_LAST; ++i) {
+			if (roll <= g_options.weights[i]) {
+				return (ActionType)i;
+			}
+			roll -= g_options.weights[i];
+		}
+		return ACTION_SAY;
+	}
+
+	void fail()
+	{
+		g_stats.loginFailures++;
+		close(false);
+	}
+
+	void close(bool disconnected)
+	{
+		if (m_state == STATE_CLOSED) {
+			return;
+		}
+
+		if (m_playerId) {
+			g_stats.online--;
+			g_onlineIds.erase(std::remove(g_onlineIds.begin(), g_onlineIds.end(), m_playerId), g_onlineIds.end());
+			if (disconnected) {
+				g_stats.disconnects++;
+			}
+		}
+
+		m_state = STATE_CLOSED;
+		boost::system::error_code error;
+		m_timer.cancel(error);
+		m_socket.close(error);
+	}
+
+	uint32_t m_index;
+	uint32_t m_account;
+	std::string m_name;
+	State m_state = STATE_IDLE;
+
+	boost::asio::ip::tcp::socket m_socket;
+	boost::asio::deadline_timer m_timer;
+	uint8_t m_readBuffer[4096];
+	std::vector<uint8_t> m_input;
+
+	uint32_t m_playerId = 0;
+	uint32_t m_sequence = 0;
+	std::string m_token;
+	bool m_echoPending = false;
+	ActionType m_pendingAction = ACTION_SAY;
+	Clock::time_point m_sentAt;
+	Clock::time_point m_lastPing;
+};
+
+typedef boost::shared_ptr<Bot> Bot_ptr;
+
+//////////////////////////////////////////////////////////////////////
+
+static std::vector<Bot_ptr> g_bots;
+static Clock::time_point g_startTime;
+
+static double elapsedSeconds()
+{
+	return std::chrono::duration<double>(Clock::now() - g_startTime).count();
+}
+
+static void startBots(boost::asio::deadline_timer* timer, const boost::system::error_code& error)
+{
+	if (error) {
+		return;
+	}
+
+	for (uint32_t i = 0; i < std::max<uint32_t>(g_options.ramp / 10, 1) && g_bots.size() < g_options.bots; ++i) {
+		Bot_ptr bot(new Bot(g_bots.size()));
+		g_bots.push_back(bot);
+		bot->start();
+	}
+
+	if (g_bots.size() < g_options.bots) {
+		timer->expires_from_now(boost::posix_time::milliseconds(100));
+		timer->async_wait(boost::bind(&startBots, timer, boost::asio::placeholders::error));
+	}
+}
+
+static void report(boost::asio::deadline_timer* timer, const boost::system::error_code& error)
+{
+	if (error) {
+		return;
+	}
+
+	g_stats.report(elapsedSeconds(), false);
+	timer->expires_from_now(boost::posix_time::seconds(g_options.report));
+	timer->async_wait(boost::bind(&report, timer, boost::asio::placeholders::error));
+}
+
+static void finish(boost::asio::deadline_timer* rampTimer, boost::asio::deadline_timer* reportTimer)
+{
+	boost::system::error_code error;
+	rampTimer->cancel(error);
+	reportTimer->cancel(error);
+	for (Bot_ptr& bot : g_bots) {
+		bot->stop();
+	}
+
+	std::cout << "Totals:" << std::endl;
+	g_stats.report(elapsedSeconds(), true);
+}
+
+static void printAccountsSql()
+{
+	// Group 100 carries PlayerFlag_CannotBeMuted so the echo probes are never muted
+	std::cout << "INSERT OR REPLACE INTO \"groups\" (\"id\", \"name\", \"flags\", \"access\", "
+	             "\"maxdepotitems\", \"maxviplist\") VALUES (100, 'Stress bot', 68719476736, 0, 1000, 100);"
+	          << std::endl;
+	std::cout << "BEGIN;" << std::endl;
+	for (uint32_t i = 0; i < g_options.bots; ++i) {
+		const uint32_t account = g_options.firstAccount + i;
+		std::cout << "INSERT INTO \"accounts\" (\"id\", \"password\") VALUES (" << account << ", '"
+		          << g_options.password << "');" << std::endl;
+		std::cout << "INSERT INTO \"players\" (\"name\", \"account_id\", \"group_id\", \"conditions\", "
+		             "\"rank_id\", \"town_id\") VALUES ('Bot "
+		          << i << "', " << account << ", 100, '', 0, 1);" << std::endl;
+	}
+	std::cout << "COMMIT;" << std::endl;
+}
+
+static void usage(const char* name)
+{
+	std::cout << "Usage: " << name << " [options]\n"
+	          << "  --host <ip>             server address (127.0.0.1)\n"
+	          << "  --port <port>           login server port (7171)\n"
+	          << "  --version <n>           client version sent to the server (740)\n"
+	          << "  --bots <n>              number of bot sessions (100)\n"
+	          << "  --first-account <n>     account number of bot 0, bot i uses first + i (100000)\n"
+	          << "  --password <text>       password of every bot account (stress)\n"
+	          << "  --ramp <n>              logins started per second (50)\n"
+	          << "  --duration <seconds>    length of the run (60)\n"
+	          << "  --interval <ms>         average time between actions of a bot (1000)\n"
+	          << "  --report <seconds>      time between interval reports (10)\n"
+	          << "  --mix <w,s,a,u>         weights of walk, say, attack and use actions (60,20,10,10)\n"
+	          << "  --use-sprite <id>       sprite id of the item in the backpack slot (1988)\n"
+	          << "  --make-accounts         print SQL creating the bot accounts and characters, then exit\n"
+	          << std::endl;
+}
+
+static bool parseOptions(int argc, char* argv[], bool& makeAccounts)
+{
+	for (int i = 1; i < argc; ++i) {
+		const std::string arg = argv[i];
+		if (arg == "--make-accounts") {
+			makeAccounts = true;
+			continue;
+		}
+
+		if (i + 1 >= argc) {
+			return false;
+		}
+
+		const std::string value = argv[++i];
+		const uint32_t number = std::strtoul(value.c_str(), nullptr, 10);
+		if (arg == "--host") {
+			g_options.host = value;
+		} else if (arg == "--port") {
+			g_options.port = number;
+		} else if (arg == "--version") {
+			g_options.version = number;
+		} else if (arg == "--bots") {
+			g_options.bots = number;
+		} else if (arg == "--first-account") {
+			g_options.firstAccount = number;
+		} else if (arg == "--password") {
+			g_options.password = value;
+		} else if (arg == "--ramp") {
+			g_options.ramp = std::max<uint32_t>(number, 1);
+		} else if (arg == "--duration") {
+			g_options.duration = number;
+		} else if (arg == "--interval") {
+			g_options.interval = std::max<uint32_t>(number, 2);
+		} else if (arg == "--report") {
+			g_options.report = std::max<uint32_t>(number, 1);
+		} else if (arg == "--mix") {
+			if (std::sscanf(value.c_str(), "%u,%u,%u,%u", &g_options.weights[ACTION_WALK],
+			                &g_options.weights[ACTION_SAY], &g_options.weights[ACTION_ATTACK],
+			                &g_options.weights[ACTION_USE]) != 4) {
+				return false;
+			}
+		} else if (arg == "--use-sprite") {
+			g_options.useSprite = number;
+		} else {
+			return false;
+		}
+	}
+	return true;
+}
+
+int main(int argc, char* argv[])
+{
+	bool makeAccounts = false;
+	if (!parseOptions(argc, argv, makeAccounts)) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	if (makeAccounts) {
+		printAccountsSql();
+		return 0;
+	}
+
+	std::cout << "Starting " << g_options.bots << " bots against " << g_options.host << ":" << g_options.port
+	          << " for " << g_options.duration << " seconds" << std::endl;
+
+	g_startTime = Clock::now();
+	g_bots.reserve(g_options.bots);
+
+	boost::asio::deadline_timer rampTimer(g_ioService);
+	startBots(&rampTimer, boost::system::error_code());
+
+	boost::asio::deadline_timer reportTimer(g_ioService);
+	reportTimer.expires_from_now(boost::posix_time::seconds(g_options.report));
+	reportTimer.async_wait(boost::bind(&report, &reportTimer, boost::asio::placeholders::error));
+
+	boost::asio::deadline_timer stopTimer(g_ioService);
+	stopTimer.expires_from_now(boost::posix_time::seconds(g_options.duration));
+	stopTimer.async_wait(boost::bind(&finish, &rampTimer, &reportTimer));
+
+	g_ioService.run();
+	return 0;
+}
@@ -86,6 +86,11 @@ AllowClones = false
 -- Only one player online per account
 CheckAccounts = false
 
+-- Status answers for server lists are rendered at most this often (in ms)
+-- or when the players online changed by StatusCachePlayers
+StatusCacheTime = 10 * 1000
+StatusCachePlayers = 5
+
 ---- DATABASE ----
 
 -- SQL type
@@ -101,6 +106,72 @@ SQL_Port = 3306
 SQL_User = "root"
 SQL_Pass = ""
 
+-- these settings are only used by SQLite
+-- journal mode, options: wal, delete, truncate, persist, memory or off
+-- 'wal' lets the database workers read while the game thread saves
+SQLite_JournalMode = "wal"
+-- how often SQLite waits for the disk, options: off, normal, full or extra
+-- 'normal' with 'wal' can lose the last commits on a power failure, never
+-- corrupts the database
+SQLite_Synchronous = "normal"
+-- pages kept in memory by each connection
+SQLite_CacheSize = 2000
+
+-- Threads that run database queries off the game thread (logins, vip
+-- lookups, db.asyncQuery and db.asyncStoreQuery), each one takes a
+-- connection from the pool while it runs a query
+DatabaseWorkers = 1
+
+-- Connections the pool may open besides the game thread's one, a thread
+-- waits up to SQL_PoolWait ms for a free one before it shares the game
+-- thread's. Idle connections are pinged every SQL_PoolKeepAlive seconds
+-- so the server does not close them (MySQL wait_timeout), 0 disables it.
+SQL_PoolSize = 4
+SQL_PoolWait = 1000
+SQL_PoolKeepAlive = 300
+
+-- Keep each player's inventory and depot in one blob of player_itemblobs
+-- instead of a row per item, players still in rows are moved on their next
+-- save. After changing it run the server once with --migrate-items to move
+-- everyone to the selected format.
+PlayerItemBlobs = false
+
+-- Queries that take longer than this (in ms) are logged with the code that
+-- ran them, 0 logs none
+SlowQueryTime = 250
+-- Every QueryStatsDumpInterval minutes the query times collected so far
+-- are written to QueryStatsFile, 0 disables it. /querystats shows the
+-- same for gamemasters
+QueryStatsDumpInterval = 0
+QueryStatsFile = "querystats.txt"
+
+-- Time every Lua event (actions, movements, talkactions, creaturescripts,
+-- npcs...) by interface and script. /scriptprofile shows the slowest ones
+-- and writes ScriptProfilerFile .txt plus .folded stacks for flame graph
+-- tools. With ScriptProfilerSampleInterval the Lua stack is also sampled
+-- every that many instructions into .samples.folded, 0 disables it.
+-- Profiling costs some time itself, leave it off unless looking for a
+-- slow script.
+ScriptProfiler = false
+ScriptProfilerSampleInterval = 0
+ScriptProfilerFile = "scriptprofile"
+
+-- Keep the compiled bytecode of every script and reuse it while the file
+-- content stays the same, instead of parsing global.lua and
+-- the npc libraries for every interface and every script on each /reload
+LuaChunkCache = true
+
+-- Write level, experience, inventory and storage changes of online players
+-- to PlayerJournalFile every PlayerJournalInterval ms, so a crash loses only
+-- that much instead of everything since the last save. Every
+-- PlayerJournalCompactInterval minutes and after each server save the
+-- journal is written to the database and emptied, a journal left by a
+-- crash is written back on the next start.
+PlayerJournal = false
+PlayerJournalFile = "player.journal"
+PlayerJournalInterval = 1000
+PlayerJournalCompactInterval = 10
+
 ---- HOUSES ----
 
 -- house rent period
@@ -181,6 +252,19 @@ DespawnRange = 2
 -- How many square metters can a monster be far from his spawn before despawning
 DespawnRadius = 50
 
+-- NPCs only run their Lua think callback while a player is within this many
+-- squares on the same floor or someone is in a conversation with them, idle
+-- NPCs leave the creature checks until a player comes close. 0 = always think,
+-- at most 11: players further away do not reach the events that wake NPCs up
+NpcThinkRange = 0
+
+-- Threads that run the onThink of NPC scripts while the game thread waits,
+-- each one owns the Lua state of a share of the NPCs. 0 runs them on the
+-- game thread. selfSay and selfMoveTo are applied once all of them finished,
+-- an NPC whose onThink calls a function that changes the game thinks on the
+-- game thread from then on. Only read at startup.
+NpcScriptThreads = 0
+
 --- STATUS ---
 
 -- Message Of The Day box that you sometimes get before you choose characters)